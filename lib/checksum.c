@@ -12,35 +12,57 @@
 int			/* return checksum in low-order 16 bits */
 in_cksum(void *parg, int nbytes)
 {
-	u_short *ptr = parg;
-	register long		sum;		/* assumes long == 32 bits */
+	u_char *ptr = parg;
+	u_int64_t		sum;
+	u_int32_t		word;
 	u_short			oddbyte;
-	register u_short	answer;		/* assumes u_short == 16 bits */
+	u_short			answer;
 
 	/*
-	 * Our algorithm is simple, using a 32-bit accumulator (sum),
-	 * we add sequential 16-bit words to it, and at the end, fold back
-	 * all the carry bits from the top 16 bits into the lower 16 bits.
+	 * The ones-complement sum does not care about the width of the
+	 * words being added as long as the carries are folded back in at
+	 * the end, so we add 32-bit words into a 64-bit accumulator (which
+	 * cannot overflow for any int-sized buffer) and fold 64 -> 16 once.
+	 * The loads go through memcpy as the buffer need not be aligned.
 	 */
 
 	sum = 0;
-	while (nbytes > 1)  {
-		sum += *ptr++;
+	while (nbytes >= 16) {
+		memcpy(&word, ptr, 4);		sum += word;
+		memcpy(&word, ptr + 4, 4);	sum += word;
+		memcpy(&word, ptr + 8, 4);	sum += word;
+		memcpy(&word, ptr + 12, 4);	sum += word;
+		ptr += 16;
+		nbytes -= 16;
+	}
+	while (nbytes >= 4) {
+		memcpy(&word, ptr, 4);
+		sum += word;
+		ptr += 4;
+		nbytes -= 4;
+	}
+	if (nbytes >= 2) {
+		memcpy(&oddbyte, ptr, 2);
+		sum += oddbyte;
+		ptr += 2;
 		nbytes -= 2;
 	}
 
 				/* mop up an odd byte, if necessary */
 	if (nbytes == 1) {
 		oddbyte = 0;		/* make sure top half is zero */
-		*((u_char *) &oddbyte) = *(u_char *)ptr;   /* one byte only */
+		*((u_char *) &oddbyte) = *ptr;   /* one byte only */
 		sum += oddbyte;
 	}
 
 	/*
-	 * Add back carry outs from top 16 bits to low 16 bits.
+	 * Add back carry outs from top bits to low 16 bits.
 	 */
 
+	sum  = (sum >> 32) + (sum & 0xffffffff);	/* add high-32 to low-32 */
+	sum  = (sum >> 32) + (sum & 0xffffffff);	/* add carry */
 	sum  = (sum >> 16) + (sum & 0xffff);	/* add high-16 to low-16 */
+	sum  = (sum >> 16) + (sum & 0xffff);	/* add carry */
 	sum += (sum >> 16);			/* add carry */
 	answer = ~sum;		/* ones-complement, then truncate to 16 bits */
 	return(answer);
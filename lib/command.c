@@ -180,6 +180,164 @@ argv_concat (const char **argv, int argc, int shift)
   return str;
 }
 
+/* Each node's commands are also compiled into a trie of their tokens,
+ * so that matching a line costs about one step per input word instead
+ * of a pass over every command of the node per word.  Commands whose
+ * tokens are equal up to some word share the path to it; the matcher
+ * filters the trie nodes reached exactly as cmd_filter_by_string(),
+ * cmd_filter_by_completion() and is_cmd_ambiguous() filter commands.
+ */
+struct cmd_trie
+{
+  /* Token leading here from the parent, and the token itself when it
+     is a single plain keyword. */
+  vector descvec;
+  const char *keyword;
+
+  /* Children: keyword tokens sorted for binary search, others in a
+     vector. */
+  struct cmd_trie **keywords;
+  unsigned int keyword_count;
+  vector others;
+
+  /* Commands through here, by whether the words up to here are enough
+     to complete them. */
+  unsigned int complete;
+  unsigned int incomplete;
+  struct cmd_element *element;	/* Last command complete here. */
+  struct cmd_element *any;	/* Last command through here. */
+};
+
+static struct cmd_trie *
+cmd_trie_new (vector descvec)
+{
+  struct cmd_trie *trie;
+  struct desc *desc;
+
+  trie = XCALLOC (MTYPE_CMD_TRIE, sizeof (struct cmd_trie));
+  trie->descvec = descvec;
+  trie->others = vector_init (VECTOR_MIN_SIZE);
+
+  if (descvec && vector_active (descvec) == 1
+      && (desc = vector_slot (descvec, 0)) != NULL
+      && !(CMD_OPTION (desc->cmd) || CMD_VARIABLE (desc->cmd)
+	   || CMD_VARARG (desc->cmd)))
+    trie->keyword = desc->cmd;
+
+  return trie;
+}
+
+/* Index of the first keyword child not sorting before WORD. */
+static unsigned int
+cmd_trie_lower_bound (struct cmd_trie *trie, const char *word)
+{
+  unsigned int lo = 0, hi = trie->keyword_count, mid;
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (strcmp (trie->keywords[mid]->keyword, word) < 0)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+static int
+cmd_descvec_same (vector a, vector b)
+{
+  unsigned int i;
+  struct desc *da, *db;
+
+  if (vector_active (a) != vector_active (b))
+    return 0;
+
+  for (i = 0; i < vector_active (a); i++)
+    {
+      da = vector_slot (a, i);
+      db = vector_slot (b, i);
+      if (da == NULL || db == NULL)
+	{
+	  if (da != db)
+	    return 0;
+	}
+      else if (strcmp (da->cmd, db->cmd) != 0)
+	return 0;
+    }
+  return 1;
+}
+
+/* Find or add the child of TRIE for token DESCVEC. */
+static struct cmd_trie *
+cmd_trie_child (struct cmd_trie *trie, vector descvec)
+{
+  struct cmd_trie *child;
+  unsigned int i;
+
+  child = cmd_trie_new (descvec);
+
+  if (child->keyword)
+    {
+      i = cmd_trie_lower_bound (trie, child->keyword);
+      if (i < trie->keyword_count
+	  && strcmp (trie->keywords[i]->keyword, child->keyword) == 0)
+	{
+	  vector_free (child->others);
+	  XFREE (MTYPE_CMD_TRIE, child);
+	  return trie->keywords[i];
+	}
+
+      trie->keywords = XREALLOC (MTYPE_CMD_TRIE, trie->keywords,
+				 (trie->keyword_count + 1)
+				 * sizeof (struct cmd_trie *));
+      memmove (&trie->keywords[i + 1], &trie->keywords[i],
+	       (trie->keyword_count - i) * sizeof (struct cmd_trie *));
+      trie->keywords[i] = child;
+      trie->keyword_count++;
+      return child;
+    }
+
+  for (i = 0; i < vector_active (trie->others); i++)
+    {
+      struct cmd_trie *other = vector_slot (trie->others, i);
+
+      if (cmd_descvec_same (other->descvec, descvec))
+	{
+	  vector_free (child->others);
+	  XFREE (MTYPE_CMD_TRIE, child);
+	  return other;
+	}
+    }
+
+  vector_set (trie->others, child);
+  return child;
+}
+
+/* Add command CMD, already split into tokens, to the trie of its node. */
+static void
+cmd_trie_insert (struct cmd_trie *trie, struct cmd_element *cmd)
+{
+  unsigned int i;
+
+  if (cmd->strvec == NULL)
+    return;
+
+  for (i = 0; i < vector_active (cmd->strvec); i++)
+    {
+      trie = cmd_trie_child (trie, vector_slot (cmd->strvec, i));
+
+      if (cmd->cmdsize <= i + 1)
+	{
+	  trie->complete++;
+	  trie->element = cmd;
+	}
+      else
+	trie->incomplete++;
+      trie->any = cmd;
+    }
+}
+
 /* Install top node of command vector. */
 void
 install_node (struct cmd_node *node, 
@@ -188,6 +346,7 @@ install_node (struct cmd_node *node,
   vector_set_index (cmdvec, node->node, node);
   node->func = func;
   node->cmd_vector = vector_init (VECTOR_MIN_SIZE);
+  node->trie = cmd_trie_new (NULL);
 }
 
 /* Compare two command's string.  Used in sort_node (). */
@@ -494,6 +653,9 @@ install_element (enum node_type ntype, struct cmd_element *cmd)
 
   cmd->strvec = cmd_make_descvec (cmd->sstring, cmd->doc);
   cmd->cmdsize = cmd_cmdsize (cmd->strvec);
+
+  if (cnode->trie)
+    cmd_trie_insert (cnode->trie, cmd);
 }
 
 static unsigned char itoa64[] =	
@@ -599,6 +761,15 @@ config_write_host (struct vty *vty)
     vty_out (vty, "log timestamp precision %d%s",
 	     zlog_default->timestamp_precision, VTY_NEWLINE);
 
+  if (zlog_default->ring_size)
+    vty_out (vty, "log buffered %u%s", zlog_default->ring_size, VTY_NEWLINE);
+
+  if (zlog_default->rate_limit)
+    vty_out (vty, "log rate-limit %u%s",
+	     zlog_default->rate_limit, VTY_NEWLINE);
+
+  thread_config_write (vty);
+
   if (host.advanced)
     vty_out (vty, "service advanced-vty%s", VTY_NEWLINE);
 
@@ -1122,131 +1293,109 @@ cmd_range_match (const char *range, const char *str)
   return 1;
 }
 
-/* Make completion match and return match type flag. */
-static enum match_type
-cmd_filter_by_completion (char *command, vector v, unsigned int index)
+/* Match one input word against the alternatives of one command
+   token.  STRICT requires whole keywords and addresses, otherwise
+   their prefixes match too.  Raises *MATCH_TYPE to the best kind of
+   match found and returns the number of alternatives that matched. */
+static int
+cmd_descvec_filter (const char *command, vector descvec, int strict,
+		    enum match_type *match_type)
 {
-  unsigned int i;
+  unsigned int j;
+  int matched = 0;
   const char *str;
-  struct cmd_element *cmd_element;
-  enum match_type match_type;
-  vector descvec;
   struct desc *desc;
 
-  match_type = no_match;
-
-  /* If command and cmd_element string does not match set NULL to vector */
-  for (i = 0; i < vector_active (v); i++)
-    if ((cmd_element = vector_slot (v, i)) != NULL)
+  for (j = 0; j < vector_active (descvec); j++)
+    if ((desc = vector_slot (descvec, j)))
       {
-	if (index >= vector_active (cmd_element->strvec))
-	  vector_slot (v, i) = NULL;
-	else
-	  {
-	    unsigned int j;
-	    int matched = 0;
-
-	    descvec = vector_slot (cmd_element->strvec, index);
-
-	    for (j = 0; j < vector_active (descvec); j++)
-	      if ((desc = vector_slot (descvec, j)))
-		{
-		  str = desc->cmd;
-		  
-		  if (CMD_VARARG (str))
-		    {
-		      if (match_type < vararg_match)
-			match_type = vararg_match;
-		      matched++;
-		    }
-		  else if (CMD_RANGE (str))
-		    {
-		      if (cmd_range_match (str, command))
-			{
-			  if (match_type < range_match)
-			    match_type = range_match;
+	str = desc->cmd;
 
-			  matched++;
-			}
-		    }
+	if (CMD_VARARG (str))
+	  {
+	    if (*match_type < vararg_match)
+	      *match_type = vararg_match;
+	    matched++;
+	  }
+	else if (CMD_RANGE (str))
+	  {
+	    if (cmd_range_match (str, command))
+	      {
+		if (*match_type < range_match)
+		  *match_type = range_match;
+		matched++;
+	      }
+	  }
 #ifdef HAVE_IPV6
-		  else if (CMD_IPV6 (str))
-		    {
-		      if (cmd_ipv6_match (command))
-			{
-			  if (match_type < ipv6_match)
-			    match_type = ipv6_match;
-
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV6_PREFIX (str))
-		    {
-		      if (cmd_ipv6_prefix_match (command))
-			{
-			  if (match_type < ipv6_prefix_match)
-			    match_type = ipv6_prefix_match;
-
-			  matched++;
-			}
-		    }
+	else if (CMD_IPV6 (str))
+	  {
+	    if (strict ? cmd_ipv6_match (command) == exact_match
+		: cmd_ipv6_match (command) != no_match)
+	      {
+		if (*match_type < ipv6_match)
+		  *match_type = ipv6_match;
+		matched++;
+	      }
+	  }
+	else if (CMD_IPV6_PREFIX (str))
+	  {
+	    if (strict ? cmd_ipv6_prefix_match (command) == exact_match
+		: cmd_ipv6_prefix_match (command) != no_match)
+	      {
+		if (*match_type < ipv6_prefix_match)
+		  *match_type = ipv6_prefix_match;
+		matched++;
+	      }
+	  }
 #endif /* HAVE_IPV6  */
-		  else if (CMD_IPV4 (str))
-		    {
-		      if (cmd_ipv4_match (command))
-			{
-			  if (match_type < ipv4_match)
-			    match_type = ipv4_match;
-
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV4_PREFIX (str))
-		    {
-		      if (cmd_ipv4_prefix_match (command))
-			{
-			  if (match_type < ipv4_prefix_match)
-			    match_type = ipv4_prefix_match;
-			  matched++;
-			}
-		    }
-		  else
-		    /* Check is this point's argument optional ? */
-		  if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    {
-		      if (match_type < extend_match)
-			match_type = extend_match;
-		      matched++;
-		    }
-		  else if (strncmp (command, str, strlen (command)) == 0)
-		    {
-		      if (strcmp (command, str) == 0)
-			match_type = exact_match;
-		      else
-			{
-			  if (match_type < partly_match)
-			    match_type = partly_match;
-			}
-		      matched++;
-		    }
-		}
-	    if (!matched)
-	      vector_slot (v, i) = NULL;
+	else if (CMD_IPV4 (str))
+	  {
+	    if (strict ? cmd_ipv4_match (command) == exact_match
+		: cmd_ipv4_match (command) != no_match)
+	      {
+		if (*match_type < ipv4_match)
+		  *match_type = ipv4_match;
+		matched++;
+	      }
+	  }
+	else if (CMD_IPV4_PREFIX (str))
+	  {
+	    if (strict ? cmd_ipv4_prefix_match (command) == exact_match
+		: cmd_ipv4_prefix_match (command) != no_match)
+	      {
+		if (*match_type < ipv4_prefix_match)
+		  *match_type = ipv4_prefix_match;
+		matched++;
+	      }
+	  }
+	else if (CMD_OPTION (str) || CMD_VARIABLE (str))
+	  {
+	    if (*match_type < extend_match)
+	      *match_type = extend_match;
+	    matched++;
+	  }
+	else if (strcmp (command, str) == 0)
+	  {
+	    *match_type = exact_match;
+	    matched++;
+	  }
+	else if (!strict && strncmp (command, str, strlen (command)) == 0)
+	  {
+	    if (*match_type < partly_match)
+	      *match_type = partly_match;
+	    matched++;
 	  }
       }
-  return match_type;
+  return matched;
 }
 
-/* Filter vector by command character with index. */
+/* Filter vector V by input word COMMAND at token INDEX. */
 static enum match_type
-cmd_filter_by_string (char *command, vector v, unsigned int index)
+cmd_filter_vector (char *command, vector v, unsigned int index, int strict)
 {
   unsigned int i;
-  const char *str;
   struct cmd_element *cmd_element;
   enum match_type match_type;
-  vector descvec;
-  struct desc *desc;
 
   match_type = no_match;
 
@@ -1256,93 +1405,110 @@ cmd_filter_by_string (char *command, vector v, unsigned int index)
       {
 	/* If given index is bigger than max string vector of command,
 	   set NULL */
-	if (index >= vector_active (cmd_element->strvec))
+	if (index >= vector_active (cmd_element->strvec)
+	    || !cmd_descvec_filter (command,
+				    vector_slot (cmd_element->strvec, index),
+				    strict, &match_type))
 	  vector_slot (v, i) = NULL;
-	else
-	  {
-	    unsigned int j;
-	    int matched = 0;
+      }
+  return match_type;
+}
+
+/* Make completion match and return match type flag. */
+static enum match_type
+cmd_filter_by_completion (char *command, vector v, unsigned int index)
+{
+  return cmd_filter_vector (command, v, index, 0);
+}
 
-	    descvec = vector_slot (cmd_element->strvec, index);
+/* Check one command token against the match TYPE chosen for the
+   input word.  Returns 1 on an ambiguous and 2 on an incomplete match,
+   as is_cmd_ambiguous() does.  Otherwise returns 0 and sets *KEEP when
+   the command still matches; *MATCHED carries the keyword or range
+   matched so far between calls. */
+static int
+cmd_descvec_ambiguous (const char *command, vector descvec,
+		       enum match_type type, const char **matched, int *keep)
+{
+  unsigned int j;
+  const char *str;
+  struct desc *desc;
+  int match = 0;
 
-	    for (j = 0; j < vector_active (descvec); j++)
-	      if ((desc = vector_slot (descvec, j)))
-		{
-		  str = desc->cmd;
+  for (j = 0; j < vector_active (descvec); j++)
+    if ((desc = vector_slot (descvec, j)))
+      {
+	enum match_type ret;
 
-		  if (CMD_VARARG (str))
-		    {
-		      if (match_type < vararg_match)
-			match_type = vararg_match;
-		      matched++;
-		    }
-		  else if (CMD_RANGE (str))
-		    {
-		      if (cmd_range_match (str, command))
-			{
-			  if (match_type < range_match)
-			    match_type = range_match;
-			  matched++;
-			}
-		    }
+	str = desc->cmd;
+
+	switch (type)
+	  {
+	  case exact_match:
+	    if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
+		&& strcmp (command, str) == 0)
+	      match++;
+	    break;
+	  case partly_match:
+	    if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
+		&& strncmp (command, str, strlen (command)) == 0)
+	      {
+		if (*matched && strcmp (*matched, str) != 0)
+		  return 1;	/* There is ambiguous match. */
+		else
+		  *matched = str;
+		match++;
+	      }
+	    break;
+	  case range_match:
+	    if (cmd_range_match (str, command))
+	      {
+		if (*matched && strcmp (*matched, str) != 0)
+		  return 1;
+		else
+		  *matched = str;
+		match++;
+	      }
+	    break;
 #ifdef HAVE_IPV6
-		  else if (CMD_IPV6 (str))
-		    {
-		      if (cmd_ipv6_match (command) == exact_match)
-			{
-			  if (match_type < ipv6_match)
-			    match_type = ipv6_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV6_PREFIX (str))
-		    {
-		      if (cmd_ipv6_prefix_match (command) == exact_match)
-			{
-			  if (match_type < ipv6_prefix_match)
-			    match_type = ipv6_prefix_match;
-			  matched++;
-			}
-		    }
-#endif /* HAVE_IPV6  */
-		  else if (CMD_IPV4 (str))
-		    {
-		      if (cmd_ipv4_match (command) == exact_match)
-			{
-			  if (match_type < ipv4_match)
-			    match_type = ipv4_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV4_PREFIX (str))
-		    {
-		      if (cmd_ipv4_prefix_match (command) == exact_match)
-			{
-			  if (match_type < ipv4_prefix_match)
-			    match_type = ipv4_prefix_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    {
-		      if (match_type < extend_match)
-			match_type = extend_match;
-		      matched++;
-		    }
-		  else
-		    {
-		      if (strcmp (command, str) == 0)
-			{
-			  match_type = exact_match;
-			  matched++;
-			}
-		    }
-		}
-	    if (!matched)
-	      vector_slot (v, i) = NULL;
+	  case ipv6_match:
+	    if (CMD_IPV6 (str))
+	      match++;
+	    break;
+	  case ipv6_prefix_match:
+	    if ((ret = cmd_ipv6_prefix_match (command)) != no_match)
+	      {
+		if (ret == partly_match)
+		  return 2;	/* There is incomplete match. */
+
+		match++;
+	      }
+	    break;
+#endif /* HAVE_IPV6 */
+	  case ipv4_match:
+	    if (CMD_IPV4 (str))
+	      match++;
+	    break;
+	  case ipv4_prefix_match:
+	    if ((ret = cmd_ipv4_prefix_match (command)) != no_match)
+	      {
+		if (ret == partly_match)
+		  return 2;	/* There is incomplete match. */
+
+		match++;
+	      }
+	    break;
+	  case extend_match:
+	    if (CMD_OPTION (str) || CMD_VARIABLE (str))
+	      match++;
+	    break;
+	  case no_match:
+	  default:
+	    break;
 	  }
       }
-  return match_type;
+  *keep = (match != 0);
+  return 0;
 }
 
 /* Check ambiguous match */
@@ -1350,96 +1516,158 @@ static int
 is_cmd_ambiguous (char *command, vector v, int index, enum match_type type)
 {
   unsigned int i;
-  unsigned int j;
-  const char *str = NULL;
   struct cmd_element *cmd_element;
   const char *matched = NULL;
-  vector descvec;
-  struct desc *desc;
+  int keep;
+  int ret;
 
   for (i = 0; i < vector_active (v); i++)
     if ((cmd_element = vector_slot (v, i)) != NULL)
       {
-	int match = 0;
+	ret = cmd_descvec_ambiguous (command,
+				     vector_slot (cmd_element->strvec, index),
+				     type, &matched, &keep);
+	if (ret)
+	  return ret;
+	if (!keep)
+	  vector_slot (v, i) = NULL;
+      }
+  return 0;
+}
 
-	descvec = vector_slot (cmd_element->strvec, index);
+/* Add to NEXT the children of TRIE whose token matches input word
+   COMMAND, as cmd_filter_vector() keeps commands. */
+static void
+cmd_trie_filter (struct cmd_trie *trie, const char *command, int strict,
+		 enum match_type *match_type, vector next)
+{
+  struct cmd_trie *child;
+  unsigned int i;
+  size_t len;
 
-	for (j = 0; j < vector_active (descvec); j++)
-	  if ((desc = vector_slot (descvec, j)))
-	    {
-	      enum match_type ret;
-	      
-	      str = desc->cmd;
+  i = cmd_trie_lower_bound (trie, command);
+  if (strict)
+    {
+      if (i < trie->keyword_count
+	  && strcmp (trie->keywords[i]->keyword, command) == 0)
+	{
+	  *match_type = exact_match;
+	  vector_set (next, trie->keywords[i]);
+	}
+    }
+  else
+    {
+      len = strlen (command);
+      for (; i < trie->keyword_count; i++)
+	{
+	  child = trie->keywords[i];
+	  if (strncmp (command, child->keyword, len) != 0)
+	    break;
+	  if (child->keyword[len] == '\0')
+	    *match_type = exact_match;
+	  else if (*match_type < partly_match)
+	    *match_type = partly_match;
+	  vector_set (next, child);
+	}
+    }
 
-	      switch (type)
-		{
-		case exact_match:
-		  if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
-		      && strcmp (command, str) == 0)
-		    match++;
-		  break;
-		case partly_match:
-		  if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
-		      && strncmp (command, str, strlen (command)) == 0)
-		    {
-		      if (matched && strcmp (matched, str) != 0)
-			return 1;	/* There is ambiguous match. */
-		      else
-			matched = str;
-		      match++;
-		    }
-		  break;
-		case range_match:
-		  if (cmd_range_match (str, command))
-		    {
-		      if (matched && strcmp (matched, str) != 0)
-			return 1;
-		      else
-			matched = str;
-		      match++;
-		    }
-		  break;
-#ifdef HAVE_IPV6
-		case ipv6_match:
-		  if (CMD_IPV6 (str))
-		    match++;
-		  break;
-		case ipv6_prefix_match:
-		  if ((ret = cmd_ipv6_prefix_match (command)) != no_match)
-		    {
-		      if (ret == partly_match)
-			return 2;	/* There is incomplete match. */
+  for (i = 0; i < vector_active (trie->others); i++)
+    {
+      child = vector_slot (trie->others, i);
+      if (cmd_descvec_filter (command, child->descvec, strict, match_type))
+	vector_set (next, child);
+    }
+}
 
-		      match++;
-		    }
-		  break;
-#endif /* HAVE_IPV6 */
-		case ipv4_match:
-		  if (CMD_IPV4 (str))
-		    match++;
-		  break;
-		case ipv4_prefix_match:
-		  if ((ret = cmd_ipv4_prefix_match (command)) != no_match)
-		    {
-		      if (ret == partly_match)
-			return 2;	/* There is incomplete match. */
+/* Match the words of VLINE down the command trie ROOT.  Returns
+   CMD_SUCCESS with the only matching command in *MATCHED, or the same
+   error as matching against the node's command vector. */
+static int
+cmd_trie_match (struct cmd_trie *root, vector vline, int strict,
+		struct cmd_element **matched)
+{
+  unsigned int i, index;
+  vector active, next;
+  struct cmd_trie *trie;
+  enum match_type match = no_match;
+  unsigned int matched_count, incomplete_count;
+  const char *matched_str;
+  char *command;
+  int keep;
+  int ret;
 
-		      match++;
-		    }
-		  break;
-		case extend_match:
-		  if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    match++;
-		  break;
-		case no_match:
-		default:
-		  break;
-		}
-	    }
-	if (!match)
-	  vector_slot (v, i) = NULL;
+  active = vector_init (VECTOR_MIN_SIZE);
+  vector_set (active, root);
+
+  for (index = 0; index < vector_active (vline); index++)
+    {
+      command = vector_slot (vline, index);
+
+      match = no_match;
+      next = vector_init (VECTOR_MIN_SIZE);
+      for (i = 0; i < vector_active (active); i++)
+	if ((trie = vector_slot (active, i)) != NULL)
+	  cmd_trie_filter (trie, command, strict, &match, next);
+      vector_free (active);
+      active = next;
+
+      /* If command meets '.VARARG' then finish matching. */
+      if (match == vararg_match)
+	break;
+
+      matched_str = NULL;
+      for (i = 0; i < vector_active (active); i++)
+	if ((trie = vector_slot (active, i)) != NULL)
+	  {
+	    ret = cmd_descvec_ambiguous (command, trie->descvec, match,
+					 &matched_str, &keep);
+	    if (ret)
+	      {
+		vector_free (active);
+		return ret == 1 ? CMD_ERR_AMBIGUOUS : CMD_ERR_NO_MATCH;
+	      }
+	    if (!keep)
+	      vector_slot (active, i) = NULL;
+	  }
+    }
+
+  /* Check matched count. */
+  *matched = NULL;
+  matched_count = 0;
+  incomplete_count = 0;
+
+  for (i = 0; i < vector_active (active); i++)
+    if ((trie = vector_slot (active, i)) != NULL)
+      {
+	if (match == vararg_match)
+	  {
+	    matched_count += trie->complete + trie->incomplete;
+	    *matched = trie->any;
+	  }
+	else
+	  {
+	    if (trie->complete)
+	      *matched = trie->element;
+	    matched_count += trie->complete;
+	    incomplete_count += trie->incomplete;
+	  }
       }
-  return 0;
+
+  vector_free (active);
+
+  /* To execute command, matched_count must be 1. */
+  if (matched_count == 0)
+    {
+      if (incomplete_count)
+	return CMD_ERR_INCOMPLETE;
+      else
+	return CMD_ERR_NO_MATCH;
+    }
+
+  if (matched_count > 1)
+    return CMD_ERR_AMBIGUOUS;
+
+  return CMD_SUCCESS;
 }
 
 /* If src matches dst return dst string, otherwise return NULL */
@@ -1991,33 +2219,30 @@ node_parent ( enum node_type node )
   return ret;
 }
 
-/* Execute command by argument vline vector. */
+/* Match VLINE against each command of vector V, one word at a time. */
 static int
-cmd_execute_command_real (vector vline, struct vty *vty,
-			  struct cmd_element **cmd)
+cmd_vector_match (vector v, vector vline, int strict,
+		  struct cmd_element **matched)
 {
   unsigned int i;
   unsigned int index;
   vector cmd_vector;
   struct cmd_element *cmd_element;
-  struct cmd_element *matched_element;
   unsigned int matched_count, incomplete_count;
-  int argc;
-  const char *argv[CMD_ARGC_MAX];
   enum match_type match = 0;
-  int varflag;
   char *command;
 
   /* Make copy of command elements. */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
+  cmd_vector = vector_copy (v);
 
   for (index = 0; index < vector_active (vline); index++)
     if ((command = vector_slot (vline, index)))
       {
 	int ret;
 
-	match = cmd_filter_by_completion (command, cmd_vector, index);
+	match = cmd_filter_vector (command, cmd_vector, index, strict);
 
+	/* If command meets '.VARARG' then finish matching. */
 	if (match == vararg_match)
 	  break;
         
@@ -2036,7 +2261,7 @@ cmd_execute_command_real (vector vline, struct vty *vty,
       }
 
   /* Check matched count. */
-  matched_element = NULL;
+  *matched = NULL;
   matched_count = 0;
   incomplete_count = 0;
 
@@ -2045,7 +2270,7 @@ cmd_execute_command_real (vector vline, struct vty *vty,
       {
 	if (match == vararg_match || index >= cmd_element->cmdsize)
 	  {
-	    matched_element = cmd_element;
+	    *matched = cmd_element;
 #if 0
 	    printf ("DEBUG: %s\n", cmd_element->sstring);
 #endif
@@ -2072,6 +2297,46 @@ cmd_execute_command_real (vector vline, struct vty *vty,
   if (matched_count > 1)
     return CMD_ERR_AMBIGUOUS;
 
+  return CMD_SUCCESS;
+}
+
+/* Find the one command of NODE matching VLINE.  STRICT is for
+   configuration files, where keywords are not abbreviated. */
+static int
+cmd_match_command (vector vline, enum node_type node, int strict,
+		   struct cmd_element **matched)
+{
+  struct cmd_node *cnode = vector_slot (cmdvec, node);
+  unsigned int i;
+
+  /* The trie walks every word; leave a line with gaps to the vector
+     matcher, which skips them. */
+  for (i = 0; i < vector_active (vline); i++)
+    if (vector_slot (vline, i) == NULL)
+      break;
+
+  if (cnode->trie && vector_active (vline) && i == vector_active (vline))
+    return cmd_trie_match (cnode->trie, vline, strict, matched);
+
+  return cmd_vector_match (cnode->cmd_vector, vline, strict, matched);
+}
+
+/* Execute command by argument vline vector. */
+static int
+cmd_execute_command_real (vector vline, struct vty *vty,
+			  struct cmd_element **cmd)
+{
+  unsigned int i;
+  struct cmd_element *matched_element;
+  int argc;
+  const char *argv[CMD_ARGC_MAX];
+  int varflag;
+  int ret;
+
+  ret = cmd_match_command (vline, vty->node, 0, &matched_element);
+  if (ret != CMD_SUCCESS)
+    return ret;
+
   /* Argument treatment */
   varflag = 0;
   argc = 0;
@@ -2176,77 +2441,15 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
 			    struct cmd_element **cmd)
 {
   unsigned int i;
-  unsigned int index;
-  vector cmd_vector;
-  struct cmd_element *cmd_element;
   struct cmd_element *matched_element;
-  unsigned int matched_count, incomplete_count;
   int argc;
   const char *argv[CMD_ARGC_MAX];
   int varflag;
-  enum match_type match = 0;
-  char *command;
-
-  /* Make copy of command element */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
-
-  for (index = 0; index < vector_active (vline); index++)
-    if ((command = vector_slot (vline, index)))
-      {
-	int ret;
-	
-	match = cmd_filter_by_string (vector_slot (vline, index),
-				      cmd_vector, index);
-
-	/* If command meets '.VARARG' then finish matching. */
-	if (match == vararg_match)
-	  break;
-        
-	ret = is_cmd_ambiguous (command, cmd_vector, index, match);
-	if (ret == 1)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_AMBIGUOUS;
-	  }
-	if (ret == 2)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_NO_MATCH;
-	  }
-      }
-
-  /* Check matched count. */
-  matched_element = NULL;
-  matched_count = 0;
-  incomplete_count = 0;
-  for (i = 0; i < vector_active (cmd_vector); i++)
-    if (vector_slot (cmd_vector, i) != NULL)
-      {
-	cmd_element = vector_slot (cmd_vector, i);
-
-	if (match == vararg_match || index >= cmd_element->cmdsize)
-	  {
-	    matched_element = cmd_element;
-	    matched_count++;
-	  }
-	else
-	  incomplete_count++;
-      }
-
-  /* Finish of using cmd_vector. */
-  vector_free (cmd_vector);
-
-  /* To execute command, matched_count must be 1. */
-  if (matched_count == 0)
-    {
-      if (incomplete_count)
-	return CMD_ERR_INCOMPLETE;
-      else
-	return CMD_ERR_NO_MATCH;
-    }
+  int ret;
 
-  if (matched_count > 1)
-    return CMD_ERR_AMBIGUOUS;
+  ret = cmd_match_command (vline, vty->node, 1, &matched_element);
+  if (ret != CMD_SUCCESS)
+    return ret;
 
   /* Argument treatment */
   varflag = 0;
@@ -3126,6 +3329,19 @@ DEFUN (show_logging,
   	   (zl->record_priority ? "enabled" : "disabled"), VTY_NEWLINE);
   vty_out (vty, "Timestamp precision: %d%s",
 	   zl->timestamp_precision, VTY_NEWLINE);
+  vty_out (vty, "Log buffer: ");
+  if (zl->ring_size == 0)
+    vty_out (vty, "disabled");
+  else
+    vty_out (vty, "%u entries, %u waiting",
+	     zl->ring_size, zl->ring_head - zl->ring_tail);
+  vty_out (vty, ", %lu dropped%s", zl->dropped, VTY_NEWLINE);
+  vty_out (vty, "Rate limit: ");
+  if (zl->rate_limit == 0)
+    vty_out (vty, "disabled");
+  else
+    vty_out (vty, "%u per second per message", zl->rate_limit);
+  vty_out (vty, ", %lu suppressed%s", zl->suppressed, VTY_NEWLINE);
 
   return CMD_SUCCESS;
 }
@@ -3481,6 +3697,70 @@ DEFUN (no_config_log_timestamp_precision,
   return CMD_SUCCESS;
 }
 
+DEFUN (config_log_buffered,
+       config_log_buffered_cmd,
+       "log buffered <16-65536>",
+       "Logging control\n"
+       "Write informational and debug messages after each event\n"
+       "Number of messages kept until then\n")
+{
+  u_int size;
+
+  VTY_GET_INTEGER_RANGE ("log buffer size", size, argv[0], 16, 65536);
+  zlog_set_buffer (NULL, size);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_config_log_buffered,
+       no_config_log_buffered_cmd,
+       "no log buffered",
+       NO_STR
+       "Logging control\n"
+       "Write every message at once\n")
+{
+  zlog_set_buffer (NULL, 0);
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_config_log_buffered,
+       no_config_log_buffered_val_cmd,
+       "no log buffered <16-65536>",
+       NO_STR
+       "Logging control\n"
+       "Write every message at once\n"
+       "Number of messages kept until then\n")
+
+DEFUN (config_log_rate_limit,
+       config_log_rate_limit_cmd,
+       "log rate-limit <1-100000>",
+       "Logging control\n"
+       "Limit the messages logged from one place in the code\n"
+       "Messages per second\n")
+{
+  VTY_GET_INTEGER_RANGE ("log rate limit", zlog_default->rate_limit,
+			 argv[0], 1, 100000);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_config_log_rate_limit,
+       no_config_log_rate_limit_cmd,
+       "no log rate-limit",
+       NO_STR
+       "Logging control\n"
+       "Do not limit the messages logged from one place in the code\n")
+{
+  zlog_default->rate_limit = 0;
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_config_log_rate_limit,
+       no_config_log_rate_limit_val_cmd,
+       "no log rate-limit <1-100000>",
+       NO_STR
+       "Logging control\n"
+       "Do not limit the messages logged from one place in the code\n"
+       "Messages per second\n")
+
 DEFUN (banner_motd_file,
        banner_motd_file_cmd,
        "banner motd file [FILE]",
@@ -3638,6 +3918,12 @@ cmd_init (int terminal)
       install_element (CONFIG_NODE, &no_config_log_record_priority_cmd);
       install_element (CONFIG_NODE, &config_log_timestamp_precision_cmd);
       install_element (CONFIG_NODE, &no_config_log_timestamp_precision_cmd);
+      install_element (CONFIG_NODE, &config_log_buffered_cmd);
+      install_element (CONFIG_NODE, &no_config_log_buffered_cmd);
+      install_element (CONFIG_NODE, &no_config_log_buffered_val_cmd);
+      install_element (CONFIG_NODE, &config_log_rate_limit_cmd);
+      install_element (CONFIG_NODE, &no_config_log_rate_limit_cmd);
+      install_element (CONFIG_NODE, &no_config_log_rate_limit_val_cmd);
       install_element (CONFIG_NODE, &service_password_encrypt_cmd);
       install_element (CONFIG_NODE, &no_service_password_encrypt_cmd);
       install_element (CONFIG_NODE, &banner_motd_default_cmd);
@@ -3646,8 +3932,19 @@ cmd_init (int terminal)
       install_element (CONFIG_NODE, &service_terminal_length_cmd);
       install_element (CONFIG_NODE, &no_service_terminal_length_cmd);
 
+      install_element (CONFIG_NODE, &thread_slow_threshold_cmd);
+      install_element (CONFIG_NODE, &no_thread_slow_threshold_cmd);
+
       install_element (VIEW_NODE, &show_thread_cpu_cmd);
       install_element (ENABLE_NODE, &show_thread_cpu_cmd);
+      install_element (VIEW_NODE, &show_thread_latency_cmd);
+      install_element (ENABLE_NODE, &show_thread_latency_cmd);
+      install_element (ENABLE_NODE, &clear_thread_cpu_cmd);
+#ifdef HAVE_OMNIORB
+      install_element (VIEW_NODE, &show_thread_lock_cmd);
+      install_element (ENABLE_NODE, &show_thread_lock_cmd);
+      install_element (ENABLE_NODE, &clear_thread_lock_cmd);
+#endif /* HAVE_OMNIORB */
       install_element (VIEW_NODE, &show_work_queues_cmd);
       install_element (ENABLE_NODE, &show_work_queues_cmd);
     }
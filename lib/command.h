@@ -137,6 +137,9 @@ struct cmd_node
 
   /* Vector of this node's command list. */
   vector cmd_vector;	
+
+  /* The same commands compiled into a token trie for matching. */
+  struct cmd_trie *trie;
 };
 
 enum
@@ -188,3 +188,223 @@ hash_free (struct hash *hash)
   XFREE (MTYPE_HASH_INDEX, hash->index);
   XFREE (MTYPE_HASH, hash);
 }
+
+/* Marks a released slot of an open-addressing hash.  */
+static char ohash_deleted;
+#define OHASH_DELETED ((void *) &ohash_deleted)
+
+/* Spread the caller's key over all bits, many key functions return
+   pointers or small integers.  */
+static inline unsigned int
+ohash_mix (unsigned int key)
+{
+  key ^= key >> 16;
+  key *= 0x85ebca6b;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35;
+  key ^= key >> 16;
+  return key;
+}
+
+/* Allocate a new open-addressing hash with room for at least size
+   slots.  */
+struct ohash *
+ohash_create_size (unsigned int size, unsigned int (*hash_key) (void *),
+                   int (*hash_cmp) (void *, void *))
+{
+  struct ohash *hash;
+  unsigned int n;
+
+  for (n = OHASH_INITSIZE; n < size; n <<= 1)
+    ;
+
+  hash = XCALLOC (MTYPE_OHASH, sizeof (struct ohash));
+  hash->slots = XCALLOC (MTYPE_OHASH_SLOTS, sizeof (struct ohash_slot) * n);
+  hash->size = n;
+  hash->hash_key = hash_key;
+  hash->hash_cmp = hash_cmp;
+
+  return hash;
+}
+
+struct ohash *
+ohash_create (unsigned int (*hash_key) (void *),
+              int (*hash_cmp) (void *, void *))
+{
+  return ohash_create_size (OHASH_INITSIZE, hash_key, hash_cmp);
+}
+
+/* First never used slot on the probe sequence of key.  */
+static struct ohash_slot *
+ohash_free_slot (struct ohash *hash, unsigned int key)
+{
+  unsigned int mask = hash->size - 1;
+  unsigned int i;
+
+  for (i = ohash_mix (key) & mask; hash->slots[i].data; i = (i + 1) & mask)
+    ;
+  return &hash->slots[i];
+}
+
+/* Rehash into a new slot array, dropping tombstones.  The table only
+   grows when at least half of the slots hold live entries, otherwise
+   it is rebuilt at the same size.  */
+static void
+ohash_resize (struct ohash *hash)
+{
+  struct ohash_slot *old = hash->slots;
+  unsigned int old_size = hash->size;
+  unsigned int i;
+
+  if (hash->count * 2 >= hash->size)
+    hash->size <<= 1;
+
+  hash->slots = XCALLOC (MTYPE_OHASH_SLOTS,
+                         sizeof (struct ohash_slot) * hash->size);
+  for (i = 0; i < old_size; i++)
+    if (old[i].data && old[i].data != OHASH_DELETED)
+      *ohash_free_slot (hash, old[i].key) = old[i];
+  hash->used = hash->count;
+
+  XFREE (MTYPE_OHASH_SLOTS, old);
+}
+
+/* Same contract as hash_get(): return the entry matching data, or if
+   there is none and alloc_func is given, insert its result.  */
+void *
+ohash_get (struct ohash *hash, void *data, void * (*alloc_func) (void *))
+{
+  unsigned int key;
+  unsigned int mask;
+  unsigned int i;
+  void *newdata;
+  struct ohash_slot *slot;
+  struct ohash_slot *tomb = NULL;
+
+  key = (*hash->hash_key) (data);
+  mask = hash->size - 1;
+
+  for (i = ohash_mix (key) & mask; ; i = (i + 1) & mask)
+    {
+      slot = &hash->slots[i];
+      if (slot->data == NULL)
+	break;
+      if (slot->data == OHASH_DELETED)
+	{
+	  if (tomb == NULL)
+	    tomb = slot;
+	}
+      else if (slot->key == key && (*hash->hash_cmp) (slot->data, data))
+	return slot->data;
+    }
+
+  if (alloc_func == NULL)
+    return NULL;
+
+  newdata = (*alloc_func) (data);
+  if (newdata == NULL)
+    return NULL;
+
+  if (tomb)
+    slot = tomb;
+  else if (hash->used + 1 > hash->size - hash->size / 4)
+    {
+      ohash_resize (hash);
+      slot = ohash_free_slot (hash, key);
+      hash->used++;
+    }
+  else
+    hash->used++;
+
+  slot->key = key;
+  slot->data = newdata;
+  hash->count++;
+  return newdata;
+}
+
+void *
+ohash_lookup (struct ohash *hash, void *data)
+{
+  return ohash_get (hash, data, NULL);
+}
+
+/* Remove the entry matching data and return it.  The slot becomes a
+   tombstone, nothing is moved, which keeps a running ohash_iterate()
+   valid.  */
+void *
+ohash_release (struct ohash *hash, void *data)
+{
+  unsigned int key;
+  unsigned int mask;
+  unsigned int i;
+  void *ret;
+  struct ohash_slot *slot;
+
+  key = (*hash->hash_key) (data);
+  mask = hash->size - 1;
+
+  for (i = ohash_mix (key) & mask; ; i = (i + 1) & mask)
+    {
+      slot = &hash->slots[i];
+      if (slot->data == NULL)
+	return NULL;
+      if (slot->data != OHASH_DELETED
+	  && slot->key == key && (*hash->hash_cmp) (slot->data, data))
+	break;
+    }
+
+  ret = slot->data;
+  slot->data = OHASH_DELETED;
+  hash->count--;
+
+  /* Last entry gone, every slot can be reused without a rehash.  */
+  if (hash->count == 0)
+    {
+      memset (hash->slots, 0, sizeof (struct ohash_slot) * hash->size);
+      hash->used = 0;
+    }
+  return ret;
+}
+
+/* Call func for every entry.  func may release entries, including the
+   current one, but must not insert.  */
+void
+ohash_iterate (struct ohash *hash, void (*func) (void *, void *), void *arg)
+{
+  unsigned int i;
+  void *data;
+
+  for (i = 0; i < hash->size; i++)
+    {
+      data = hash->slots[i].data;
+      if (data && data != OHASH_DELETED)
+	(*func) (data, arg);
+    }
+}
+
+/* Remove all entries, calling free_func on each of them.  */
+void
+ohash_clean (struct ohash *hash, void (*free_func) (void *))
+{
+  unsigned int i;
+  void *data;
+
+  if (free_func)
+    for (i = 0; i < hash->size; i++)
+      {
+	data = hash->slots[i].data;
+	if (data && data != OHASH_DELETED)
+	  (*free_func) (data);
+      }
+
+  memset (hash->slots, 0, sizeof (struct ohash_slot) * hash->size);
+  hash->count = 0;
+  hash->used = 0;
+}
+
+void
+ohash_free (struct ohash *hash)
+{
+  XFREE (MTYPE_OHASH_SLOTS, hash->slots);
+  XFREE (MTYPE_OHASH, hash);
+}
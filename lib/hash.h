@@ -74,6 +74,60 @@ extern void hash_iterate (struct hash *,
 extern void hash_clean (struct hash *, void (*) (void *));
 extern void hash_free (struct hash *);
 
+/* Open-addressing hash.  Data pointers and their hash keys are kept
+   directly in a power-of-two slot array and collisions are resolved by
+   linear probing, so a lookup touches a few adjacent slots instead of
+   walking a chain of separately allocated backets.  The table doubles
+   once it is 3/4 full.  Released entries leave a tombstone behind, so
+   the ohash_iterate() callback may release any entry, but it must not
+   add new ones.  */
+#define OHASH_INITSIZE  16
+
+struct ohash_slot
+{
+  /* Hash key.  */
+  unsigned int key;
+
+  /* Data, NULL for a never used slot.  */
+  void *data;
+};
+
+struct ohash
+{
+  /* Slot array. */
+  struct ohash_slot *slots;
+
+  /* Number of slots, always a power of two.  */
+  unsigned int size;
+
+  /* Live entries.  */
+  unsigned long count;
+
+  /* Live entries plus tombstones.  */
+  unsigned long used;
+
+  /* Key make function. */
+  unsigned int (*hash_key) (void *);
+
+  /* Data compare function. */
+  int (*hash_cmp) (void *, void *);
+};
+
+extern struct ohash *ohash_create (unsigned int (*) (void *),
+                                   int (*) (void *, void *));
+extern struct ohash *ohash_create_size (unsigned int,
+                                        unsigned int (*) (void *),
+                                        int (*) (void *, void *));
+
+extern void *ohash_get (struct ohash *, void *, void * (*) (void *));
+extern void *ohash_lookup (struct ohash *, void *);
+extern void *ohash_release (struct ohash *, void *);
+
+extern void ohash_iterate (struct ohash *, void (*) (void *, void *), void *);
+
+extern void ohash_clean (struct ohash *, void (*) (void *));
+extern void ohash_free (struct ohash *);
+
 #ifdef __cplusplus
 }
 #endif
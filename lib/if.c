@@ -130,9 +130,10 @@ del_te_SRLG_id(void *value)
 
 #endif /*GMPLS*/
 
-/* Create new interface structure. */
+/* Create new interface structure, not linked into iflist.  Free it
+   with if_delete_retain() and XFREE. */
 struct interface *
-if_create (const char *name, int namelen)
+if_new (const char *name, int namelen)
 {
   struct interface *ifp;
 
@@ -143,11 +144,6 @@ if_create (const char *name, int namelen)
   assert (namelen <= INTERFACE_NAMSIZ);	/* Need space for '\0' at end. */
   strncpy (ifp->name, name, namelen);
   ifp->name[namelen] = '\0';
-  if (if_lookup_by_name(ifp->name) == NULL)
-    listnode_add_sort (iflist, ifp);
-  else
-    zlog_err("if_create(%s): corruption detected -- interface with this "
-	     "name exists already!", ifp->name);
   ifp->connected = list_new ();
   ifp->connected->del = (void (*) (void *)) connected_free;
   #ifdef GMPLS
@@ -166,6 +162,21 @@ if_create (const char *name, int namelen)
   return ifp;
 }
 
+/* Create new interface structure. */
+struct interface *
+if_create (const char *name, int namelen)
+{
+  struct interface *ifp;
+
+  ifp = if_new (name, namelen);
+  if (if_lookup_by_name(ifp->name) == NULL)
+    listnode_add_sort (iflist, ifp);
+  else
+    zlog_err("if_create(%s): corruption detected -- interface with this "
+	     "name exists already!", ifp->name);
+  return ifp;
+}
+
 struct interface *
 if_create_level1 (const char *name, int namelen)
 {
@@ -286,6 +286,7 @@ struct connected
 
 /* Prototypes. */
 extern int if_cmp_func (struct interface *, struct interface *);
+extern struct interface *if_new (const char *name, int namelen);
 extern struct interface *if_create (const char *name, int namelen);
 extern struct interface *if_create_level1 (const char *name, int namelen);
 extern struct interface *if_lookup_by_index (unsigned int);
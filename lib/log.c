@@ -31,9 +31,48 @@
 #ifndef SUNOS_5
 #include <sys/un.h>
 #endif
+#if HAVE_OMNIORB
+#include <pthread.h>
+#endif /* HAVE_OMNIORB */
 
 static int logfile_fd = -1;	/* Used in signal handler. */
 
+#if HAVE_OMNIORB
+/* CORBA servants log from the ORB's worker threads, some of them before
+   taking the stack lock, so the log ring and the rate limit table have
+   a lock of their own.  It is recursive: logging a suppression count
+   or flushing the ring goes through vzlog() again. */
+static pthread_mutex_t zlog_mutex;
+static pthread_once_t zlog_mutex_once = PTHREAD_ONCE_INIT;
+
+static void
+zlog_mutex_init (void)
+{
+  pthread_mutexattr_t attr;
+
+  pthread_mutexattr_init (&attr);
+  pthread_mutexattr_settype (&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init (&zlog_mutex, &attr);
+  pthread_mutexattr_destroy (&attr);
+}
+
+static void
+zlog_lock (void)
+{
+  pthread_once (&zlog_mutex_once, zlog_mutex_init);
+  pthread_mutex_lock (&zlog_mutex);
+}
+
+static void
+zlog_unlock (void)
+{
+  pthread_mutex_unlock (&zlog_mutex);
+}
+#else
+#define zlog_lock()
+#define zlog_unlock()
+#endif /* HAVE_OMNIORB */
+
 struct zlog *zlog_default = NULL;
 
 const char *zlog_proto_names[] = 
@@ -75,20 +114,50 @@ const char *zlog_priority[] =
   
 
 
+/* Longest message kept in the log ring, longer ones are truncated. */
+#define ZLOG_ENTRY_SIZE 1024
+
+/* A message waiting in the log ring. */
+struct zlog_entry
+{
+  struct timeval clock;
+  int priority;
+  char msg[ZLOG_ENTRY_SIZE];
+};
+
+/* Per call site state of the rate limit.  Call sites are told apart by
+   their format string, which may sit in any of ZLOG_RATE_WAYS slots
+   following its hash. */
+#define ZLOG_RATE_SLOTS 256
+#define ZLOG_RATE_WAYS 4
+
+static struct zlog_rate
+{
+  const char *format;
+  int priority;
+  time_t second;
+  u_int count;
+  u_long suppressed;
+} zlog_rate[ZLOG_RATE_SLOTS];
+
+/* Slots with suppressed messages not reported yet. */
+static u_int zlog_rate_pending;
+
+/* Set while a suppression count is being logged. */
+static int zlog_rate_reporting;
+  
+
 /* For time string format. */
 
-size_t
-quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
+static size_t
+quagga_timestamp_clock(int timestamp_precision, struct timeval clock,
+		       char *buf, size_t buflen)
 {
   static struct {
     time_t last;
     size_t len;
     char buf[28];
   } cache;
-  struct timeval clock;
-
-  /* would it be sufficient to use global 'recent_time' here?  I fear not... */
-  gettimeofday(&clock, NULL);
 
   /* first, we update the cache if the time has changed */
   if (cache.last != clock.tv_sec)
@@ -138,6 +207,17 @@ quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
   return 0;
 }
 
+size_t
+quagga_timestamp(int timestamp_precision, char *buf, size_t buflen)
+{
+  struct timeval clock;
+
+  /* would it be sufficient to use global 'recent_time' here?  I fear not... */
+  gettimeofday(&clock, NULL);
+
+  return quagga_timestamp_clock(timestamp_precision, clock, buf, buflen);
+}
+
 /* Utility routine for current time printing. */
 static void
 time_print(FILE *fp, struct timestamp_control *ctl)
@@ -151,9 +231,255 @@ time_print(FILE *fp, struct timestamp_control *ctl)
 }
   
 
-/* va_list version of zlog. */
+/* Log how many messages of a rate limit slot were suppressed, and
+   clear the count. */
 static void
-vzlog (struct zlog *zl, int priority, const char *format, va_list args)
+zlog_rate_report (struct zlog *zl, struct zlog_rate *rate)
+{
+  const char *format = rate->format;
+  u_long suppressed = rate->suppressed;
+
+  rate->suppressed = 0;
+  zlog_rate_pending--;
+
+  zlog_rate_reporting = 1;
+  zlog (zl, rate->priority, "%lu messages suppressed by the rate limit: %s",
+	suppressed, format);
+  zlog_rate_reporting = 0;
+}
+
+/* Report the slots whose second is over. */
+static void
+zlog_rate_flush (struct zlog *zl)
+{
+  time_t now;
+  int i;
+
+  now = time (NULL);
+  for (i = 0; i < ZLOG_RATE_SLOTS && zlog_rate_pending; i++)
+    if (zlog_rate[i].suppressed && zlog_rate[i].second != now)
+      zlog_rate_report (zl, &zlog_rate[i]);
+}
+
+/* Check the rate limit of the call site printing FORMAT.  Returns 1 if
+   the message is to be suppressed. */
+static int
+zlog_rate_exceeded (struct zlog *zl, int priority, const char *format)
+{
+  struct zlog_rate *rate;
+  struct zlog_rate *slot;
+  time_t now;
+  u_int hash;
+  int i;
+
+  hash = (u_int) (((unsigned long) format >> 2) % ZLOG_RATE_SLOTS);
+  now = time (NULL);
+
+  /* Look for the slot of FORMAT, else take an empty or the oldest one. */
+  rate = NULL;
+  for (i = 0; i < ZLOG_RATE_WAYS; i++)
+    {
+      slot = &zlog_rate[(hash + i) % ZLOG_RATE_SLOTS];
+      if (slot->format == format)
+	{
+	  rate = slot;
+	  break;
+	}
+      if (rate == NULL || (rate->format && (slot->format == NULL
+					    || slot->second < rate->second)))
+	rate = slot;
+    }
+
+  if (rate->format != format || rate->second != now)
+    {
+      if (rate->suppressed)
+	zlog_rate_report (zl, rate);
+      rate->format = format;
+      rate->priority = priority;
+      rate->second = now;
+      rate->count = 0;
+    }
+
+  if (++rate->count <= zl->rate_limit)
+    return 0;
+
+  if (rate->suppressed++ == 0)
+    zlog_rate_pending++;
+  zl->suppressed++;
+  return 1;
+}
+
+/* Is a message of PRIORITY written anywhere? */
+static int
+zlog_wanted (struct zlog *zl, int priority)
+{
+  return (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG]
+	  || priority <= zl->maxlvl[ZLOG_DEST_STDOUT]
+	  || priority <= zl->maxlvl[ZLOG_DEST_MONITOR]
+	  || (priority <= zl->maxlvl[ZLOG_DEST_FILE] && zl->fp));
+}
+
+/* Format a message into the log ring. */
+static void
+zlog_ring_put (struct zlog *zl, int priority, const char *format,
+	       va_list args)
+{
+  struct zlog_entry *entry;
+
+  if (zl->ring_head - zl->ring_tail >= zl->ring_size)
+    {
+      zl->ring_lost++;
+      zl->dropped++;
+      return;
+    }
+
+  entry = &zl->ring[zl->ring_head % zl->ring_size];
+  gettimeofday (&entry->clock, NULL);
+  entry->priority = priority;
+  vsnprintf (entry->msg, sizeof (entry->msg), format, args);
+  zl->ring_head++;
+}
+
+static void
+zlog_vty_log (struct zlog *zl, int priority, struct timestamp_control *ctl,
+	      const char *format, ...)
+{
+  va_list args;
+
+  va_start (args, format);
+  vty_log ((zl->record_priority ? zlog_priority[priority] : NULL),
+	   zlog_proto_names[zl->protocol], format, ctl, args);
+  va_end (args);
+}
+
+/* Write a message taken from the log ring to its destinations. */
+static void
+zlog_ring_write (struct zlog *zl, struct zlog_entry *entry)
+{
+  struct timestamp_control tsctl;
+  int priority = entry->priority;
+
+  tsctl.precision = zl->timestamp_precision;
+  tsctl.len = quagga_timestamp_clock (tsctl.precision, entry->clock,
+				      tsctl.buf, sizeof (tsctl.buf));
+  tsctl.already_rendered = 1;
+
+  if (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG])
+    syslog (priority|zl->facility, "%s", entry->msg);
+
+  if ((priority <= zl->maxlvl[ZLOG_DEST_FILE]) && zl->fp)
+    {
+      time_print (zl->fp, &tsctl);
+      if (zl->record_priority)
+	fprintf (zl->fp, "%s: ", zlog_priority[priority]);
+      fprintf (zl->fp, "%s: %s\n", zlog_proto_names[zl->protocol],
+	       entry->msg);
+    }
+
+  if (priority <= zl->maxlvl[ZLOG_DEST_STDOUT])
+    {
+      time_print (stdout, &tsctl);
+      if (zl->record_priority)
+	fprintf (stdout, "%s: ", zlog_priority[priority]);
+      fprintf (stdout, "%s: %s\n", zlog_proto_names[zl->protocol],
+	       entry->msg);
+    }
+
+  if (priority <= zl->maxlvl[ZLOG_DEST_MONITOR])
+    zlog_vty_log (zl, priority, &tsctl, "%s", entry->msg);
+}
+
+static void
+zlog_flush_ring (struct zlog *zl)
+{
+  struct zlog_entry note;
+
+  if (zl == NULL)
+    zl = zlog_default;
+
+  if (zl == NULL)
+    return;
+
+  /* The counts are logged into the ring, so written out below. */
+  if (zlog_rate_pending && ! zlog_rate_reporting)
+    zlog_rate_flush (zl);
+
+  if (zl->ring_head == zl->ring_tail && ! zl->ring_lost)
+    return;
+
+  while (zl->ring_tail != zl->ring_head)
+    {
+      zlog_ring_write (zl, &zl->ring[zl->ring_tail % zl->ring_size]);
+      zl->ring_tail++;
+    }
+
+  if (zl->ring_lost)
+    {
+      gettimeofday (&note.clock, NULL);
+      note.priority = LOG_WARNING;
+      snprintf (note.msg, sizeof (note.msg),
+		"%lu log messages dropped, the log buffer was full",
+		zl->ring_lost);
+      zlog_ring_write (zl, &note);
+      zl->ring_lost = 0;
+    }
+
+  if (zl->fp)
+    fflush (zl->fp);
+  fflush (stdout);
+}
+
+void
+zlog_flush (struct zlog *zl)
+{
+  zlog_lock ();
+  zlog_flush_ring (zl);
+  zlog_unlock ();
+}
+
+static void
+zlog_flush_exit (void)
+{
+  zlog_flush (NULL);
+}
+
+void
+zlog_set_buffer (struct zlog *zl, u_int size)
+{
+  static int registered;
+
+  if (zl == NULL)
+    zl = zlog_default;
+
+  zlog_lock ();
+  zlog_flush_ring (zl);
+  if (zl->ring)
+    XFREE (MTYPE_ZLOG_RING, zl->ring);
+  zl->ring = NULL;
+  zl->ring_size = zl->ring_head = zl->ring_tail = 0;
+
+  if (size)
+    {
+      zl->ring = XCALLOC (MTYPE_ZLOG_RING,
+			  size * sizeof (struct zlog_entry));
+      zl->ring_size = size;
+    }
+  zlog_unlock ();
+
+  if (size == 0)
+    return;
+
+  /* Do not lose what is still waiting when the daemon exits. */
+  if (! registered)
+    {
+      atexit (zlog_flush_exit);
+      registered = 1;
+    }
+}
+
+static void
+vzlog_write (struct zlog *zl, int priority, const char *format,
+	     va_list args)
 {
   struct timestamp_control tsctl;
   tsctl.already_rendered = 0;
@@ -177,6 +503,26 @@ vzlog (struct zlog *zl, int priority, const char *format, va_list args)
     }
   tsctl.precision = zl->timestamp_precision;
 
+  if (! zlog_wanted (zl, priority))
+    return;
+
+  if (zl->rate_limit && ! zlog_rate_reporting
+      && zlog_rate_exceeded (zl, priority, format))
+    return;
+
+  /* Informational and debug messages are written once the running
+     thread returns; anything more important goes out at once, after
+     what is already waiting so the order is kept. */
+  if (zl->ring)
+    {
+      if (priority >= LOG_INFO)
+	{
+	  zlog_ring_put (zl, priority, format, args);
+	  return;
+	}
+      zlog_flush_ring (zl);
+    }
+
   /* Syslog output */
   if (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG])
     {
@@ -222,6 +568,15 @@ vzlog (struct zlog *zl, int priority, const char *format, va_list args)
 	     zlog_proto_names[zl->protocol], format, &tsctl, args);
 }
 
+/* va_list version of zlog. */
+static void
+vzlog (struct zlog *zl, int priority, const char *format, va_list args)
+{
+  zlog_lock ();
+  vzlog_write (zl, priority, format, args);
+  zlog_unlock ();
+}
+
 static char *
 str_append(char *dst, int len, const char *src)
 {
@@ -359,6 +714,63 @@ open_crashlog(void)
 #undef CRASHLOG_PREFIX
 }
 
+/* Write out the log ring using only async-signal-safe functions.  The
+   time stamps are given as seconds and microseconds since the epoch,
+   localtime() not being safe here.  Nor is taking zlog_mutex, so this
+   is done without it. */
+static void
+zlog_ring_dump_sigsafe(void)
+{
+  struct zlog *zl = zlog_default;
+  struct zlog_entry *entry;
+  char buf[ZLOG_ENTRY_SIZE+100];
+  char *s;
+  char *msgstart;
+  int priority;
+  long pad;
+#define LOC s,buf+sizeof(buf)-s
+
+  if (!zl || !zl->ring)
+    return;
+
+  while (zl->ring_tail != zl->ring_head)
+    {
+      entry = &zl->ring[zl->ring_tail % zl->ring_size];
+      zl->ring_tail++;
+      priority = entry->priority;
+
+      s = buf;
+      s = num_append(LOC,entry->clock.tv_sec);
+      s = str_append(LOC,".");
+      for (pad = 100000; (pad > 1) && (entry->clock.tv_usec < pad); pad /= 10)
+	s = str_append(LOC,"0");
+      s = num_append(LOC,entry->clock.tv_usec);
+      s = str_append(LOC," ");
+      if (zl->record_priority)
+	{
+	  s = str_append(LOC,zlog_priority[priority]);
+	  s = str_append(LOC,": ");
+	}
+      s = str_append(LOC,zlog_proto_names[zl->protocol]);
+      s = str_append(LOC,": ");
+      msgstart = s;
+      s = str_append(LOC,entry->msg);
+      if (s < buf+sizeof(buf))
+	*s++ = '\n';
+
+      if (((priority <= zl->maxlvl[ZLOG_DEST_FILE]) || !zl->fp) &&
+	  ((logfile_fd >= 0) || ((logfile_fd = open_crashlog()) >= 0)))
+	write(logfile_fd, buf, s-buf);
+      if (priority <= zl->maxlvl[ZLOG_DEST_STDOUT])
+	write(STDOUT_FILENO, buf, s-buf);
+      /* Remove trailing '\n' for syslog */
+      *--s = '\0';
+      if (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG])
+	syslog_sigsafe(priority|zl->facility,msgstart,s-msgstart);
+    }
+#undef LOC
+}
+
 /* Note: the goal here is to use only async-signal-safe functions. */
 void
 zlog_signal(int signo, const char *action
@@ -373,6 +785,9 @@ zlog_signal(int signo, const char *action
   char *msgstart = buf;
 #define LOC s,buf+sizeof(buf)-s
 
+  /* What was logged before the signal goes out first. */
+  zlog_ring_dump_sigsafe();
+
   time(&now);
   if (zlog_default)
     {
@@ -609,6 +1024,8 @@ _zlog_assert_failed (const char *assertion, const char *file,
       ((logfile_fd = open_crashlog()) >= 0) &&
       ((zlog_default->fp = fdopen(logfile_fd, "w")) != NULL))
     zlog_default->maxlvl[ZLOG_DEST_FILE] = LOG_ERR;
+  /* Write out what was buffered before the assertion. */
+  zlog_flush(NULL);
   zlog(NULL, LOG_CRIT, "Assertion `%s' failed in file %s, line %u, function %s",
        assertion,file,line,(function ? function : "?"));
   zlog_backtrace(LOG_CRIT);
@@ -645,6 +1062,7 @@ openzlog (const char *progname, zlog_proto_t protocol,
 void
 closezlog (struct zlog *zl)
 {
+  zlog_set_buffer (zl, 0);
   closelog();
   fclose (zl->fp);
 
@@ -845,6 +1263,7 @@ static const struct zebra_desc_table command_types[] = {
   DESC_ENTRY	(ZEBRA_ROUTER_ID_ADD),
   DESC_ENTRY	(ZEBRA_ROUTER_ID_DELETE),
   DESC_ENTRY	(ZEBRA_ROUTER_ID_UPDATE),
+  DESC_ENTRY	(ZEBRA_IPV4_ROUTE_BULK),
 };
 #undef DESC_ENTRY
 
@@ -890,7 +1309,8 @@ zebra_route_char(u_int zroute)
 const char *
 zserv_command_string (unsigned int command)
 {
-  if (command >= sizeof(command_types)/sizeof(command_types[0]))
+  if (command >= sizeof(command_types)/sizeof(command_types[0])
+      || command_types[command].string == NULL)
     {
       zlog_err ("unknown zserv command type: %u", command);
       return unknown.string;
@@ -100,6 +100,18 @@ struct zlog
   			   priority of the message? */
   int syslog_options;	/* 2nd arg to openlog */
   int timestamp_precision;	/* # of digits of subsecond precision */
+
+  /* Informational and debug messages wait in this ring until the
+     running thread returns, see zlog_set_buffer(). */
+  struct zlog_entry *ring;
+  u_int ring_size;	/* # of entries, 0 when messages are written at once */
+  u_int ring_head;	/* next entry to fill, free running */
+  u_int ring_tail;	/* next entry to write, free running */
+  u_long ring_lost;	/* dropped since the last note about it */
+  u_long dropped;	/* messages dropped because the ring was full */
+
+  u_int rate_limit;	/* messages per second per call site, 0 if none */
+  u_long suppressed;	/* messages suppressed by the rate limit */
 };
 
 /* Message structure. */
@@ -157,6 +169,14 @@ extern int zlog_reset_file (struct zlog *zl);
 /* Rotate log. */
 extern int zlog_rotate (struct zlog *);
 
+/* Keep up to SIZE informational and debug messages in memory and write
+   them once the running thread returns.  SIZE 0 writes every message
+   at once again. */
+extern void zlog_set_buffer (struct zlog *zl, u_int size);
+
+/* Write out the messages waiting in the ring. */
+extern void zlog_flush (struct zlog *zl);
+
 /* For hackey massage lookup and check */
 #define LOOKUP(x, y) mes_lookup(x, x ## _max, y)
 
@@ -30,10 +30,199 @@
 
 #include "log.h"
 #include "memory.h"
+#include "hash.h"
 
 static void alloc_inc (int);
 static void alloc_dec (int);
 static void log_memstats(int log_priority);
+
+/* Opt-in slab allocator.  Objects of a type registered with
+   memory_slab_enable() are carved from MEMORY_SLAB_SIZE aligned slabs,
+   each with its own free list.  The owning slab of an address is found
+   through a hash of slab base addresses, so objects of the type that
+   were allocated before it was enabled, or that were too large for
+   it, still go back to free().  */
+#define MEMORY_SLAB_SIZE  4096
+#define MEMORY_SLAB_ALIGN 16
+#define MEMORY_SLAB_ROUND(X) \
+  (((X) + MEMORY_SLAB_ALIGN - 1) & ~((size_t) MEMORY_SLAB_ALIGN - 1))
+
+struct mslab
+{
+  /* Slabs with free objects. */
+  struct mslab *next;
+  struct mslab *prev;
+
+  struct mslab_cache *cache;
+
+  /* Free objects, linked through their first word.  */
+  void *free;
+
+  unsigned int inuse;
+};
+
+static struct mslab_cache
+{
+  /* Object size, 0 if the type is not slab allocated.  */
+  size_t size;
+  unsigned int per_slab;
+
+  /* Slabs with at least one free object.  */
+  struct mslab *partial;
+
+  unsigned long slabs;
+  unsigned long live;
+  unsigned long peak;
+} mslab_cache[MTYPE_MAX];
+
+static struct ohash *mslab_index;
+
+static unsigned int
+mslab_index_key (void *slab)
+{
+  return (uintptr_t) slab / MEMORY_SLAB_SIZE;
+}
+
+static int
+mslab_index_cmp (void *a, void *b)
+{
+  return a == b;
+}
+
+static void
+mslab_unlink (struct mslab_cache *c, struct mslab *slab)
+{
+  if (slab->prev)
+    slab->prev->next = slab->next;
+  else
+    c->partial = slab->next;
+  if (slab->next)
+    slab->next->prev = slab->prev;
+  slab->next = slab->prev = NULL;
+}
+
+static void
+mslab_link (struct mslab_cache *c, struct mslab *slab)
+{
+  slab->prev = NULL;
+  slab->next = c->partial;
+  if (c->partial)
+    c->partial->prev = slab;
+  c->partial = slab;
+}
+
+static struct mslab *
+mslab_new (struct mslab_cache *c)
+{
+  struct mslab *slab;
+  char *obj;
+  unsigned int i;
+  void *mem;
+
+  if (posix_memalign (&mem, MEMORY_SLAB_SIZE, MEMORY_SLAB_SIZE))
+    return NULL;
+
+  slab = mem;
+  slab->cache = c;
+  slab->inuse = 0;
+  slab->free = NULL;
+  obj = (char *) slab + MEMORY_SLAB_ROUND (sizeof (struct mslab));
+  for (i = 0; i < c->per_slab; i++, obj += c->size)
+    {
+      *(void **) obj = slab->free;
+      slab->free = obj;
+    }
+
+  ohash_get (mslab_index, slab, hash_alloc_intern);
+  mslab_link (c, slab);
+  c->slabs++;
+  return slab;
+}
+
+static void *
+mslab_alloc (struct mslab_cache *c)
+{
+  struct mslab *slab;
+  void *obj;
+
+  if ((slab = c->partial) == NULL
+      && (slab = mslab_new (c)) == NULL)
+    return NULL;
+
+  obj = slab->free;
+  slab->free = *(void **) obj;
+  slab->inuse++;
+  if (slab->free == NULL)
+    mslab_unlink (c, slab);
+
+  if (++c->live > c->peak)
+    c->peak = c->live;
+  return obj;
+}
+
+/* Owning slab of ptr, NULL if it came from malloc().  */
+static struct mslab *
+mslab_find (void *ptr)
+{
+  uintptr_t base;
+
+  if (mslab_index == NULL || ptr == NULL)
+    return NULL;
+
+  base = (uintptr_t) ptr & ~((uintptr_t) MEMORY_SLAB_SIZE - 1);
+  return ohash_lookup (mslab_index, (void *) base);
+}
+
+static void
+mslab_free (struct mslab *slab, void *ptr)
+{
+  struct mslab_cache *c = slab->cache;
+
+  if (slab->free == NULL)
+    mslab_link (c, slab);
+  *(void **) ptr = slab->free;
+  slab->free = ptr;
+  slab->inuse--;
+  c->live--;
+
+  /* Give empty slabs back, but keep the last partial one around so a
+     type oscillating around a slab boundary does not thrash.  */
+  if (slab->inuse == 0 && (slab->next || slab->prev))
+    {
+      mslab_unlink (c, slab);
+      ohash_release (mslab_index, slab);
+      free (slab);
+      c->slabs--;
+    }
+}
+
+/* Serve allocations of type up to size bytes from slabs.  Meant for
+   small fixed-size objects that are allocated and freed at high rates,
+   call it once at startup.  */
+void
+memory_slab_enable (int type, size_t size)
+{
+  struct mslab_cache *c;
+  size_t hdr = MEMORY_SLAB_ROUND (sizeof (struct mslab));
+
+  if (type <= 0 || type >= MTYPE_MAX || mslab_cache[type].size)
+    return;
+
+  size = MEMORY_SLAB_ROUND (size);
+  if (size == 0 || size > (MEMORY_SLAB_SIZE - hdr) / 4)
+    {
+      zlog_warn ("memory_slab_enable: objects of type %d (%lu bytes) "
+                 "are too large for a slab", type, (unsigned long) size);
+      return;
+    }
+
+  if (mslab_index == NULL)
+    mslab_index = ohash_create (mslab_index_key, mslab_index_cmp);
+
+  c = &mslab_cache[type];
+  c->size = size;
+  c->per_slab = (MEMORY_SLAB_SIZE - hdr) / size;
+}
 
 static struct message mstr [] =
 {
@@ -66,7 +255,10 @@ zmalloc (int type, size_t size)
 {
   void *memory;
 
-  memory = malloc (size);
+  if (mslab_cache[type].size && size <= mslab_cache[type].size)
+    memory = mslab_alloc (&mslab_cache[type]);
+  else
+    memory = malloc (size);
 
   if (memory == NULL)
     zerror ("malloc", type, size);
@@ -82,7 +274,14 @@ zcalloc (int type, size_t size)
 {
   void *memory;
 
-  memory = calloc (1, size);
+  if (mslab_cache[type].size && size <= mslab_cache[type].size)
+    {
+      memory = mslab_alloc (&mslab_cache[type]);
+      if (memory)
+	memset (memory, 0, size);
+    }
+  else
+    memory = calloc (1, size);
 
   if (memory == NULL)
     zerror ("calloc", type, size);
@@ -97,6 +296,19 @@ void *
 zrealloc (int type, void *ptr, size_t size)
 {
   void *memory;
+  struct mslab *slab;
+
+  if (mslab_cache[type].size && (slab = mslab_find (ptr)) != NULL)
+    {
+      if (size <= slab->cache->size)
+	return ptr;
+      memory = malloc (size);
+      if (memory == NULL)
+	zerror ("realloc", type, size);
+      memcpy (memory, ptr, slab->cache->size);
+      mslab_free (slab, ptr);
+      return memory;
+    }
 
   memory = realloc (ptr, size);
   if (memory == NULL)
@@ -108,8 +320,13 @@ zrealloc (int type, void *ptr, size_t size)
 void
 zfree (int type, void *ptr)
 {
+  struct mslab *slab;
+
   alloc_dec (type);
-  free (ptr);
+  if (mslab_cache[type].size && (slab = mslab_find (ptr)) != NULL)
+    mslab_free (slab, ptr);
+  else
+    free (ptr);
 }
 
 /* String duplication. */
@@ -261,6 +478,20 @@ show_separator(struct vty *vty)
   vty_out (vty, "-----------------------------\r\n");
 }
 
+static void
+show_memory_slab (struct vty *vty, struct mslab_cache *c)
+{
+  unsigned long slots = c->slabs * c->per_slab;
+  char buf[MTYPE_MEMSTR_LEN];
+
+  vty_out (vty, "  slab %lu bytes: live %lu, peak %lu, %lu slabs, "
+           "%lu%% used, %s free in slabs\r\n",
+           (unsigned long) c->size, c->live, c->peak, c->slabs,
+           slots ? c->live * 100 / slots : 0,
+           mtype_memstr (buf, MTYPE_MEMSTR_LEN,
+                         (slots - c->live) * c->size));
+}
+
 static int
 show_memory_vty (struct vty *vty, struct memory_list *list)
 {
@@ -279,6 +510,8 @@ show_memory_vty (struct vty *vty, struct memory_list *list)
     else if (mstat[m->index].alloc)
       {
 	vty_out (vty, "%-30s: %10ld\r\n", m->format, mstat[m->index].alloc);
+	if (mslab_cache[m->index].size)
+	  show_memory_slab (vty, &mslab_cache[m->index]);
 	needsep = 1;
       }
   return needsep;
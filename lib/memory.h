@@ -85,6 +85,7 @@ extern void mtype_zfree (const char *file, int line, int type,
 extern char *mtype_zstrdup (const char *file, int line, int type,
 		            const char *str);
 extern void memory_init (void);
+extern void memory_slab_enable (int type, size_t size);
 
 /* return number of allocations outstanding for the type */
 extern unsigned long mtype_stats_alloc (int);
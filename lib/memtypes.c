@@ -35,6 +35,7 @@ struct memory_list memory_list_lib[] =
   { MTYPE_THREAD_MASTER,            "Thread master"                 },
   { MTYPE_THREAD_STATS,             "Thread stats"                  },
   { MTYPE_THREAD_FUNCNAME,          "Thread function name"          },
+  { MTYPE_THREAD_EPOLL,             "Thread epoll fd table"         },
   { MTYPE_VTY,                      "VTY"                           },
   { MTYPE_VTY_OUT_BUF,              "VTY output buffer"             },
   { MTYPE_VTY_HIST,                 "VTY history"                   },
@@ -52,6 +53,8 @@ struct memory_list memory_list_lib[] =
   { MTYPE_HASH,                     "Hash"                          },
   { MTYPE_HASH_BACKET,              "Hash Bucket"                   },
   { MTYPE_HASH_INDEX,               "Hash Index"                    },
+  { MTYPE_OHASH,                    "Open hash"                     },
+  { MTYPE_OHASH_SLOTS,              "Open hash slots"               },
   { MTYPE_ROUTE_TABLE,              "Route table"                   },
   { MTYPE_ROUTE_NODE,               "Route node"                    },
   { MTYPE_DISTRIBUTE,               "Distribute list"               },
@@ -69,6 +72,7 @@ struct memory_list memory_list_lib[] =
   { MTYPE_ROUTE_MAP_RULE_STR,       "Route map rule str"            },
   { MTYPE_ROUTE_MAP_COMPILED,       "Route map compiled"            },
   { MTYPE_DESC,                     "Command desc"                  },
+  { MTYPE_CMD_TRIE,                 "Command token trie"            },
   { MTYPE_KEY,                      "Key"                           },
   { MTYPE_KEYCHAIN,                 "Key chain"                     },
   { MTYPE_IF_RMAP,                  "Interface route map"           },
@@ -76,6 +80,7 @@ struct memory_list memory_list_lib[] =
   { MTYPE_SOCKUNION,                "Socket union"                  },
   { MTYPE_PRIVS,                    "Privilege information"         },
   { MTYPE_ZLOG,                     "Logging"                       },
+  { MTYPE_ZLOG_RING,                "Logging ring"                  },
   { MTYPE_ZCLIENT,                  "Zclient"                       },
   { MTYPE_WORK_QUEUE,               "Work queue"                    },
   { MTYPE_WORK_QUEUE_ITEM,          "Work queue item"               },
@@ -96,6 +101,7 @@ struct memory_list memory_list_zebra[] =
   { MTYPE_RIB_QUEUE,    "RIB process work queue"  },
   { MTYPE_STATIC_IPV4,    "Static IPv4 route"   },
   { MTYPE_STATIC_IPV6,    "Static IPv6 route"   },
+  { MTYPE_TE_LINK,    "TE-link table entry"   },
   { -1, NULL },
 };
 
@@ -196,11 +202,14 @@ struct memory_list memory_list_ospf[] =
   { MTYPE_OSPF_LSA,                           "OSPF LSA"                        },
   { MTYPE_OSPF_LSA_DATA,                      "OSPF LSA data"                   },
   { MTYPE_OSPF_LSDB,                          "OSPF LSDB"                       },
+  { MTYPE_OSPF_LSDB_AGING,                    "OSPF LSDB aging wheel"           },
   { MTYPE_OSPF_PACKET,                        "OSPF packet"                     },
   { MTYPE_OSPF_FIFO,                          "OSPF FIFO queue"                 },
-  { MTYPE_OSPF_VERTEX,                        "OSPF vertex"                     },
-  { MTYPE_OSPF_VERTEX_PARENT,                 "OSPF vertex parent",             },
-  { MTYPE_OSPF_NEXTHOP,                       "OSPF nexthop"                    },
+  { MTYPE_OSPF_LS_UPD_BATCH,                  "OSPF LS Update batch"            },
+  { MTYPE_OSPF_LS_RXMT_INDEX,                 "OSPF LS rxmt index"              },
+  { MTYPE_OSPF_LS_REQ_INFLIGHT,               "OSPF LS req in flight"           },
+  { MTYPE_OSPF_SPF_ARENA,                     "OSPF SPF arena"                  },
+  { MTYPE_OSPF_SPF_EDGE,                      "OSPF SPF edges"                  },
   { MTYPE_OSPF_PATH,                          "OSPF path"                       },
   { MTYPE_OSPF_VL_DATA,                       "OSPF VL data"                    },
   { MTYPE_OSPF_CRYPT_KEY,                     "OSPF crypt key"                  },
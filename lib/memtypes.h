@@ -21,6 +21,7 @@ enum
   MTYPE_THREAD_MASTER,
   MTYPE_THREAD_STATS,
   MTYPE_THREAD_FUNCNAME,
+  MTYPE_THREAD_EPOLL,
   MTYPE_VTY,
   MTYPE_VTY_OUT_BUF,
   MTYPE_VTY_HIST,
@@ -38,6 +39,8 @@ enum
   MTYPE_HASH,
   MTYPE_HASH_BACKET,
   MTYPE_HASH_INDEX,
+  MTYPE_OHASH,
+  MTYPE_OHASH_SLOTS,
   MTYPE_ROUTE_TABLE,
   MTYPE_ROUTE_NODE,
   MTYPE_DISTRIBUTE,
@@ -55,6 +58,7 @@ enum
   MTYPE_ROUTE_MAP_RULE_STR,
   MTYPE_ROUTE_MAP_COMPILED,
   MTYPE_DESC,
+  MTYPE_CMD_TRIE,
   MTYPE_KEY,
   MTYPE_KEYCHAIN,
   MTYPE_IF_RMAP,
@@ -62,6 +66,7 @@ enum
   MTYPE_SOCKUNION,
   MTYPE_PRIVS,
   MTYPE_ZLOG,
+  MTYPE_ZLOG_RING,
   MTYPE_ZCLIENT,
   MTYPE_WORK_QUEUE,
   MTYPE_WORK_QUEUE_ITEM,
@@ -77,6 +82,7 @@ enum
   MTYPE_RIB_QUEUE,
   MTYPE_STATIC_IPV4,
   MTYPE_STATIC_IPV6,
+  MTYPE_TE_LINK,
   MTYPE_BGP,
   MTYPE_BGP_PEER,
   MTYPE_BGP_PEER_HOST,
@@ -148,11 +154,14 @@ enum
   MTYPE_OSPF_LSA,
   MTYPE_OSPF_LSA_DATA,
   MTYPE_OSPF_LSDB,
+  MTYPE_OSPF_LSDB_AGING,
   MTYPE_OSPF_PACKET,
   MTYPE_OSPF_FIFO,
-  MTYPE_OSPF_VERTEX,
-  MTYPE_OSPF_VERTEX_PARENT,
-  MTYPE_OSPF_NEXTHOP,
+  MTYPE_OSPF_LS_UPD_BATCH,
+  MTYPE_OSPF_LS_RXMT_INDEX,
+  MTYPE_OSPF_LS_REQ_INFLIGHT,
+  MTYPE_OSPF_SPF_ARENA,
+  MTYPE_OSPF_SPF_EDGE,
   MTYPE_OSPF_PATH,
   MTYPE_OSPF_VL_DATA,
   MTYPE_OSPF_CRYPT_KEY,
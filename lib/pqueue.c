@@ -168,3 +168,21 @@ pqueue_dequeue (struct pqueue *queue)
   trickle_down (0, queue);
   return data;
 }
+
+/* Remove the node at index, which the caller tracks through update(). */
+void
+pqueue_remove_at (int index, struct pqueue *queue)
+{
+  /* Removing the last node needs no reordering. */
+  if (index == --queue->size)
+    return;
+
+  queue->array[index] = queue->array[queue->size];
+
+  if (index > 0
+      && (*queue->cmp) (queue->array[index],
+                        queue->array[PARENT_OF (index)]) < 0)
+    trickle_up (index, queue);
+  else
+    trickle_down (index, queue);
+}
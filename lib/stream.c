@@ -882,6 +882,20 @@ stream_reset (struct stream *s)
   s->getp = s->endp = 0;
 }
 
+/* Move the data not read yet to the start of the stream, making room
+   at the end for more. */
+void
+stream_pulldown (struct stream *s)
+{
+  size_t rlen = STREAM_READABLE (s);
+
+  STREAM_VERIFY_SANE (s);
+
+  memmove (s->data, s->data + s->getp, rlen);
+  s->getp = 0;
+  s->endp = rlen;
+}
+
 /* Write stream contens to the file discriptor. */
 int
 stream_flush (struct stream *s, int fd)
@@ -208,6 +208,7 @@ extern size_t stream_write (struct stream *, u_char *, size_t);
 
 /* reset the stream. See Note above */
 extern void stream_reset (struct stream *);
+extern void stream_pulldown (struct stream *);
 extern int stream_flush (struct stream *, int);
 extern int stream_empty (struct stream *); /* is the stream empty? */
 
@@ -27,10 +27,18 @@
 #include "memory.h"
 #include "log.h"
 #include "hash.h"
+#include "pqueue.h"
 #include "command.h"
 #include "sigevent.h"
 #include "corba.h"
 
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+
+/* Events fetched per epoll_wait() call. */
+#define THREAD_EPOLL_EVENTS 64
+#endif /* HAVE_EPOLL */
+
 
 /* Recent absolute time of day */
 struct timeval recent_time;
@@ -42,6 +50,33 @@ static struct timeval relative_time_base;
 static unsigned short timers_inited;
 
 static struct hash *cpu_record = NULL;
+
+/* Callbacks whose wall-clock run time exceeds this many microseconds are
+ * logged, 0 disables the check. */
+#ifdef CONSUMED_TIME_CHECK
+#define THREAD_SLOW_THRESHOLD_DEFAULT CONSUMED_TIME_CHECK
+#else
+#define THREAD_SLOW_THRESHOLD_DEFAULT 0
+#endif /* CONSUMED_TIME_CHECK */
+static unsigned long thread_slow_threshold = THREAD_SLOW_THRESHOLD_DEFAULT;
+
+#ifdef HAVE_OMNIORB
+/* Time spent waiting for stack_mutex before running a callback: totals
+ * since the last reset, plus one slot per second of a rolling window. */
+#define THREAD_LOCK_WINDOW 60
+static struct
+{
+  unsigned long count;
+  unsigned long total;
+  unsigned long max;
+  struct
+  {
+    time_t sec;
+    unsigned long count;
+    unsigned long total;
+  } window[THREAD_LOCK_WINDOW];
+} thread_lock_stats;
+#endif /* HAVE_OMNIORB */
 
 /* Struct timeval's tv_usec one second value.  */
 #define TIMER_SECOND_MICRO 1000000L
@@ -275,7 +310,7 @@ cpu_record_hash_print(struct hash_backet *bucket,
   struct cpu_thread_history *a = bucket->data;
   
   a = bucket->data;
-  if ( !(a->types & *filter) )
+  if ( !(a->types & *filter) || a->total_calls == 0)
        return;
   vty_out_cpu_thread_history(vty,a);
   totals->total_calls += a->total_calls;
@@ -375,6 +410,182 @@ DEFUN(show_thread_cpu,
   cpu_record_print(vty, filter);
   return CMD_SUCCESS;
 }
+
+static void
+cpu_record_hash_latency_print (struct hash_backet *bucket, struct vty *vty)
+{
+  struct cpu_thread_history *a = bucket->data;
+  int i;
+
+  if (a->total_calls == 0)
+    return;
+
+  vty_out (vty, "%s, %u calls%s", a->funcname, a->total_calls, VTY_NEWLINE);
+  for (i = 0; i < THREAD_LATENCY_BUCKETS; i++)
+    {
+      if (a->latency[i] == 0)
+        continue;
+      if (i == THREAD_LATENCY_BUCKETS - 1)
+        vty_out (vty, "  %9lu -           usec %10lu%s",
+                 1UL << (i - 1), a->latency[i], VTY_NEWLINE);
+      else
+        vty_out (vty, "  %9lu - %9lu usec %10lu%s",
+                 i ? 1UL << (i - 1) : 0, (1UL << i) - 1,
+                 a->latency[i], VTY_NEWLINE);
+    }
+}
+
+DEFUN(show_thread_latency,
+      show_thread_latency_cmd,
+      "show thread latency",
+      SHOW_STR
+      "Thread information\n"
+      "Thread wall-clock latency distribution\n")
+{
+  if (thread_slow_threshold)
+    vty_out (vty, "Slow thread threshold %lu ms%s",
+             thread_slow_threshold / 1000, VTY_NEWLINE);
+  else
+    vty_out (vty, "Slow thread threshold disabled%s", VTY_NEWLINE);
+
+  hash_iterate (cpu_record,
+                (void (*) (struct hash_backet *, void *))
+                cpu_record_hash_latency_print,
+                vty);
+  return CMD_SUCCESS;
+}
+
+static void
+cpu_record_hash_clear (struct hash_backet *bucket, void *arg)
+{
+  struct cpu_thread_history *a = bucket->data;
+
+  a->total_calls = 0;
+  memset (&a->real, 0, sizeof (a->real));
+#ifdef HAVE_RUSAGE
+  memset (&a->cpu, 0, sizeof (a->cpu));
+#endif
+  memset (a->latency, 0, sizeof (a->latency));
+}
+
+DEFUN(clear_thread_cpu,
+      clear_thread_cpu_cmd,
+      "clear thread cpu",
+      CLEAR_STR
+      "Thread information\n"
+      "Thread CPU usage and latency statistics\n")
+{
+  hash_iterate (cpu_record, cpu_record_hash_clear, NULL);
+  return CMD_SUCCESS;
+}
+
+DEFUN(config_thread_slow_threshold,
+      thread_slow_threshold_cmd,
+      "thread slow-threshold <1-3600000>",
+      "Thread information\n"
+      "Log callbacks running longer than this\n"
+      "Threshold in milliseconds\n")
+{
+  unsigned long ms;
+
+  VTY_GET_INTEGER_RANGE ("slow-threshold", ms, argv[0], 1, 3600000);
+  thread_slow_threshold = ms * 1000;
+  return CMD_SUCCESS;
+}
+
+DEFUN(no_config_thread_slow_threshold,
+      no_thread_slow_threshold_cmd,
+      "no thread slow-threshold",
+      NO_STR
+      "Thread information\n"
+      "Log callbacks running longer than this\n")
+{
+  thread_slow_threshold = 0;
+  return CMD_SUCCESS;
+}
+
+int
+thread_config_write (struct vty *vty)
+{
+  if (thread_slow_threshold == THREAD_SLOW_THRESHOLD_DEFAULT)
+    return 0;
+
+  if (thread_slow_threshold == 0)
+    vty_out (vty, "no thread slow-threshold%s", VTY_NEWLINE);
+  else
+    vty_out (vty, "thread slow-threshold %lu%s",
+             thread_slow_threshold / 1000, VTY_NEWLINE);
+  return 1;
+}
+
+#ifdef HAVE_OMNIORB
+static void
+thread_lock_record (struct timeval *start, struct timeval *end)
+{
+  unsigned long wait;
+  int slot;
+
+  wait = timeval_elapsed (*end, *start);
+  thread_lock_stats.count++;
+  thread_lock_stats.total += wait;
+  if (thread_lock_stats.max < wait)
+    thread_lock_stats.max = wait;
+
+  slot = end->tv_sec % THREAD_LOCK_WINDOW;
+  if (thread_lock_stats.window[slot].sec != end->tv_sec)
+    {
+      thread_lock_stats.window[slot].sec = end->tv_sec;
+      thread_lock_stats.window[slot].count = 0;
+      thread_lock_stats.window[slot].total = 0;
+    }
+  thread_lock_stats.window[slot].count++;
+  thread_lock_stats.window[slot].total += wait;
+}
+
+DEFUN(show_thread_lock,
+      show_thread_lock_cmd,
+      "show thread lock",
+      SHOW_STR
+      "Thread information\n"
+      "Time spent waiting for the stack lock\n")
+{
+  unsigned long count = 0, total = 0;
+  time_t now;
+  int i;
+
+  now = recent_relative_time ().tv_sec;
+  for (i = 0; i < THREAD_LOCK_WINDOW; i++)
+    if (now - thread_lock_stats.window[i].sec < THREAD_LOCK_WINDOW)
+      {
+        count += thread_lock_stats.window[i].count;
+        total += thread_lock_stats.window[i].total;
+      }
+
+  vty_out (vty, "Stack lock waits %lu, total %lu.%03lu ms, "
+           "avg %lu usec, max %lu usec%s",
+           thread_lock_stats.count,
+           thread_lock_stats.total / 1000, thread_lock_stats.total % 1000,
+           thread_lock_stats.count ?
+           thread_lock_stats.total / thread_lock_stats.count : 0,
+           thread_lock_stats.max, VTY_NEWLINE);
+  vty_out (vty, "Last %d seconds: waits %lu, total %lu.%03lu ms, "
+           "avg %lu usec%s",
+           THREAD_LOCK_WINDOW, count, total / 1000, total % 1000,
+           count ? total / count : 0, VTY_NEWLINE);
+  return CMD_SUCCESS;
+}
+
+DEFUN(clear_thread_lock,
+      clear_thread_lock_cmd,
+      "clear thread lock",
+      CLEAR_STR
+      "Thread information\n"
+      "Time spent waiting for the stack lock\n")
+{
+  memset (&thread_lock_stats, 0, sizeof (thread_lock_stats));
+  return CMD_SUCCESS;
+}
+#endif /* HAVE_OMNIORB */
 
 /* List allocation and head/tail print out. */
 static void
@@ -393,31 +604,197 @@ thread_master_debug (struct thread_master *m)
   thread_list_debug (&m->read);
   printf ("writelist : ");
   thread_list_debug (&m->write);
-  printf ("timerlist : ");
-  thread_list_debug (&m->timer);
+  printf ("timerqueue : count [%d]\n", m->timer->size);
   printf ("eventlist : ");
   thread_list_debug (&m->event);
   printf ("unuselist : ");
   thread_list_debug (&m->unuse);
-  printf ("bgndlist : ");
-  thread_list_debug (&m->background);
+  printf ("bgndqueue : count [%d]\n", m->background->size);
   printf ("total alloc: [%ld]\n", m->alloc);
   printf ("-----------\n");
 }
 
+/* Timer queues are binary heaps ordered by expiry time. */
+static int
+thread_timer_cmp (void *a, void *b)
+{
+  struct thread *thread_a = a;
+  struct thread *thread_b = b;
+
+  return timeval_cmp (thread_a->u.sands, thread_b->u.sands);
+}
+
+static void
+thread_timer_update (void *node, int actual_position)
+{
+  struct thread *thread = node;
+
+  thread->index = actual_position;
+}
+
 /* Allocate new thread master.  */
 struct thread_master *
 thread_master_create ()
 {
+  struct thread_master *m;
+
   if (cpu_record == NULL) 
     cpu_record 
       = hash_create_size (1011, (unsigned int (*) (void *))cpu_record_hash_key, 
                           (int (*) (void *, void *))cpu_record_hash_cmp);
-    
-  return (struct thread_master *) XCALLOC (MTYPE_THREAD_MASTER,
-					   sizeof (struct thread_master));
+
+  m = XCALLOC (MTYPE_THREAD_MASTER, sizeof (struct thread_master));
+
+  m->timer = pqueue_create ();
+  m->timer->cmp = thread_timer_cmp;
+  m->timer->update = thread_timer_update;
+
+  m->background = pqueue_create ();
+  m->background->cmp = thread_timer_cmp;
+  m->background->update = thread_timer_update;
+
+#ifdef HAVE_EPOLL
+  if ((m->epoll_fd = epoll_create (THREAD_EPOLL_EVENTS)) < 0)
+    {
+      zlog_err ("thread_master_create: epoll_create() failed: %s",
+		safe_strerror (errno));
+      exit (1);
+    }
+#endif /* HAVE_EPOLL */
+
+  return m;
 }
 
+#ifdef HAVE_EPOLL
+/* The epoll backend keeps the read and write thread of every fd in two
+   tables indexed by fd, instead of the select fd_sets.  Registrations
+   are level triggered: a read or write thread is one-shot and its
+   handler may leave data behind for the next one. */
+static struct thread *
+thread_fd_lookup (struct thread_master *m, int fd, u_char type)
+{
+  if (fd < 0 || fd >= m->epoll_size)
+    return NULL;
+
+  return (type == THREAD_READ) ? m->epoll_read[fd] : m->epoll_write[fd];
+}
+
+static void
+thread_epoll_grow (struct thread_master *m, int fd)
+{
+  int size = m->epoll_size ? m->epoll_size : THREAD_EPOLL_EVENTS;
+
+  while (size <= fd)
+    size *= 2;
+
+  m->epoll_read = XREALLOC (MTYPE_THREAD_EPOLL, m->epoll_read,
+			    size * sizeof (struct thread *));
+  m->epoll_write = XREALLOC (MTYPE_THREAD_EPOLL, m->epoll_write,
+			     size * sizeof (struct thread *));
+  memset (m->epoll_read + m->epoll_size, 0,
+	  (size - m->epoll_size) * sizeof (struct thread *));
+  memset (m->epoll_write + m->epoll_size, 0,
+	  (size - m->epoll_size) * sizeof (struct thread *));
+  m->epoll_size = size;
+}
+
+/* Push the read/write interest of fd to the kernel.  clearing is set
+   when interest is being dropped. */
+static void
+thread_epoll_ctl (struct thread_master *m, int fd, int was_registered,
+		  int clearing)
+{
+  struct epoll_event ev;
+  int op;
+
+  memset (&ev, 0, sizeof (ev));
+  ev.data.fd = fd;
+  if (m->epoll_read[fd])
+    ev.events |= EPOLLIN;
+  if (m->epoll_write[fd])
+    ev.events |= EPOLLOUT;
+
+  if (! ev.events)
+    op = EPOLL_CTL_DEL;
+  else if (was_registered)
+    op = EPOLL_CTL_MOD;
+  else
+    op = EPOLL_CTL_ADD;
+
+  if (epoll_ctl (m->epoll_fd, op, fd, &ev) == 0)
+    return;
+
+  /* The fd may have been closed (and reused) behind our back, which
+     silently drops it from the epoll set. */
+  if (op == EPOLL_CTL_MOD && errno == ENOENT
+      && epoll_ctl (m->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+    return;
+  /* Dropping interest in an fd that was closed already is no error,
+     as with the select backend. */
+  if (clearing && (errno == ENOENT || errno == EBADF))
+    return;
+
+  zlog_warn ("epoll_ctl(%d) on fd %d failed: %s", op, fd,
+	     safe_strerror (errno));
+}
+
+static void
+thread_fd_set (struct thread_master *m, int fd, u_char type,
+	       struct thread *thread)
+{
+  int was_registered;
+
+  if (fd >= m->epoll_size)
+    thread_epoll_grow (m, fd);
+
+  was_registered = m->epoll_read[fd] || m->epoll_write[fd];
+  if (type == THREAD_READ)
+    m->epoll_read[fd] = thread;
+  else
+    m->epoll_write[fd] = thread;
+
+  thread_epoll_ctl (m, fd, was_registered, 0);
+}
+
+static void
+thread_fd_clr (struct thread_master *m, int fd, u_char type)
+{
+  assert (thread_fd_lookup (m, fd, type) != NULL);
+
+  if (type == THREAD_READ)
+    m->epoll_read[fd] = NULL;
+  else
+    m->epoll_write[fd] = NULL;
+
+  thread_epoll_ctl (m, fd, 1, 1);
+}
+#else
+static struct thread *
+thread_fd_lookup (struct thread_master *m, int fd, u_char type)
+{
+  fd_set *fdset = (type == THREAD_READ) ? &m->readfd : &m->writefd;
+
+  /* Only used as a boolean with the select backend. */
+  return FD_ISSET (fd, fdset) ? (struct thread *) fdset : NULL;
+}
+
+static void
+thread_fd_set (struct thread_master *m, int fd, u_char type,
+	       struct thread *thread)
+{
+  FD_SET (fd, (type == THREAD_READ) ? &m->readfd : &m->writefd);
+}
+
+static void
+thread_fd_clr (struct thread_master *m, int fd, u_char type)
+{
+  fd_set *fdset = (type == THREAD_READ) ? &m->readfd : &m->writefd;
+
+  assert (FD_ISSET (fd, fdset));
+  FD_CLR (fd, fdset);
+}
+#endif /* HAVE_EPOLL */
+
 /* Add a new thread to the list.  */
 static void
 thread_list_add (struct thread_list *list, struct thread *thread)
@@ -432,22 +809,6 @@ thread_list_add (struct thread_list *list, struct thread *thread)
   list->count++;
 }
 
-/* Add a new thread just before the point.  */
-static void
-thread_list_add_before (struct thread_list *list, 
-			struct thread *point, 
-			struct thread *thread)
-{
-  thread->next = point;
-  thread->prev = point->prev;
-  if (point->prev)
-    point->prev->next = thread;
-  else
-    list->head = thread;
-  point->prev = thread;
-  list->count++;
-}
-
 /* Delete a thread from the list. */
 static struct thread *
 thread_list_delete (struct thread_list *list, struct thread *thread)
@@ -494,17 +855,43 @@ thread_list_free (struct thread_master *m, struct thread_list *list)
     }
 }
 
+/* Free all threads still pending in a timer queue. */
+static void
+thread_queue_free (struct thread_master *m, struct pqueue *queue)
+{
+  int i;
+
+  for (i = 0; i < queue->size; i++)
+    {
+      struct thread *t = queue->array[i];
+
+      XFREE (MTYPE_THREAD_FUNCNAME, t->funcname);
+      XFREE (MTYPE_THREAD, t);
+      m->alloc--;
+    }
+
+  pqueue_delete (queue);
+}
+
 /* Stop thread scheduler. */
 void
 thread_master_free (struct thread_master *m)
 {
   thread_list_free (m, &m->read);
   thread_list_free (m, &m->write);
-  thread_list_free (m, &m->timer);
+  thread_queue_free (m, m->timer);
   thread_list_free (m, &m->event);
   thread_list_free (m, &m->ready);
   thread_list_free (m, &m->unuse);
-  thread_list_free (m, &m->background);
+  thread_queue_free (m, m->background);
+
+#ifdef HAVE_EPOLL
+  close (m->epoll_fd);
+  if (m->epoll_read)
+    XFREE (MTYPE_THREAD_EPOLL, m->epoll_read);
+  if (m->epoll_write)
+    XFREE (MTYPE_THREAD_EPOLL, m->epoll_write);
+#endif /* HAVE_EPOLL */
   
   XFREE (MTYPE_THREAD_MASTER, m);
 }
@@ -587,6 +974,7 @@ thread_get (struct thread_master *m, u_char type,
   thread->master = m;
   thread->func = func;
   thread->arg = arg;
+  thread->index = -1;
   
   thread->funcname = strip_funcname(funcname);
 
@@ -602,14 +990,14 @@ funcname_thread_add_read (struct thread_master *m,
 
   assert (m != NULL);
 
-  if (FD_ISSET (fd, &m->readfd))
+  if (thread_fd_lookup (m, fd, THREAD_READ))
     {
       zlog (NULL, LOG_WARNING, "There is already read fd [%d]", fd);
       return NULL;
     }
 
   thread = thread_get (m, THREAD_READ, func, arg, funcname);
-  FD_SET (fd, &m->readfd);
+  thread_fd_set (m, fd, THREAD_READ, thread);
   thread->u.fd = fd;
   thread_list_add (&m->read, thread);
 
@@ -625,14 +1013,14 @@ funcname_thread_add_write (struct thread_master *m,
 
   assert (m != NULL);
 
-  if (FD_ISSET (fd, &m->writefd))
+  if (thread_fd_lookup (m, fd, THREAD_WRITE))
     {
       zlog (NULL, LOG_WARNING, "There is already write fd [%d]", fd);
       return NULL;
     }
 
   thread = thread_get (m, THREAD_WRITE, func, arg, funcname);
-  FD_SET (fd, &m->writefd);
+  thread_fd_set (m, fd, THREAD_WRITE, thread);
   thread->u.fd = fd;
   thread_list_add (&m->write, thread);
 
@@ -648,16 +1036,15 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
                                   const char* funcname)
 {
   struct thread *thread;
-  struct thread_list *list;
+  struct pqueue *queue;
   struct timeval alarm_time;
-  struct thread *tt;
 
   assert (m != NULL);
 
   assert (type == THREAD_TIMER || type == THREAD_BACKGROUND);
   assert (time_relative);
   
-  list = ((type == THREAD_TIMER) ? &m->timer : &m->background);
+  queue = ((type == THREAD_TIMER) ? m->timer : m->background);
   thread = thread_get (m, type, func, arg, funcname);
 
   /* Do we need jitter here? */
@@ -666,15 +1053,7 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
   alarm_time.tv_usec = relative_time.tv_usec + time_relative->tv_usec;
   thread->u.sands = timeval_adjust(alarm_time);
 
-  /* Sort by timeval. */
-  for (tt = list->head; tt; tt = tt->next)
-    if (timeval_cmp (thread->u.sands, tt->u.sands) <= 0)
-      break;
-
-  if (tt)
-    thread_list_add_before (list, tt, thread);
-  else
-    thread_list_add (list, thread);
+  pqueue_enqueue (thread, queue);
 
   return thread;
 }
@@ -760,22 +1139,21 @@ funcname_thread_add_event (struct thread_master *m,
 void
 thread_cancel (struct thread *thread)
 {
-  struct thread_list *list;
+  struct thread_list *list = NULL;
+  struct pqueue *queue = NULL;
   
   switch (thread->type)
     {
     case THREAD_READ:
-      assert (FD_ISSET (thread->u.fd, &thread->master->readfd));
-      FD_CLR (thread->u.fd, &thread->master->readfd);
+      thread_fd_clr (thread->master, thread->u.fd, THREAD_READ);
       list = &thread->master->read;
       break;
     case THREAD_WRITE:
-      assert (FD_ISSET (thread->u.fd, &thread->master->writefd));
-      FD_CLR (thread->u.fd, &thread->master->writefd);
+      thread_fd_clr (thread->master, thread->u.fd, THREAD_WRITE);
       list = &thread->master->write;
       break;
     case THREAD_TIMER:
-      list = &thread->master->timer;
+      queue = thread->master->timer;
       break;
     case THREAD_EVENT:
       list = &thread->master->event;
@@ -784,13 +1162,22 @@ thread_cancel (struct thread *thread)
       list = &thread->master->ready;
       break;
     case THREAD_BACKGROUND:
-      list = &thread->master->background;
+      queue = thread->master->background;
       break;
     default:
       return;
       break;
     }
-  thread_list_delete (list, thread);
+
+  if (queue)
+    {
+      assert (thread->index >= 0);
+      assert (thread == queue->array[thread->index]);
+      pqueue_remove_at (thread->index, queue);
+      thread->index = -1;
+    }
+  else
+    thread_list_delete (list, thread);
   thread->type = THREAD_UNUSED;
   thread_add_unuse (thread->master, thread);
 }
@@ -822,11 +1209,13 @@ thread_cancel_event (struct thread_master *m, void *arg)
 }
 
 static struct timeval *
-thread_timer_wait (struct thread_list *tlist, struct timeval *timer_val)
+thread_timer_wait (struct pqueue *queue, struct timeval *timer_val)
 {
-  if (!thread_empty (tlist))
+  if (queue->size)
     {
-      *timer_val = timeval_subtract (tlist->head->u.sands, relative_time);
+      struct thread *next_timer = queue->array[0];
+
+      *timer_val = timeval_subtract (next_timer->u.sands, relative_time);
       return timer_val;
     }
   return NULL;
@@ -842,6 +1231,43 @@ thread_run (struct thread_master *m, struct thread *thread,
   return fetch;
 }
 
+#ifdef HAVE_EPOLL
+/* Move the thread waiting for this direction of fd to the ready list. */
+static int
+thread_process_epoll_fd (struct thread_master *m, struct thread_list *list,
+			 int fd, u_char type)
+{
+  struct thread *thread;
+
+  if ((thread = thread_fd_lookup (m, fd, type)) == NULL)
+    return 0;
+
+  thread_fd_clr (m, fd, type);
+  thread_list_delete (list, thread);
+  thread_list_add (&m->ready, thread);
+  thread->type = THREAD_READY;
+  return 1;
+}
+
+/* Errors and hangups wake up both directions, like select() does. */
+static int
+thread_process_epoll (struct thread_master *m, struct epoll_event *events,
+		      int num)
+{
+  int i, ready = 0;
+
+  for (i = 0; i < num; i++)
+    {
+      int fd = events[i].data.fd;
+
+      if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+	ready += thread_process_epoll_fd (m, &m->read, fd, THREAD_READ);
+      if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+	ready += thread_process_epoll_fd (m, &m->write, fd, THREAD_WRITE);
+    }
+  return ready;
+}
+#else
 static int
 thread_process_fd (struct thread_list *list, fd_set *fdset, fd_set *mfdset)
 {
@@ -895,18 +1321,22 @@ thread_process_fd_debug (struct thread_list *list, fd_set *fdset, fd_set *mfdset
   return ready;
 }
 
+#endif /* HAVE_EPOLL */
+
 /* Add all timers that have popped to the ready list. */
 static unsigned int
-thread_timer_process (struct thread_list *list, struct timeval *timenow)
+thread_timer_process (struct pqueue *queue, struct timeval *timenow)
 {
   struct thread *thread;
   unsigned int ready = 0;
   
-  for (thread = list->head; thread; thread = thread->next)
+  while (queue->size)
     {
+      thread = queue->array[0];
       if (timeval_cmp (*timenow, thread->u.sands) < 0)
         return ready;
-      thread_list_delete (list, thread);
+      pqueue_dequeue (queue);
+      thread->index = -1;
       thread->type = THREAD_READY;
       thread_list_add (&thread->master->ready, thread);
       ready++;
@@ -919,9 +1349,14 @@ struct thread *
 thread_fetch (struct thread_master *m, struct thread *fetch)
 {
   struct thread *thread;
+#ifdef HAVE_EPOLL
+  struct epoll_event events[THREAD_EPOLL_EVENTS];
+  int timeout;
+#else
   fd_set readfd;
   fd_set writefd;
   fd_set exceptfd;
+#endif /* HAVE_EPOLL */
   struct timeval timer_val;
   struct timeval timer_val_bg;
   struct timeval *timer_wait;
@@ -944,15 +1379,17 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
       if ((thread = thread_trim_head (&m->ready)) != NULL)
         return thread_run (m, thread, fetch);
       
+#ifndef HAVE_EPOLL
       /* Structure copy.  */
       readfd = m->readfd;
       writefd = m->writefd;
       exceptfd = m->exceptfd;
+#endif /* HAVE_EPOLL */
       
       /* Calculate select wait timer if nothing else to do */
       quagga_get_relative (NULL);
-      timer_wait = thread_timer_wait (&m->timer, &timer_val);
-      timer_wait_bg = thread_timer_wait (&m->background, &timer_val_bg);
+      timer_wait = thread_timer_wait (m->timer, &timer_val);
+      timer_wait_bg = thread_timer_wait (m->background, &timer_val_bg);
       
       if (timer_wait_bg &&
 	  (!timer_wait || (timeval_cmp (*timer_wait, *timer_wait_bg) > 0)))
@@ -969,14 +1406,28 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
       }
 #endif
 
+#ifdef HAVE_EPOLL
+      /* Round up, so that we never wake up just before a timer pops. */
+      timeout = -1;
+      if (timer_wait)
+        timeout = timer_wait->tv_sec * 1000
+                  + (timer_wait->tv_usec + 999) / 1000;
+
+      num = epoll_wait (m->epoll_fd, events, THREAD_EPOLL_EVENTS, timeout);
+#else
       num = select (FD_SETSIZE, &readfd, &writefd, &exceptfd, timer_wait);
+#endif /* HAVE_EPOLL */
       
       /* Signals should get quick treatment */
       if (num < 0)
         {
           if (errno == EINTR)
             continue; /* signal received - process it */
+#ifdef HAVE_EPOLL
+          zlog_warn ("epoll_wait() error: %s", safe_strerror (errno));
+#else
           zlog_warn ("select() error: %s", safe_strerror (errno));
+#endif /* HAVE_EPOLL */
             return NULL;
         }
 
@@ -984,16 +1435,21 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
          priority than I/O threads, so let's push them onto the ready
 	 list in front of the I/O threads. */
       quagga_get_relative (NULL);
-      thread_timer_process (&m->timer, &relative_time);
+      thread_timer_process (m->timer, &relative_time);
       
       /* Got IO, process it */
       if (num > 0)
         {
+#ifdef HAVE_EPOLL
+          m->io_ready += thread_process_epoll (m, events, num);
+#else
           /* Normal priority read thead. */
-          thread_process_fd (&m->read, &readfd, &m->readfd);
+          m->io_ready += thread_process_fd (&m->read, &readfd, &m->readfd);
 //          thread_process_fd (&m->read, &readfd, &m->readfd);
           /* Write thead. */
-          thread_process_fd (&m->write, &writefd, &m->writefd);
+          m->io_ready += thread_process_fd (&m->write, &writefd,
+					    &m->writefd);
+#endif /* HAVE_EPOLL */
         }
 
 #if 0
@@ -1006,7 +1462,7 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
 #endif
 
       /* Background timer/events, lowest priority */
-      thread_timer_process (&m->background, &relative_time);
+      thread_timer_process (m->background, &relative_time);
       
       if ((thread = thread_trim_head (&m->ready)) != NULL)
         return thread_run (m, thread, fetch);
@@ -1061,14 +1517,58 @@ thread_getrusage (RUSAGE_T *r)
 #endif /* HAVE_CLOCK_MONOTONIC */
 }
 
+/* Account a finished callback in its cpu history and complain if it
+   ran for longer than the slow thread threshold. */
+static void
+thread_call_record (struct thread *thread, RUSAGE_T *ru)
+{
+  struct cpu_thread_history *hist = thread->hist;
+  unsigned long realtime, cputime, t;
+  int bucket;
+
+  realtime = thread_consumed_time (ru, &thread->ru, &cputime);
+  hist->real.total += realtime;
+  if (hist->real.max < realtime)
+    hist->real.max = realtime;
+#ifdef HAVE_RUSAGE
+  hist->cpu.total += cputime;
+  if (hist->cpu.max < cputime)
+    hist->cpu.max = cputime;
+#endif
+
+  for (bucket = 0, t = realtime;
+       t && bucket < THREAD_LATENCY_BUCKETS - 1; t >>= 1)
+    bucket++;
+  hist->latency[bucket]++;
+
+  ++(hist->total_calls);
+  hist->types |= (1 << thread->add_type);
+
+  if (thread_slow_threshold && realtime > thread_slow_threshold)
+    {
+      /*
+       * We have a CPU Hog on our hands.
+       * Whinge about it now, so we're aware this is yet another task
+       * to fix.
+       */
+      zlog_warn ("SLOW THREAD: task %s (%lx) arg %p ran for %lums "
+                 "(cpu time %lums)",
+		 thread->funcname,
+		 (unsigned long) thread->func, thread->arg,
+		 realtime/1000, cputime/1000);
+    }
+}
+
 /* We check thread consumed time. If the system has getrusage, we'll
    use that to get in-depth stats on the performance of the thread in addition
    to wall clock time stats from gettimeofday. */
 void
 thread_call (struct thread *thread)
 {
-  unsigned long realtime, cputime;
   RUSAGE_T ru;
+#if HAVE_OMNIORB
+  struct timeval lock_start;
+#endif
 
  /* Cache a pointer to the relevant cpu history thread, if the thread
   * does not have it yet.
@@ -1087,46 +1587,28 @@ thread_call (struct thread *thread)
                     (void * (*) (void *))cpu_record_hash_alloc);
     }
 #if HAVE_OMNIORB
+  quagga_get_relative (&lock_start);
   stack_lock();
 #endif
 
   GETRUSAGE (&thread->ru);
 
+#if HAVE_OMNIORB
+  thread_lock_record (&lock_start, &thread->ru.real);
+#endif
+
   (*thread->func) (thread);
 
+  /* Write out what the thread logged while it was running. */
+  zlog_flush (NULL);
+
 #if HAVE_OMNIORB
   stack_unlock();
 #endif
 
   GETRUSAGE (&ru);
 
-  realtime = thread_consumed_time (&ru, &thread->ru, &cputime);
-  thread->hist->real.total += realtime;
-  if (thread->hist->real.max < realtime)
-    thread->hist->real.max = realtime;
-#ifdef HAVE_RUSAGE
-  thread->hist->cpu.total += cputime;
-  if (thread->hist->cpu.max < cputime)
-    thread->hist->cpu.max = cputime;
-#endif
-
-  ++(thread->hist->total_calls);
-  thread->hist->types |= (1 << thread->add_type);
-
-#ifdef CONSUMED_TIME_CHECK
-  if (realtime > CONSUMED_TIME_CHECK)
-    {
-      /*
-       * We have a CPU Hog on our hands.
-       * Whinge about it now, so we're aware this is yet another task
-       * to fix.
-       */
-      zlog_warn ("SLOW THREAD: task %s (%lx) ran for %lums (cpu time %lums)",
-		 thread->funcname,
-		 (unsigned long) thread->func,
-		 realtime/1000, cputime/1000);
-    }
-#endif /* CONSUMED_TIME_CHECK */
+  thread_call_record (thread, &ru);
 }
 
 /* Execute thread */
@@ -1160,7 +1642,6 @@ funcname_thread_execute (struct thread_master *m,
 void
 thread_call_no_lock (struct thread *thread)
 {
-  unsigned long realtime, cputime;
   RUSAGE_T ru;
 
  /* Cache a pointer to the relevant cpu history thread, if the thread
@@ -1184,35 +1665,13 @@ thread_call_no_lock (struct thread *thread)
 
   (*thread->func) (thread);
 
-  GETRUSAGE (&ru);
-
-  realtime = thread_consumed_time (&ru, &thread->ru, &cputime);
-  thread->hist->real.total += realtime;
-  if (thread->hist->real.max < realtime)
-    thread->hist->real.max = realtime;
-#ifdef HAVE_RUSAGE
-  thread->hist->cpu.total += cputime;
-  if (thread->hist->cpu.max < cputime)
-    thread->hist->cpu.max = cputime;
-#endif
+  /* No zlog_flush() here: the log ring may only be touched under the
+     stack lock, and this is only ever called from code that already
+     holds it, so the enclosing thread_call() writes the ring out. */
 
-  ++(thread->hist->total_calls);
-  thread->hist->types |= (1 << thread->add_type);
+  GETRUSAGE (&ru);
 
-#ifdef CONSUMED_TIME_CHECK
-  if (realtime > CONSUMED_TIME_CHECK)
-    {
-      /*
-       * We have a CPU Hog on our hands.
-       * Whinge about it now, so we're aware this is yet another task
-       * to fix.
-       */
-      zlog_warn ("SLOW THREAD: task %s (%lx) ran for %lums (cpu time %lums)",
-     thread->funcname,
-     (unsigned long) thread->func,
-     realtime/1000, cputime/1000);
-    }
-#endif /* CONSUMED_TIME_CHECK */
+  thread_call_record (thread, &ru);
 }
 
 /* Execute thread */
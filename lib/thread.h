@@ -54,20 +54,31 @@ struct thread_list
   int count;
 };
 
+struct pqueue;
+struct vty;
+
 /* Master of the theads. */
 struct thread_master
 {
   struct thread_list read;
   struct thread_list write;
-  struct thread_list timer;
+  struct pqueue *timer;
   struct thread_list event;
   struct thread_list ready;
   struct thread_list unuse;
-  struct thread_list background;
+  struct pqueue *background;
+#ifdef HAVE_EPOLL
+  int epoll_fd;
+  int epoll_size;		/* slots in epoll_read/epoll_write */
+  struct thread **epoll_read;	/* read thread by fd */
+  struct thread **epoll_write;	/* write thread by fd */
+#else
   fd_set readfd;
   fd_set writefd;
   fd_set exceptfd;
+#endif /* HAVE_EPOLL */
   unsigned long alloc;
+  unsigned long io_ready;	/* read/write threads made ready so far */
 };
 
 /* Thread itself. */
@@ -85,11 +96,16 @@ struct thread
     int fd;			/* file descriptor in case of read/write. */
     struct timeval sands;	/* rest of time sands value. */
   } u;
+  int index;			/* position in timer queue, or -1 */
   RUSAGE_T ru;			/* Indepth usage info.  */
   struct cpu_thread_history *hist; /* cache pointer to cpu_history */
   char* funcname;
 };
 
+/* Wall-clock latency histogram: bucket n counts calls that ran for
+ * [2^(n-1), 2^n) microseconds, the last bucket catches everything above. */
+#define THREAD_LATENCY_BUCKETS 24
+
 struct cpu_thread_history 
 {
   int (*func)(struct thread *);
@@ -102,6 +118,7 @@ struct cpu_thread_history
 #ifdef HAVE_RUSAGE
   struct time_stats cpu;
 #endif
+  unsigned long latency[THREAD_LATENCY_BUCKETS];
   unsigned char types;
 };
 
@@ -220,6 +237,15 @@ extern int thread_should_yield (struct thread *);
 /* Internal libzebra exports */
 extern void thread_getrusage (RUSAGE_T *);
 extern struct cmd_element show_thread_cpu_cmd;
+extern struct cmd_element show_thread_latency_cmd;
+extern struct cmd_element clear_thread_cpu_cmd;
+extern struct cmd_element thread_slow_threshold_cmd;
+extern struct cmd_element no_thread_slow_threshold_cmd;
+#ifdef HAVE_OMNIORB
+extern struct cmd_element show_thread_lock_cmd;
+extern struct cmd_element clear_thread_lock_cmd;
+#endif /* HAVE_OMNIORB */
+extern int thread_config_write (struct vty *);
 
 /* replacements for the system gettimeofday(), clock_gettime() and
  * time() functions, providing support for non-decrementing clock on
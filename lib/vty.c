@@ -148,6 +148,63 @@ vty_out (struct vty *vty, const char *format, ...)
   return len;
 }
 
+/* Drop streamed output that has not been printed yet. */
+static void
+vty_out_stream_stop (struct vty *vty)
+{
+  if (vty->output_func && vty->output_clean)
+    (*vty->output_clean) (vty->output_arg);
+  vty->output_func = NULL;
+  vty->output_clean = NULL;
+  vty->output_arg = NULL;
+}
+
+/* Let streamed output print until VTY_STREAM_BUFSIZ bytes are waiting
+   in the output buffer.  Returns 1 when it has just printed its last
+   part. */
+static int
+vty_out_refill (struct vty *vty)
+{
+  if (! vty->output_func)
+    return 0;
+
+  while (buffer_pending (vty->obuf) < VTY_STREAM_BUFSIZ)
+    if (! (*vty->output_func) (vty, vty->output_arg))
+      {
+	vty_out_stream_stop (vty);
+	return 1;
+      }
+
+  return 0;
+}
+
+/* Print output that is too large to build all at once.  FUNC prints
+   the next part of it and returns non-zero while there is more; it is
+   called again whenever the output has drained below VTY_STREAM_BUFSIZ.
+   CLEAN, if not NULL, frees ARG when the output is complete or the vty
+   is closed or interrupted.  Vtys that are not written from the event
+   loop get the whole output at once. */
+void
+vty_out_stream (struct vty *vty, int (*func) (struct vty *, void *),
+		void (*clean) (void *), void *arg)
+{
+  vty_out_stream_stop (vty);
+
+  if (vty->type != VTY_TERM && vty->type != VTY_SHELL_SERV)
+    {
+      while ((*func) (vty, arg))
+	;
+      if (clean)
+	(*clean) (arg);
+      return;
+    }
+
+  vty->output_func = func;
+  vty->output_clean = clean;
+  vty->output_arg = arg;
+  vty_out_refill (vty);
+}
+
 static int
 vty_log_out (struct vty *vty, const char *level, const char *proto_str,
 	     const char *format, struct timestamp_control *ctl, va_list va)
@@ -1292,7 +1349,8 @@ vty_execute (struct vty *vty)
   vty->cp = vty->length = 0;
   vty_clear_buf (vty);
 
-  if (vty->status != VTY_CLOSE )
+  /* Streamed output prints the prompt once it is done. */
+  if (vty->status != VTY_CLOSE && ! vty->output_func)
     vty_prompt (vty);
 
   return ret;
@@ -1333,6 +1391,7 @@ vty_escape_map (unsigned char c, struct vty *vty)
 static void
 vty_buffer_reset (struct vty *vty)
 {
+  vty_out_stream_stop (vty);
   buffer_reset (vty->obuf);
   vty_prompt (vty);
   vty_redraw_line (vty);
@@ -1402,7 +1461,7 @@ vty_read (struct thread *thread)
 	}
 	        
 
-      if (vty->status == VTY_MORE)
+      if (vty->status == VTY_MORE || vty->output_func)
 	{
 	  switch (buf[i])
 	    {
@@ -1566,6 +1625,10 @@ vty_flush (struct thread *thread)
       vty->t_read = NULL;
     }
 
+  /* Produce more of a streamed output. */
+  if (vty_out_refill (vty))
+    vty_prompt (vty);
+
   /* Function execution continue. */
   erase = ((vty->status == VTY_MORE || vty->status == VTY_MORELINE));
 
@@ -1592,6 +1655,12 @@ vty_flush (struct thread *thread)
     case BUFFER_EMPTY:
       if (vty->status == VTY_CLOSE)
 	vty_close (vty);
+      else if (vty->output_func)
+	{
+	  /* The streamed output has more to print. */
+	  vty->status = VTY_NORMAL;
+	  vty_event (VTY_WRITE, vty_sock, vty);
+	}
       else
 	{
 	  vty->status = VTY_NORMAL;
@@ -2025,6 +2094,15 @@ vtysh_accept (struct thread *thread)
 static int
 vtysh_flush(struct vty *vty)
 {
+  /* Produce more of a streamed output, then its command result. */
+  if (vty_out_refill (vty))
+    {
+      u_char header[4] = {0, 0, 0, 0};
+
+      header[3] = vty->output_ret;
+      buffer_put(vty->obuf, header, 4);
+    }
+
   switch (buffer_flush_available(vty->obuf, vty->fd))
     {
     case BUFFER_PENDING:
@@ -2038,6 +2116,8 @@ vtysh_flush(struct vty *vty)
       return -1;
       break;
     case BUFFER_EMPTY:
+      if (vty->output_func)
+	vty_event(VTYSH_WRITE, vty->fd, vty);
       break;
     }
   return 0;
@@ -2100,8 +2180,14 @@ vtysh_read (struct thread *thread)
 	  printf ("vtysh node: %d\n", vty->node);
 #endif /* VTYSH_DEBUG */
 
-	  header[3] = ret;
-	  buffer_put(vty->obuf, header, 4);
+	  if (vty->output_func)
+	    /* vtysh_flush sends it after the streamed output. */
+	    vty->output_ret = ret;
+	  else
+	    {
+	      header[3] = ret;
+	      buffer_put(vty->obuf, header, 4);
+	    }
 
 	  if (!vty->t_write && (vtysh_flush(vty) < 0))
 	    /* Try to flush results; exit if a write error occurs. */
@@ -2168,6 +2254,8 @@ vty_close (struct vty *vty)
   if (vty->t_timeout)
     thread_cancel (vty->t_timeout);
 
+  vty_out_stream_stop (vty);
+
   /* Flush buffer. */
   buffer_flush_all (vty->obuf, vty->fd);
 
@@ -2225,6 +2313,8 @@ vty_read_file (FILE *confp)
 {
   int ret;
   struct vty *vty;
+  struct timeval start, now;
+  long msec;
 
   vty = vty_new ();
   vty->fd = 0;			/* stdout */
@@ -2232,8 +2322,15 @@ vty_read_file (FILE *confp)
   vty->node = CONFIG_NODE;
   
   /* Execute configuration file */
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
   ret = config_from_file (vty, confp);
 
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  msec = (now.tv_sec - start.tv_sec) * 1000
+         + (now.tv_usec - start.tv_usec) / 1000;
+  zlog_info ("configuration: read %ld bytes in %ld.%03ld seconds",
+	     ftell (confp), msec / 1000, msec % 1000);
+
 
   if ( !((ret == CMD_SUCCESS) || (ret == CMD_ERR_NOTHING_TODO)) ) 
     {
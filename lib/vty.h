@@ -129,6 +129,12 @@ struct vty
   /* Timeout seconds and thread. */
   unsigned long v_timeout;
   struct thread *t_timeout;
+
+  /* Streamed output, see vty_out_stream(). */
+  int (*output_func) (struct vty *, void *);
+  void (*output_clean) (void *);
+  void *output_arg;
+  int output_ret;
 };
 
 /* Integrated configuration file. */
@@ -143,6 +149,9 @@ struct vty
 /* Vty read buffer size. */
 #define VTY_READ_BUFSIZ 512
 
+/* Streamed output is produced until this much is waiting to be sent. */
+#define VTY_STREAM_BUFSIZ 65536
+
 /* Directory separator. */
 #ifndef DIRECTORY_SEP
 #define DIRECTORY_SEP '/'
@@ -217,6 +226,8 @@ extern void vty_init_vtysh (void);
 extern void vty_reset (void);
 extern struct vty *vty_new (void);
 extern int vty_out (struct vty *, const char *, ...) PRINTF_ATTRIBUTE(2, 3);
+extern void vty_out_stream (struct vty *, int (*) (struct vty *, void *),
+			    void (*) (void *), void *);
 extern void vty_read_config (char *, char *);
 extern void vty_time_print (struct vty *, int);
 extern void vty_serv_sock (const char *, unsigned short, const char *);
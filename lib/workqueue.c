@@ -129,8 +129,12 @@ work_queue_add (struct work_queue *wq, void *data)
     }
 
   item->data = data;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &item->added);
   listnode_add (wq->items, item);
 
+  if ((unsigned int) listcount (wq->items) > wq->stats.depth_max)
+    wq->stats.depth_max = listcount (wq->items);
+
   work_queue_schedule (wq, wq->spec.hold);
 
   return;
@@ -153,6 +157,12 @@ work_queue_item_remove (struct work_queue *wq, struct zlistnode *ln)
   return;
 }
 
+static unsigned long
+work_queue_elapsed (struct timeval *a, struct timeval *b)
+{
+  return (a->tv_sec - b->tv_sec) * 1000000L + (a->tv_usec - b->tv_usec);
+}
+
 static void
 work_queue_item_requeue (struct work_queue *wq, struct zlistnode *ln)
 {
@@ -170,22 +180,24 @@ DEFUN(show_work_queues,
   struct work_queue *wq;
 
   vty_out (vty,
-           "%c %8s %5s %8s %21s%s",
+           "%c %8s %5s %8s %21s %8s %6s %6s %6s%s",
            ' ', "List","(ms) ","Q. Runs","Cycle Counts   ",
+           "Items/s", "Lat.", "Max", "Budget",
            VTY_NEWLINE);
   vty_out (vty,
-           "%c %8s %5s %8s %7s %6s %6s %s%s",
+           "%c %8s %5s %8s %7s %6s %6s %8s %6s %6s %6s %s%s",
            'P',
            "Items",
            "Hold",
            "Total",
            "Best","Gran.","Avg.",
+           "", "(ms)", "Items", "(ms)",
            "Name",
            VTY_NEWLINE);
 
   for (ALL_LIST_ELEMENTS_RO ((&work_queues), node, wq))
     {
-      vty_out (vty,"%c %8d %5d %8ld %7d %6d %6u %s%s",
+      vty_out (vty,"%c %8d %5d %8ld %7d %6d %6u %8lu %6lu %6u %6lu %s%s",
                (wq->flags == WQ_PLUGGED ? 'P' : ' '),
                listcount (wq->items),
                wq->spec.hold,
@@ -193,6 +205,14 @@ DEFUN(show_work_queues,
                wq->cycles.best, wq->cycles.granularity,
                  (wq->runs) ?
                    (unsigned int) (wq->cycles.total / wq->runs) : 0,
+               (wq->stats.usec) ?
+                 (unsigned long) (wq->stats.items * 1000000ULL
+                                  / wq->stats.usec) : 0,
+               (wq->stats.items) ?
+                 (unsigned long) (wq->stats.latency / wq->stats.items
+                                  / 1000) : 0,
+               wq->stats.depth_max,
+               wq->budget / 1000,
                wq->name,
                VTY_NEWLINE);
     }
@@ -239,12 +259,17 @@ work_queue_run (struct thread *thread)
   unsigned int cycles = 0;
   struct zlistnode *node, *nnode;
   char yielded = 0;
+  struct timeval start, now;
 
   wq = THREAD_ARG (thread);
   wq->thread = NULL;
 
   assert (wq && wq->items);
 
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  if (wq->spec.budget && wq->budget == 0)
+    wq->budget = MIN (THREAD_YIELD_TIME_SLOT, wq->spec.budget);
+
   /* calculate cycle granularity:
    * list iteration == 1 cycle
    * granularity == # cycles between checks whether we should yield.
@@ -279,6 +304,9 @@ work_queue_run (struct thread *thread)
 	continue;
       }
 
+    if (item->ran == 0)
+      wq->stats.latency += work_queue_elapsed (&start, &item->added);
+
     /* run and take care of items that want to be retried immediately */
     do
       {
@@ -326,16 +354,45 @@ work_queue_run (struct thread *thread)
     cycles++;
 
     /* test if we should yield */
-    if ( !(cycles % wq->cycles.granularity)
-        && thread_should_yield (thread))
+    if ( !(cycles % wq->cycles.granularity))
       {
-        yielded = 1;
-        goto stats;
+        if (wq->spec.budget)
+          {
+            quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+            yielded = (work_queue_elapsed (&now, &start) > wq->budget);
+          }
+        else
+          yielded = thread_should_yield (thread);
+        if (yielded)
+          goto stats;
       }
   }
 
 stats:
 
+  /* let the user finish off what the items of this run have in common */
+  if (wq->spec.batch_end_func)
+    wq->spec.batch_end_func (wq);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  wq->stats.items += cycles;
+  wq->stats.usec += work_queue_elapsed (&now, &start);
+
+  /* adapt the budget: yielded with a backlog, so give the next run more
+   * time unless other threads wait on us or I/O came in since the last
+   * run, in which case give it less.  Sockets are not polled during a
+   * run, so I/O has to be judged by what the last fetches found.
+   */
+  if (wq->spec.budget && yielded)
+    {
+      if (wq->master->ready.count || wq->master->event.count
+          || wq->master->io_ready != wq->io_mark)
+        wq->budget = MAX (wq->budget / 2, WORK_QUEUE_MIN_BUDGET);
+      else
+        wq->budget = MIN (wq->budget * 2, wq->spec.budget);
+    }
+  wq->io_mark = wq->master->io_ready;
+
 #define WQ_HYSTERIS_FACTOR 2
 
   /* we yielded, check whether granularity should be reduced */
@@ -31,6 +31,9 @@ extern "C" {
 /* Hold time for the initial schedule of a queue run, in  millisec */
 #define WORK_QUEUE_DEFAULT_HOLD  50
 
+/* Smallest time budget an adaptive queue run is cut down to, in usec */
+#define WORK_QUEUE_MIN_BUDGET    1000
+
 /* action value, for use by item processor and item error handlers */
 typedef enum
 {
@@ -49,6 +52,7 @@ struct work_queue_item
 {
   void *data;                           /* opaque data */
   unsigned short ran;			/* # of times item has been run */
+  struct timeval added;			/* when it was queued */
 };
 
 enum work_queue_flags
@@ -88,10 +92,21 @@ struct work_queue
     /* completion callback, called when queue is emptied, optional */
     void (*completion_func) (struct work_queue *);
 
+    /* called at the end of every run, with the items it ran already
+     * processed, so work they share can be done once, optional */
+    void (*batch_end_func) (struct work_queue *);
+
     /* max number of retries to make for item that errors */
     unsigned int max_retries;
 
     unsigned int hold;	/* hold time for first run, in ms */
+
+    /* max wall-clock time of a run, in usec.  0 runs until the thread
+     * time slot is used up.  Otherwise the budget of each run adapts
+     * between WORK_QUEUE_MIN_BUDGET and this: it grows while the queue
+     * has a backlog and nothing else waits, and shrinks when other
+     * threads are kept waiting or I/O came in since the last run. */
+    unsigned long budget;
   } spec;
 
   /* remaining fields should be opaque to users */
@@ -104,6 +119,16 @@ struct work_queue
     unsigned long total;
   } cycles;	/* cycle counts */
 
+  unsigned long budget;		      /* current run budget, in usec */
+  unsigned long io_mark;	      /* master->io_ready after last run */
+
+  struct {
+    unsigned long items;	      /* items run */
+    uint64_t usec;		      /* time spent running them */
+    uint64_t latency;		      /* their total time queued, in usec */
+    unsigned int depth_max;	      /* deepest the queue has been */
+  } stats;
+
   /* private state */
   enum work_queue_flags flags;		/* user set flag */
 };
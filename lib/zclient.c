@@ -169,6 +169,9 @@ zclient_stop (struct zclient *zclient)
   /* Reset streams. */
   stream_reset(zclient->ibuf);
   stream_reset(zclient->obuf);
+  if (zclient->bulk)
+    stream_reset(zclient->bulk);
+  zclient->bulk_count = 0;
 
   /* Empty the write buffer. */
   buffer_reset(zclient->wb);
@@ -293,13 +296,13 @@ zclient_flush_data(struct thread *thread)
   return 0;
 }
 
-int
-zclient_send_message(struct zclient *zclient)
+static int
+zclient_send_stream(struct zclient *zclient, struct stream *s)
 {
   if (zclient->sock < 0)
     return -1;
-  switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(zclient->obuf),
-		       stream_get_endp(zclient->obuf)))
+  switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(s),
+		       stream_get_endp(s)))
     {
     case BUFFER_ERROR:
       zlog_warn("%s: buffer_write failed to zclient fd %d, closing",
@@ -317,6 +320,12 @@ zclient_send_message(struct zclient *zclient)
   return 0;
 }
 
+int
+zclient_send_message(struct zclient *zclient)
+{
+  return zclient_send_stream(zclient, zclient->obuf);
+}
+
 void
 zclient_create_header (struct stream *s, uint16_t command)
 {
@@ -440,6 +449,42 @@ zclient_connect (struct thread *t)
   return zclient_start (zclient);
 }
 
+/* Nexthop, distance and metric of a route message. */
+static void
+zapi_ipv4_put_attr (struct stream *s, struct zapi_ipv4 *api)
+{
+  int i;
+
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_NEXTHOP))
+    {
+      if (CHECK_FLAG (api->flags, ZEBRA_FLAG_BLACKHOLE))
+        {
+          stream_putc (s, 1);
+          stream_putc (s, ZEBRA_NEXTHOP_BLACKHOLE);
+          /* XXX assert(api->nexthop_num == 0); */
+          /* XXX assert(api->ifindex_num == 0); */
+        }
+      else
+        stream_putc (s, api->nexthop_num + api->ifindex_num);
+
+      for (i = 0; i < api->nexthop_num; i++)
+        {
+          stream_putc (s, ZEBRA_NEXTHOP_IPV4);
+          stream_put_in_addr (s, api->nexthop[i]);
+        }
+      for (i = 0; i < api->ifindex_num; i++)
+        {
+          stream_putc (s, ZEBRA_NEXTHOP_IFINDEX);
+          stream_putl (s, api->ifindex[i]);
+        }
+    }
+
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_DISTANCE))
+    stream_putc (s, api->distance);
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_METRIC))
+    stream_putl (s, api->metric);
+}
+
  /** 
   * "xdr_encode"-like interface that allows daemon (client) to send
   * a message to zebra server for a route that needs to be
@@ -488,7 +533,6 @@ int
 zapi_ipv4_route (u_char cmd, struct zclient *zclient, struct prefix_ipv4 *p,
                  struct zapi_ipv4 *api)
 {
-  int i;
   int psize;
   struct stream *s;
 
@@ -509,34 +553,7 @@ zapi_ipv4_route (u_char cmd, struct zclient *zclient, struct prefix_ipv4 *p,
   stream_write (s, (u_char *) & p->prefix, psize);
 
   /* Nexthop, ifindex, distance and metric information. */
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_NEXTHOP))
-    {
-      if (CHECK_FLAG (api->flags, ZEBRA_FLAG_BLACKHOLE))
-        {
-          stream_putc (s, 1);
-          stream_putc (s, ZEBRA_NEXTHOP_BLACKHOLE);
-          /* XXX assert(api->nexthop_num == 0); */
-          /* XXX assert(api->ifindex_num == 0); */
-        }
-      else
-        stream_putc (s, api->nexthop_num + api->ifindex_num);
-
-      for (i = 0; i < api->nexthop_num; i++)
-        {
-          stream_putc (s, ZEBRA_NEXTHOP_IPV4);
-          stream_put_in_addr (s, api->nexthop[i]);
-        }
-      for (i = 0; i < api->ifindex_num; i++)
-        {
-          stream_putc (s, ZEBRA_NEXTHOP_IFINDEX);
-          stream_putl (s, api->ifindex[i]);
-        }
-    }
-
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_DISTANCE))
-    stream_putc (s, api->distance);
-  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_METRIC))
-    stream_putl (s, api->metric);
+  zapi_ipv4_put_attr (s, api);
 
   /* Put length at the first point of the stream. */
   stream_putw_at (s, 0, stream_get_endp (s));
@@ -545,6 +562,96 @@ zapi_ipv4_route (u_char cmd, struct zclient *zclient, struct prefix_ipv4 *p,
   return 0;
 }
 
+ /**
+  * Queue a route add or delete (cmd is ZEBRA_IPV4_ROUTE_ADD or
+  * ZEBRA_IPV4_ROUTE_DELETE) into a ZEBRA_IPV4_ROUTE_BULK message, which
+  * zapi_ipv4_bulk_flush() sends.  A full message is sent on the way.
+  *
+  * The message carries route groups up to its end.  Consecutive routes
+  * with the same command and attributes share one group:
+  *
+  *  0 1 2 3 4 5 6 7 8 9 A B C D E F 0 1 2 3 4 5 6 7 8 9 A B C D E F
+  * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  * |    Command    |  Route Type   | ZEBRA Flags   | Message Flags |
+  * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  * | Nexthops, distance and metric, as in zapi_ipv4_route() ...    |
+  * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  * |        Prefix count           | Prefix length | Prefix ...    |
+  * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  *
+  * The server side is zread_ipv4_bulk().
+  */
+int
+zapi_ipv4_bulk_add (u_char cmd, struct zclient *zclient,
+                    struct prefix_ipv4 *p, struct zapi_ipv4 *api)
+{
+  struct stream *s;
+  size_t start, len, need;
+  int psize;
+  int ret = 0;
+
+  if (zclient->bulk == NULL)
+    zclient->bulk = stream_new (ZEBRA_MAX_PACKET_SIZ);
+  s = zclient->bulk;
+
+  /* Worst case: a new group for this route. */
+  psize = PSIZE (p->prefixlen);
+  need = 4 + 1 + 5 * (api->nexthop_num + api->ifindex_num) + 1 + 4
+         + 2 + 1 + psize;
+  if (stream_get_endp (s) && STREAM_WRITEABLE (s) < need)
+    ret = zapi_ipv4_bulk_flush (zclient);
+  if (stream_get_endp (s) == 0)
+    zclient_create_header (s, ZEBRA_IPV4_ROUTE_BULK);
+
+  start = stream_get_endp (s);
+  stream_putc (s, cmd);
+  stream_putc (s, api->type);
+  stream_putc (s, api->flags);
+  stream_putc (s, api->message);
+  zapi_ipv4_put_attr (s, api);
+  len = stream_get_endp (s) - start;
+
+  if (zclient->bulk_count
+      && zclient->bulk_count - zclient->bulk_group == len
+      && memcmp (STREAM_DATA (s) + zclient->bulk_group,
+                 STREAM_DATA (s) + start, len) == 0)
+    {
+      /* Same as the last group: drop the copy, count the prefix there. */
+      s->endp = start;
+      stream_putw_at (s, zclient->bulk_count,
+                      stream_getw_from (s, zclient->bulk_count) + 1);
+    }
+  else
+    {
+      zclient->bulk_group = start;
+      zclient->bulk_count = stream_get_endp (s);
+      stream_putw (s, 1);
+    }
+
+  stream_putc (s, p->prefixlen);
+  stream_write (s, (u_char *) & p->prefix, psize);
+
+  return ret;
+}
+
+/* Send the ZEBRA_IPV4_ROUTE_BULK message built so far, if any. */
+int
+zapi_ipv4_bulk_flush (struct zclient *zclient)
+{
+  struct stream *s = zclient->bulk;
+  int ret;
+
+  if (s == NULL || stream_get_endp (s) == 0)
+    return 0;
+
+  stream_putw_at (s, 0, stream_get_endp (s));
+  ret = zclient_send_stream (zclient, s);
+
+  stream_reset (s);
+  zclient->bulk_count = 0;
+  return ret;
+}
+
 #ifdef HAVE_IPV6
 int
 zapi_ipv6_route (u_char cmd, struct zclient *zclient, struct prefix_ipv6 *p,
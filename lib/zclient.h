@@ -64,6 +64,12 @@ struct zclient
   /* Buffer of data waiting to be written to zebra. */
   struct buffer *wb;
 
+  /* ZEBRA_IPV4_ROUTE_BULK message being built, and the offsets of the
+     attributes and prefix count of its last route group. */
+  struct stream *bulk;
+  size_t bulk_group;
+  size_t bulk_count;
+
   /* Read and connect thread. */
   struct thread *t_read;
   struct thread *t_connect;
@@ -188,6 +194,9 @@ extern uint16_t zebra_router_id_update_read (struct stream *s, struct prefix *ri
 extern struct interface * zebra_interface_update_read (struct stream *s);
 extern int zapi_ipv4_route (u_char, struct zclient *, struct prefix_ipv4 *, 
                             struct zapi_ipv4 *);
+extern int zapi_ipv4_bulk_add (u_char, struct zclient *, struct prefix_ipv4 *,
+                               struct zapi_ipv4 *);
+extern int zapi_ipv4_bulk_flush (struct zclient *);
 
 #ifdef HAVE_IPV6
 /* IPv6 prefix add and delete function prototype. */
@@ -422,6 +422,7 @@ struct in_pktinfo
 #define ZEBRA_ROUTER_ID_DELETE            21
 #define ZEBRA_ROUTER_ID_UPDATE            22
 #define ZEBRA_MESSAGE_MAX                 23
+#define ZEBRA_IPV4_ROUTE_BULK             50
 
 #ifdef GMPLS
 #define ZEBRA_TEL_ADD			  24
@@ -146,6 +146,7 @@ ospf_api_typename (int msgtype)
     { MSG_SYNC_LSDB,             "Sync LSDB",              },
     { MSG_ORIGINATE_REQUEST,     "Originate request",      },
     { MSG_DELETE_REQUEST,        "Delete request",         },
+    { MSG_TOPO_SUBSCRIBE,        "Topology subscribe",     },
     { MSG_REPLY,                 "Reply",                  },
     { MSG_READY_NOTIFY,          "Ready notify",           },
     { MSG_LSA_UPDATE_NOTIFY,     "LSA update notify",      },
@@ -154,6 +155,7 @@ ospf_api_typename (int msgtype)
     { MSG_DEL_IF,                "Del interface",          },
     { MSG_ISM_CHANGE,            "ISM change",             },
     { MSG_NSM_CHANGE,            "NSM change",             },
+    { MSG_TOPO_RECORDS,          "Topology records",       },
   };
 
   int i, n = sizeof (NameTab) / sizeof (NameTab[0]);
@@ -350,7 +352,7 @@ msg_read (int fd)
 {
   struct msg *msg;
   struct apimsghdr hdr;
-  u_char buf[OSPF_API_MAX_MSG_SIZE];
+  u_char buf[OSPF_API_TOPO_MAX_MSG_SIZE];
   int bodylen;
   int rlen;
 
@@ -382,6 +384,11 @@ msg_read (int fd)
 
   /* Determine body length. */
   bodylen = ntohs (hdr.msglen);
+  if (bodylen > (int) sizeof (buf))
+    {
+      zlog_warn ("[WRN] msg_read: Message body too long (%d)", bodylen);
+      return NULL;
+    }
   if (bodylen > 0)
     {
 
@@ -413,13 +420,21 @@ msg_read (int fd)
 int
 msg_write (int fd, struct msg *msg)
 {
-  u_char buf[OSPF_API_MAX_MSG_SIZE];
+  /* Topology records are the largest messages written. */
+  u_char buf[sizeof (struct apimsghdr) + OSPF_API_TOPO_MAX_MSG_SIZE];
   int l;
   int wlen;
 
   assert (msg);
   assert (msg->s);
 
+  if (ntohs (msg->hdr.msglen) > OSPF_API_TOPO_MAX_MSG_SIZE)
+    {
+      zlog_warn ("[WRN] msg_write: Message body too long (%d)",
+		 ntohs (msg->hdr.msglen));
+      return -1;
+    }
+
   /* Length of message including header */
   l = sizeof (struct apimsghdr) + ntohs (msg->hdr.msglen);
 
@@ -534,6 +549,19 @@ new_msg_delete_request (u_int32_t seqnum,
 		  sizeof (struct msg_delete_request));
 }
 
+struct msg *
+new_msg_topo_subscribe (u_int32_t seqnum, u_int32_t resume_seq,
+			u_int16_t kindmask)
+{
+  struct msg_topo_subscribe tmsg;
+  tmsg.resume_seq = htonl (resume_seq);
+  tmsg.kindmask = htons (kindmask);
+  memset (&tmsg.pad, 0, sizeof (tmsg.pad));
+
+  return msg_new (MSG_TOPO_SUBSCRIBE, &tmsg, seqnum,
+		  sizeof (struct msg_topo_subscribe));
+}
+
 
 struct msg *
 new_msg_reply (u_int32_t seqnr, u_char rc)
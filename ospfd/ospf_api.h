@@ -116,6 +116,7 @@ extern void msg_fifo_free (struct msg_fifo *fifo);
 #define MSG_SYNC_LSDB             4
 #define MSG_ORIGINATE_REQUEST     5
 #define MSG_DELETE_REQUEST        6
+#define MSG_TOPO_SUBSCRIBE        7
 
 /* Messages from OSPF daemon. */
 #define MSG_REPLY                10
@@ -126,6 +127,7 @@ extern void msg_fifo_free (struct msg_fifo *fifo);
 #define MSG_DEL_IF               15
 #define MSG_ISM_CHANGE           16
 #define MSG_NSM_CHANGE           17
+#define MSG_TOPO_RECORDS         18
 
 struct msg_register_opaque_type
 {
@@ -274,6 +276,51 @@ struct msg_nsm_change
   u_char pad[3];
 };
 
+/* Topology stream.  A client that sends MSG_TOPO_SUBSCRIBE gets the
+   TE and Grid objects of the LSDB as MSG_TOPO_RECORDS messages on the
+   asynchronous channel: a snapshot bracketed by SNAPSHOT_BEGIN/END,
+   then every change as an UPDATE or DELETE record in sequence order.
+   A client that reconnects with the sequence number of the last record
+   it saw is sent only what it missed, if the server still has it, and
+   a fresh snapshot otherwise. */
+
+struct msg_topo_subscribe
+{
+  u_int32_t resume_seq;		/* last record seen, 0 for a snapshot */
+  u_int16_t kindmask;		/* Power2[TOPO_KIND_*], 0 for all */
+  u_char pad[2];
+};
+
+/* MSG_TOPO_RECORDS carries one or more of these back to back, each
+   followed by len octets of value padded to four octets.  The value
+   is the LSA body, i.e. the object's top-level TLV with its sub-TLVs
+   as laid out in ospf_te.h and ospf_grid.h; DELETE and the snapshot
+   markers have none. */
+struct topo_record
+{
+  u_int32_t seq;		/* stream sequence number */
+  u_char op;
+#define TOPO_OP_UPDATE          1
+#define TOPO_OP_DELETE          2
+#define TOPO_OP_SNAPSHOT_BEGIN  3
+#define TOPO_OP_SNAPSHOT_END    4
+  u_char kind;
+#define TOPO_KIND_ROUTER_ADDR   1
+#define TOPO_KIND_TE_LINK       2
+#define TOPO_KIND_NODE_ATTR     3
+#define TOPO_KIND_TNA           4
+#define TOPO_KIND_GRID          5
+  u_int16_t len;		/* value length */
+  struct in_addr area_id;
+  struct in_addr adv_router;
+  struct in_addr lsa_id;
+};
+
+/* Upper bound of a MSG_TOPO_RECORDS body; msg_read() and msg_write()
+   size their buffers by it, so it must not be below
+   OSPF_API_MAX_MSG_SIZE. */
+#define OSPF_API_TOPO_MAX_MSG_SIZE 16384
+
 /* We make use of a union to define a structure that covers all
    possible API messages. This allows us to find out how much memory
    needs to be reserved for the largest API message. */
@@ -287,6 +334,7 @@ struct apimsg
     struct msg_sync_lsdb sync_lsdb;
     struct msg_originate_request originate_request;
     struct msg_delete_request delete_request;
+    struct msg_topo_subscribe topo_subscribe;
     struct msg_reply reply;
     struct msg_ready_notify ready_notify;
     struct msg_new_if new_if;
@@ -324,6 +372,9 @@ extern struct msg *new_msg_delete_request (u_int32_t seqnum,
 					   u_char lsa_type,
 					   u_char opaque_type,
 					   u_int32_t opaque_id);
+extern struct msg *new_msg_topo_subscribe (u_int32_t seqnum,
+					   u_int32_t resume_seq,
+					   u_int16_t kindmask);
 
 /* Messages sent by OSPF daemon */
 extern struct msg *new_msg_reply (u_int32_t seqnum, u_char rc);
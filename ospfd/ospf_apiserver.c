@@ -58,6 +58,8 @@
 #include "ospfd/ospf_route.h"
 #include "ospfd/ospf_ase.h"
 #include "ospfd/ospf_zebra.h"
+#include "ospfd/ospf_opaque.h"
+#include "ospfd/ospf_te.h"
 
 #include "ospfd/ospf_api.h"
 #include "ospfd/ospf_apiserver.h"
@@ -75,6 +77,29 @@
 /* List of all active connections. */
 struct zlist *apiserver_list;
 
+/* Journal of the topology stream, see MSG_TOPO_SUBSCRIBE.  Record
+   seq lives in ring[seq % OSPF_APISERVER_TOPO_JOURNAL]; the latest
+   count records, up to and including seq, are held. */
+struct apiserver_topo_rec
+{
+  u_char kind;
+  struct stream *s;		/* struct topo_record and value */
+};
+
+static struct
+{
+  u_int32_t seq;		/* last sequence number handed out */
+  u_int32_t count;
+  struct apiserver_topo_rec ring[OSPF_APISERVER_TOPO_JOURNAL];
+
+  /* The latest record is a DELETE nobody has been sent yet. */
+  u_char tail_delete;
+
+  struct thread *t_flush;
+} apiserver_topo;
+
+static void apiserver_topo_schedule (void);
+
 /* -----------------------------------------------------------
  * Functions to lookup interfaces
  * -----------------------------------------------------------
@@ -176,6 +201,10 @@ ospf_apiserver_init (void)
   /* Initialize list that keeps track of all connections. */
   apiserver_list = list_new ();
 
+  /* Start the topology stream at a random point, so that a client
+     resuming across a daemon restart gets a snapshot. */
+  apiserver_topo.seq = (u_int32_t) random ();
+
   /* Register opaque-independent call back functions. These functions
      are invoked on ISM, NSM changes and LSA update and LSA deletes */
   rc =
@@ -226,6 +255,20 @@ ospf_apiserver_term (void)
   if (apiserver_list)
     list_delete (apiserver_list);
 
+  /* Drop the topology journal. */
+  if (apiserver_topo.t_flush)
+    thread_cancel (apiserver_topo.t_flush);
+  apiserver_topo.t_flush = NULL;
+  while (apiserver_topo.count > 0)
+    {
+      struct apiserver_topo_rec *rec;
+
+      rec = &apiserver_topo.ring[(apiserver_topo.seq - --apiserver_topo.count)
+                                 % OSPF_APISERVER_TOPO_JOURNAL];
+      stream_free (rec->s);
+      rec->s = NULL;
+    }
+
   /* Free wildcard list */
   /* XXX  */
 }
@@ -317,6 +360,10 @@ ospf_apiserver_new (int fd_sync, int fd_async)
   new->t_sync_write = NULL;
   new->t_async_write = NULL;
 
+  new->topo_subscribed = 0;
+  new->topo_kindmask = 0;
+  new->topo_seq = 0;
+
   new->filter->typemask = 0;	/* filter all LSAs */
   new->filter->origin = ANY_ORIGIN;
   new->filter->num_areas = 0;
@@ -624,6 +671,12 @@ ospf_apiserver_async_write (struct thread *thread)
                             apiserv);
     }
 
+  /* Resume a topology stream paused on a full fifo. */
+  if (apiserv->topo_subscribed
+      && apiserv->topo_seq != apiserver_topo.seq
+      && apiserv->out_async_fifo->count < OSPF_APISERVER_TOPO_FIFO_MAX / 2)
+    apiserver_topo_schedule ();
+
  out:
 
   if (rc < 0)
@@ -894,6 +947,9 @@ ospf_apiserver_handle_msg (struct ospf_apiserver *apiserv, struct msg *msg)
     case MSG_DELETE_REQUEST:
       rc = ospf_apiserver_handle_delete_request (apiserv, msg);
       break;
+    case MSG_TOPO_SUBSCRIBE:
+      rc = ospf_apiserver_handle_topo_subscribe (apiserv, msg);
+      break;
     default:
       zlog_warn ("[WRN] ospf_apiserver_handle_msg: Unknown message type: %d",
 		 msg->hdr.msgtype);
@@ -1471,6 +1527,345 @@ ospf_apiserver_handle_sync_lsdb (struct ospf_apiserver *apiserv,
 }
 
 
+/* -----------------------------------------------------------
+ * Followings are functions for the topology stream.
+ * -----------------------------------------------------------
+ */
+
+/* The instance whose LSDB is streamed, as for MSG_SYNC_LSDB. */
+static struct ospf *
+apiserver_topo_ospf (void)
+{
+  struct ospf *ospf;
+
+  ospf = ospf_inni_lookup ();
+  if (!ospf)
+    ospf = ospf_lookup ();
+  return ospf;
+}
+
+/* Which object an LSA carries, or 0 if it is not streamed. */
+static u_char
+apiserver_topo_kind (struct ospf_lsa *lsa)
+{
+  struct lsa_header *lsah = lsa->data;
+  struct te_tlv_header *tlvh;
+
+  if (lsah->type != OSPF_OPAQUE_AREA_LSA)
+    return 0;
+
+  switch (GET_OPAQUE_TYPE (ntohl (lsah->id.s_addr)))
+    {
+    case OPAQUE_TYPE_TRAFFIC_ENGINEERING_LSA:
+      break;
+#ifdef OPAQUE_TYPE_GRID_LSA
+    case OPAQUE_TYPE_GRID_LSA:
+      return TOPO_KIND_GRID;
+#endif /* OPAQUE_TYPE_GRID_LSA */
+    default:
+      return 0;
+    }
+
+  if (ntohs (lsah->length) < OSPF_LSA_HEADER_SIZE + TLV_HDR_SIZE)
+    return 0;
+
+  tlvh = TLV_HDR_TOP (lsah);
+  switch (ntohs (tlvh->type))
+    {
+    case TE_TLV_ROUTER_ADDR:
+      return TOPO_KIND_ROUTER_ADDR;
+    case TE_TLV_LINK:
+      return TOPO_KIND_TE_LINK;
+    case TE_TLV_NODE_ATTR:
+      return TOPO_KIND_NODE_ATTR;
+    case TE_TLV_TNA_ADDR:
+      return TOPO_KIND_TNA;
+    default:
+      return 0;
+    }
+}
+
+#define APISERVER_TOPO_WANTED(apiserv, kind) \
+  ((apiserv)->topo_kindmask == 0 \
+   || ((apiserv)->topo_kindmask & Power2[(kind)]))
+
+static size_t
+apiserver_topo_size (u_char op, struct ospf_lsa *lsa)
+{
+  size_t size = sizeof (struct topo_record);
+
+  if (op == TOPO_OP_UPDATE)
+    size += ROUNDUP (ntohs (lsa->data->length) - OSPF_LSA_HEADER_SIZE,
+                     sizeof (u_int32_t));
+  return size;
+}
+
+/* Encode one record; lsa is NULL for the snapshot markers. */
+static void
+apiserver_topo_put (struct stream *s, u_int32_t seq, u_char op,
+                    u_char kind, struct ospf_lsa *lsa)
+{
+  size_t len = 0;
+
+  if (op == TOPO_OP_UPDATE)
+    len = ntohs (lsa->data->length) - OSPF_LSA_HEADER_SIZE;
+
+  stream_putl (s, seq);
+  stream_putc (s, op);
+  stream_putc (s, kind);
+  stream_putw (s, len);
+  if (lsa)
+    {
+      stream_put_ipv4 (s, lsa->area ? lsa->area->area_id.s_addr : 0);
+      stream_put_ipv4 (s, lsa->data->adv_router.s_addr);
+      stream_put_ipv4 (s, lsa->data->id.s_addr);
+    }
+  else
+    {
+      stream_putl (s, 0);
+      stream_putl (s, 0);
+      stream_putl (s, 0);
+    }
+  if (len)
+    {
+      stream_put (s, TLV_HDR_TOP (lsa->data), len);
+      while (len++ % sizeof (u_int32_t))
+        stream_putc (s, 0);
+    }
+}
+
+/* Whether an encoded record is about the same object as an LSA. */
+static int
+apiserver_topo_same (struct stream *s, struct ospf_lsa *lsa)
+{
+  struct topo_record *tr = (struct topo_record *) STREAM_DATA (s);
+
+  return (IPV4_ADDR_SAME (&tr->area_id, &lsa->area->area_id)
+          && IPV4_ADDR_SAME (&tr->adv_router, &lsa->data->adv_router)
+          && IPV4_ADDR_SAME (&tr->lsa_id, &lsa->data->id));
+}
+
+/* Queue what has been batched so far on the asynchronous channel. */
+static void
+apiserver_topo_push (struct ospf_apiserver *apiserv, struct stream *s)
+{
+  struct msg *msg;
+
+  if (stream_get_endp (s) == 0)
+    return;
+
+  msg = msg_new (MSG_TOPO_RECORDS, STREAM_DATA (s), 0, stream_get_endp (s));
+  msg_fifo_push (apiserv->out_async_fifo, msg);
+  ospf_apiserver_event (OSPF_APISERVER_ASYNC_WRITE, apiserv->fd_async,
+                        apiserv);
+  stream_reset (s);
+}
+
+/* Send the whole topology as of the current sequence number.  It goes
+   out in one go, regardless of the fifo limit, so that the snapshot
+   and the journal position the client continues from agree. */
+static void
+apiserver_topo_snapshot (struct ospf_apiserver *apiserv)
+{
+  struct zlistnode *node;
+  struct ospf_area *area;
+  struct route_node *rn;
+  struct ospf_lsa *lsa;
+  struct stream *s;
+  struct ospf *ospf;
+  u_int32_t seq = apiserver_topo.seq;
+  unsigned long sent = 0;
+
+  s = stream_new (OSPF_API_TOPO_MAX_MSG_SIZE);
+  apiserver_topo_put (s, seq, TOPO_OP_SNAPSHOT_BEGIN, 0, NULL);
+
+  if ((ospf = apiserver_topo_ospf ()) != NULL)
+    for (ALL_LIST_ELEMENTS_RO (ospf->areas, node, area))
+      LSDB_LOOP (OPAQUE_AREA_LSDB (area), rn, lsa)
+        {
+          u_char kind;
+          size_t size;
+
+          if (IS_LSA_MAXAGE (lsa)
+              || (kind = apiserver_topo_kind (lsa)) == 0
+              || !APISERVER_TOPO_WANTED (apiserv, kind))
+            continue;
+
+          size = apiserver_topo_size (TOPO_OP_UPDATE, lsa);
+          if (size > OSPF_API_TOPO_MAX_MSG_SIZE)
+            continue;
+          if (STREAM_WRITEABLE (s) < size)
+            apiserver_topo_push (apiserv, s);
+          apiserver_topo_put (s, seq, TOPO_OP_UPDATE, kind, lsa);
+          sent++;
+        }
+
+  if (STREAM_WRITEABLE (s) < sizeof (struct topo_record))
+    apiserver_topo_push (apiserv, s);
+  apiserver_topo_put (s, seq, TOPO_OP_SNAPSHOT_END, 0, NULL);
+  apiserver_topo_push (apiserv, s);
+  stream_free (s);
+
+  apiserv->topo_seq = seq;
+  apiserver_topo.tail_delete = 0;
+
+  if (IS_DEBUG_OSPF_EVENT)
+    zlog_debug ("API: Topology snapshot to apiserv(%p): %lu objects, seq %u",
+                apiserv, sent, seq);
+}
+
+/* Catch a client up with the journal, batching records into as few
+   messages as possible.  Stops while the client's fifo is full; the
+   async write thread picks the stream up again once it drains. */
+static void
+apiserver_topo_send (struct ospf_apiserver *apiserv)
+{
+  struct apiserver_topo_rec *rec;
+  struct stream *s;
+
+  if (apiserv->topo_seq == apiserver_topo.seq
+      || apiserv->out_async_fifo->count >= OSPF_APISERVER_TOPO_FIFO_MAX)
+    return;
+
+  /* Records no longer held; only a new snapshot can catch it up. */
+  if ((u_int32_t)(apiserver_topo.seq - apiserv->topo_seq)
+      > apiserver_topo.count)
+    {
+      apiserver_topo_snapshot (apiserv);
+      return;
+    }
+
+  apiserver_topo.tail_delete = 0;
+
+  s = stream_new (OSPF_API_TOPO_MAX_MSG_SIZE);
+  while (apiserv->topo_seq != apiserver_topo.seq)
+    {
+      rec = &apiserver_topo.ring[(apiserv->topo_seq + 1)
+                                 % OSPF_APISERVER_TOPO_JOURNAL];
+      if (APISERVER_TOPO_WANTED (apiserv, rec->kind))
+        {
+          if (STREAM_WRITEABLE (s) < stream_get_endp (rec->s))
+            {
+              apiserver_topo_push (apiserv, s);
+              if (apiserv->out_async_fifo->count
+                  >= OSPF_APISERVER_TOPO_FIFO_MAX)
+                break;
+            }
+          stream_put (s, STREAM_DATA (rec->s), stream_get_endp (rec->s));
+        }
+      apiserv->topo_seq++;
+    }
+  apiserver_topo_push (apiserv, s);
+  stream_free (s);
+}
+
+static int
+apiserver_topo_flush (struct thread *thread)
+{
+  struct zlistnode *node, *nnode;
+  struct ospf_apiserver *apiserv;
+
+  apiserver_topo.t_flush = NULL;
+
+  for (ALL_LIST_ELEMENTS (apiserver_list, node, nnode, apiserv))
+    if (apiserv->topo_subscribed)
+      apiserver_topo_send (apiserv);
+
+  return 0;
+}
+
+static void
+apiserver_topo_schedule (void)
+{
+  if (apiserver_topo.t_flush == NULL)
+    apiserver_topo.t_flush =
+      thread_add_event (master, apiserver_topo_flush, NULL, 0);
+}
+
+/* Append an LSA change to the journal and wake the subscribers. */
+static void
+apiserver_topo_journal (u_char op, struct ospf_lsa *lsa)
+{
+  struct apiserver_topo_rec *rec;
+  struct ospf *ospf;
+  struct stream *s;
+  size_t size;
+  u_char kind;
+
+  if ((kind = apiserver_topo_kind (lsa)) == 0)
+    return;
+  if (lsa->area == NULL || (ospf = apiserver_topo_ospf ()) == NULL
+      || lsa->area->ospf != ospf)
+    return;
+
+  size = apiserver_topo_size (op, lsa);
+  if (size > OSPF_API_TOPO_MAX_MSG_SIZE)
+    {
+      zlog_warn ("[WRN] apiserver_topo_journal: LSA[%s] too long to stream",
+                 dump_lsa_key (lsa));
+      return;
+    }
+
+  /* The LSDB replaces an instance by deleting the old one and adding
+     the new one.  Fold that into a single UPDATE if the DELETE has not
+     gone out yet, rather than making clients drop and re-add it. */
+  rec = &apiserver_topo.ring[apiserver_topo.seq % OSPF_APISERVER_TOPO_JOURNAL];
+  if (op == TOPO_OP_UPDATE && apiserver_topo.tail_delete
+      && apiserver_topo_same (rec->s, lsa))
+    {
+      stream_free (rec->s);
+    }
+  else
+    {
+      apiserver_topo.seq++;
+      rec = &apiserver_topo.ring[apiserver_topo.seq
+                                 % OSPF_APISERVER_TOPO_JOURNAL];
+      if (apiserver_topo.count == OSPF_APISERVER_TOPO_JOURNAL)
+        stream_free (rec->s);
+      else
+        apiserver_topo.count++;
+    }
+
+  s = stream_new (size);
+  apiserver_topo_put (s, apiserver_topo.seq, op, kind, lsa);
+  rec->kind = kind;
+  rec->s = s;
+  apiserver_topo.tail_delete = (op == TOPO_OP_DELETE);
+
+  apiserver_topo_schedule ();
+}
+
+int
+ospf_apiserver_handle_topo_subscribe (struct ospf_apiserver *apiserv,
+                                      struct msg *msg)
+{
+  struct msg_topo_subscribe *tmsg;
+  u_int32_t seqnum;
+  u_int32_t resume;
+
+  tmsg = (struct msg_topo_subscribe *) STREAM_DATA (msg->s);
+
+  /* Get request sequence number */
+  seqnum = msg_get_seq (msg);
+
+  resume = ntohl (tmsg->resume_seq);
+  apiserv->topo_kindmask = ntohs (tmsg->kindmask);
+  apiserv->topo_subscribed = 1;
+
+  /* Resume from the journal if it still holds everything after the
+     client's last record, else start over with a snapshot. */
+  if (resume != 0
+      && (u_int32_t)(apiserver_topo.seq - resume) <= apiserver_topo.count)
+    apiserv->topo_seq = resume;
+  else
+    apiserver_topo_snapshot (apiserv);
+
+  apiserver_topo_send (apiserv);
+
+  /* Send a reply back to client with return code */
+  return ospf_apiserver_send_reply (apiserv, seqnum, OSPF_API_OK);
+}
+
 /* -----------------------------------------------------------
  * Followings are functions to originate or update LSA
  * from an application.
@@ -2646,12 +3041,15 @@ apiserver_notify_clients_lsa (u_char msgtype, struct ospf_lsa *lsa)
 int
 ospf_apiserver_lsa_update (struct ospf_lsa *lsa)
 {
+  if (!IS_LSA_MAXAGE (lsa))
+    apiserver_topo_journal (TOPO_OP_UPDATE, lsa);
   return apiserver_notify_clients_lsa (MSG_LSA_UPDATE_NOTIFY, lsa);
 }
 
 int
 ospf_apiserver_lsa_delete (struct ospf_lsa *lsa)
 {
+  apiserver_topo_journal (TOPO_OP_DELETE, lsa);
   return apiserver_notify_clients_lsa (MSG_LSA_DELETE_NOTIFY, lsa);
 }
 
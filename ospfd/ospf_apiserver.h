@@ -26,6 +26,13 @@
 /* MTYPE definition is not reflected to "memory.h". */
 #define MTYPE_OSPF_APISERVER MTYPE_TMP
 #define MTYPE_OSPF_APISERVER_MSGFILTER MTYPE_TMP
+#define MTYPE_OSPF_APISERVER_TOPO MTYPE_TMP
+
+/* Number of topology records kept for clients resuming a stream, and
+   how many unsent messages a client's async fifo may hold before the
+   stream to it pauses until the fifo drains. */
+#define OSPF_APISERVER_TOPO_JOURNAL 4096
+#define OSPF_APISERVER_TOPO_FIFO_MAX 64
 
 /* List of opaque types that application registered */
 struct registered_opaque_type
@@ -58,6 +65,12 @@ struct ospf_apiserver
   /* filter for LSA update/delete notifies */
   struct lsa_filter_type *filter;
 
+  /* Topology stream: set by MSG_TOPO_SUBSCRIBE, topo_seq is the
+     last journal record the client has been sent. */
+  u_char topo_subscribed;
+  u_int16_t topo_kindmask;
+  u_int32_t topo_seq;
+
   /* Fifo buffers for outgoing messages */
   struct msg_fifo *out_sync_fifo;
   struct msg_fifo *out_async_fifo;
@@ -144,6 +157,8 @@ extern int ospf_apiserver_handle_delete_request (struct ospf_apiserver *apiserv,
 					  struct msg *msg);
 extern int ospf_apiserver_handle_sync_lsdb (struct ospf_apiserver *apiserv,
 				     struct msg *msg);
+extern int ospf_apiserver_handle_topo_subscribe (struct ospf_apiserver *apiserv,
+					  struct msg *msg);
 
 
 /* -----------------------------------------------------------
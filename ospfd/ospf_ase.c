@@ -617,7 +617,8 @@ ospf_ase_compare_tables (struct route_table *new_external_route,
     if ((or = rn->info) != NULL)
       if (! ospf_ase_route_match_same (old_external_route, &rn->p, or))
 	ospf_zebra_add ((struct prefix_ipv4 *) &rn->p, or);
-				       
+
+  ospf_zebra_route_flush ();
   return 0;
 }
 
@@ -31,6 +31,8 @@
 #include "memory.h"
 #include "log.h"
 #include "zclient.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_interface.h"
@@ -773,10 +775,201 @@ ospf_flood_through (struct ospf *ospf,
 
 
 
+/* LSAs in flight: for every LSA currently asked for in an outstanding
+ * LS Request, the number of neighbors it has been asked from. Used to
+ * split requests among adjacencies that are loading the same LSAs.
+ */
+struct ospf_ls_req_entry
+{
+  u_char type;
+  struct in_addr id;
+  struct in_addr adv_router;
+
+  /* Flooding scope: area ID, or 0.0.0.0 for AS-scoped LSAs. */
+  struct in_addr scope;
+
+  unsigned int count;
+};
+
+static unsigned int
+ospf_ls_req_entry_key (void *data)
+{
+  struct ospf_ls_req_entry *entry = data;
+
+  return jhash_3words (entry->type, entry->id.s_addr,
+		       entry->adv_router.s_addr, entry->scope.s_addr);
+}
+
+static int
+ospf_ls_req_entry_cmp (void *a, void *b)
+{
+  struct ospf_ls_req_entry *e1 = a;
+  struct ospf_ls_req_entry *e2 = b;
+
+  return (e1->type == e2->type
+	  && e1->id.s_addr == e2->id.s_addr
+	  && e1->adv_router.s_addr == e2->adv_router.s_addr
+	  && e1->scope.s_addr == e2->scope.s_addr);
+}
+
+static void *
+ospf_ls_req_entry_alloc (void *data)
+{
+  struct ospf_ls_req_entry *key = data;
+  struct ospf_ls_req_entry *new;
+
+  new = XCALLOC (MTYPE_OSPF_LS_REQ_INFLIGHT, sizeof (struct ospf_ls_req_entry));
+  new->type = key->type;
+  new->id = key->id;
+  new->adv_router = key->adv_router;
+  new->scope = key->scope;
+
+  return new;
+}
+
+static void
+ospf_ls_req_entry_free (void *data)
+{
+  XFREE (MTYPE_OSPF_LS_REQ_INFLIGHT, data);
+}
+
+/* Returns 0 for link-scoped LSAs, which are never shared between
+   adjacencies. */
+static int
+ospf_ls_req_entry_key_set (struct ospf_ls_req_entry *key,
+			   struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
+{
+  key->type = lsa->data->type;
+  key->id = lsa->data->id;
+  key->adv_router = lsa->data->adv_router;
+
+  switch (lsa->data->type)
+    {
+#ifdef HAVE_OPAQUE_LSA
+    case OSPF_OPAQUE_LINK_LSA:
+      return 0;
+    case OSPF_OPAQUE_AS_LSA:
+#endif /* HAVE_OPAQUE_LSA */
+    case OSPF_AS_EXTERNAL_LSA:
+      key->scope.s_addr = 0;
+      break;
+    default:
+      key->scope = nbr->oi->area->area_id;
+      break;
+    }
+
+  return 1;
+}
+
+struct hash *
+ospf_ls_request_inflight_new (void)
+{
+  return hash_create (ospf_ls_req_entry_key, ospf_ls_req_entry_cmp);
+}
+
+void
+ospf_ls_request_inflight_free (struct hash *inflight)
+{
+  hash_clean (inflight, ospf_ls_req_entry_free);
+  hash_free (inflight);
+}
+
+/* LSA on the neighbor's ls-request list has been put in an LS Request. */
+void
+ospf_ls_request_mark (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
+{
+  struct ospf_ls_req_entry key;
+  struct ospf_ls_req_entry *entry;
+
+  if (CHECK_FLAG (lsa->flags, OSPF_LSA_REQUESTED))
+    return;
+
+  SET_FLAG (lsa->flags, OSPF_LSA_REQUESTED);
+
+  if (! ospf_ls_req_entry_key_set (&key, nbr, lsa))
+    return;
+
+  entry = hash_get (nbr->oi->ospf->ls_req_inflight, &key,
+		    ospf_ls_req_entry_alloc);
+  entry->count++;
+}
+
+static void
+ospf_ls_request_unmark (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
+{
+  struct ospf_ls_req_entry key;
+  struct ospf_ls_req_entry *entry;
+
+  if (! CHECK_FLAG (lsa->flags, OSPF_LSA_REQUESTED))
+    return;
+
+  UNSET_FLAG (lsa->flags, OSPF_LSA_REQUESTED);
+
+  if (! ospf_ls_req_entry_key_set (&key, nbr, lsa))
+    return;
+
+  entry = hash_lookup (nbr->oi->ospf->ls_req_inflight, &key);
+  if (entry != NULL && --entry->count == 0)
+    {
+      hash_release (nbr->oi->ospf->ls_req_inflight, entry);
+      ospf_ls_req_entry_free (entry);
+    }
+}
+
+/* Is the LSA already being requested from another neighbor? */
+int
+ospf_ls_request_pending_elsewhere (struct ospf_neighbor *nbr,
+				   struct ospf_lsa *lsa)
+{
+  struct ospf_ls_req_entry key;
+  struct ospf_ls_req_entry *entry;
+  unsigned int own;
+
+  if (! ospf_ls_req_entry_key_set (&key, nbr, lsa))
+    return 0;
+
+  if ((entry = hash_lookup (nbr->oi->ospf->ls_req_inflight, &key)) == NULL)
+    return 0;
+
+  own = CHECK_FLAG (lsa->flags, OSPF_LSA_REQUESTED) ? 1 : 0;
+
+  return entry->count > own;
+}
+
+/* Forget every outstanding LS Request to the neighbor, so that the
+   whole ls-request list is asked for again. */
+void
+ospf_ls_request_inflight_clear (struct ospf_neighbor *nbr)
+{
+  struct ospf_lsa *lsa;
+  int i;
+
+  while (listcount (nbr->ls_req_inflight))
+    {
+      lsa = listgetdata (listhead (nbr->ls_req_inflight));
+      list_delete_node (nbr->ls_req_inflight, listhead (nbr->ls_req_inflight));
+      ospf_lsa_unlock (&lsa); /* ls_req_inflight */
+    }
+
+  for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
+    {
+      struct route_table *table = nbr->ls_req.type[i].db;
+      struct route_node *rn;
+
+      for (rn = route_top (table); rn; rn = route_next (rn))
+	if ((lsa = rn->info) != NULL)
+	  ospf_ls_request_unmark (nbr, lsa);
+    }
+}
+
 /* Management functions for neighbor's Link State Request list. */
 void
 ospf_ls_request_add (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 {
+  struct ospf_lsa *old;
+  struct zlistnode *node;
+  int requested = 0;
+
   /*
    * We cannot make use of the newly introduced callback function
    * "lsdb->new_lsa_hook" to replace debug output below, just because
@@ -788,7 +981,27 @@ ospf_ls_request_add (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
                   ospf_ls_request_count (nbr),
                   inet_ntoa (nbr->router_id), dump_lsa_key (lsa));
 
+  /* A newer instance replaces a copy already on the list.  LS Requests
+     carry no sequence number, so one in flight for the old copy asks
+     for the new one as well: hand its mark over to the new copy. */
+  old = ospf_lsdb_lookup (&nbr->ls_req, lsa);
+  if (old != NULL && old != lsa)
+    {
+      requested = CHECK_FLAG (old->flags, OSPF_LSA_REQUESTED);
+      ospf_ls_request_unmark (nbr, old);
+
+      /* The answer to that request will be matched to the new copy. */
+      if ((node = listnode_lookup (nbr->ls_req_inflight, old)) != NULL)
+	{
+	  node->data = ospf_lsa_lock (lsa);
+	  ospf_lsa_unlock (&old); /* ls_req_inflight */
+	}
+    }
+
   ospf_lsdb_add (&nbr->ls_req, lsa);
+
+  if (requested)
+    ospf_ls_request_mark (nbr, lsa);
 }
 
 unsigned long
@@ -807,12 +1020,17 @@ ospf_ls_request_isempty (struct ospf_neighbor *nbr)
 void
 ospf_ls_request_delete (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 {
-  if (nbr->ls_req_last == lsa)
+  struct zlistnode *node;
+
+  /* Answer to the last LSA of an outstanding LS Request. */
+  if ((node = listnode_lookup (nbr->ls_req_inflight, lsa)) != NULL)
     {
-      ospf_lsa_unlock (&nbr->ls_req_last);
-      nbr->ls_req_last = NULL;
+      list_delete_node (nbr->ls_req_inflight, node);
+      ospf_lsa_unlock (&lsa); /* ls_req_inflight */
     }
 
+  ospf_ls_request_unmark (nbr, lsa);
+
   if (IS_DEBUG_OSPF (lsa, LSA_FLOODING))	/* -- endo. */
       zlog_debug ("[DBG] RqstL(%lu)--, NBR(%s), LSA[%s]",
                   ospf_ls_request_count (nbr),
@@ -825,8 +1043,7 @@ ospf_ls_request_delete (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 void
 ospf_ls_request_delete_all (struct ospf_neighbor *nbr)
 {
-  ospf_lsa_unlock (&nbr->ls_req_last);
-  nbr->ls_req_last = NULL;
+  ospf_ls_request_inflight_clear (nbr);
   ospf_lsdb_delete_all (&nbr->ls_req);
 }
 
@@ -850,6 +1067,153 @@ ospf_ls_request_new (struct lsa_header *lsah)
 }
 
 
+/* Retransmit index: for every LSA pending on some neighbor's
+ * ls-retransmit list, the bitmap of neighbor slots it is pending for.
+ * Keyed by (type, id, adv_router) so that any instance of the LSA finds
+ * the neighbors holding an older or equal copy without walking every
+ * neighbor of every interface.
+ */
+struct ospf_ls_rxmt_entry
+{
+  u_char type;
+  struct in_addr id;
+  struct in_addr adv_router;
+
+  /* Number of bits set. */
+  unsigned int count;
+
+  /* Bitmap of neighbor slots, "words" 32-bit words long. */
+  unsigned int words;
+  u_int32_t *nbrs;
+};
+
+static unsigned int
+ospf_ls_rxmt_entry_key (void *data)
+{
+  struct ospf_ls_rxmt_entry *entry = data;
+
+  return jhash_3words (entry->type, entry->id.s_addr,
+		       entry->adv_router.s_addr, 0);
+}
+
+static int
+ospf_ls_rxmt_entry_cmp (void *a, void *b)
+{
+  struct ospf_ls_rxmt_entry *e1 = a;
+  struct ospf_ls_rxmt_entry *e2 = b;
+
+  return (e1->type == e2->type
+	  && e1->id.s_addr == e2->id.s_addr
+	  && e1->adv_router.s_addr == e2->adv_router.s_addr);
+}
+
+static void *
+ospf_ls_rxmt_entry_alloc (void *data)
+{
+  struct ospf_ls_rxmt_entry *key = data;
+  struct ospf_ls_rxmt_entry *new;
+
+  new = XCALLOC (MTYPE_OSPF_LS_RXMT_INDEX, sizeof (struct ospf_ls_rxmt_entry));
+  new->type = key->type;
+  new->id = key->id;
+  new->adv_router = key->adv_router;
+
+  return new;
+}
+
+static void
+ospf_ls_rxmt_entry_free (void *data)
+{
+  struct ospf_ls_rxmt_entry *entry = data;
+
+  if (entry->nbrs)
+    XFREE (MTYPE_OSPF_LS_RXMT_INDEX, entry->nbrs);
+  XFREE (MTYPE_OSPF_LS_RXMT_INDEX, entry);
+}
+
+struct hash *
+ospf_ls_rxmt_index_new (void)
+{
+  return hash_create (ospf_ls_rxmt_entry_key, ospf_ls_rxmt_entry_cmp);
+}
+
+void
+ospf_ls_rxmt_index_free (struct hash *index)
+{
+  hash_clean (index, ospf_ls_rxmt_entry_free);
+  hash_free (index);
+}
+
+static void
+ospf_ls_rxmt_entry_key_set (struct ospf_ls_rxmt_entry *key,
+			    struct ospf_lsa *lsa)
+{
+  key->type = lsa->data->type;
+  key->id = lsa->data->id;
+  key->adv_router = lsa->data->adv_router;
+}
+
+/* Mark LSA as pending for the neighbor. */
+static void
+ospf_ls_rxmt_index_set (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
+{
+  struct ospf_ls_rxmt_entry key;
+  struct ospf_ls_rxmt_entry *entry;
+  unsigned int word = nbr->slot / 32;
+  u_int32_t bit = 1U << (nbr->slot % 32);
+
+  ospf_ls_rxmt_entry_key_set (&key, lsa);
+  entry = hash_get (nbr->oi->ospf->ls_rxmt_index, &key,
+		    ospf_ls_rxmt_entry_alloc);
+
+  if (word >= entry->words)
+    {
+      u_int32_t *nbrs;
+
+      nbrs = XCALLOC (MTYPE_OSPF_LS_RXMT_INDEX,
+		      (word + 1) * sizeof (u_int32_t));
+      if (entry->nbrs)
+	{
+	  memcpy (nbrs, entry->nbrs, entry->words * sizeof (u_int32_t));
+	  XFREE (MTYPE_OSPF_LS_RXMT_INDEX, entry->nbrs);
+	}
+      entry->nbrs = nbrs;
+      entry->words = word + 1;
+    }
+
+  if (! CHECK_FLAG (entry->nbrs[word], bit))
+    {
+      SET_FLAG (entry->nbrs[word], bit);
+      entry->count++;
+    }
+}
+
+/* LSA is no longer pending for the neighbor. */
+static void
+ospf_ls_rxmt_index_unset (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
+{
+  struct ospf_ls_rxmt_entry key;
+  struct ospf_ls_rxmt_entry *entry;
+  unsigned int word = nbr->slot / 32;
+  u_int32_t bit = 1U << (nbr->slot % 32);
+
+  ospf_ls_rxmt_entry_key_set (&key, lsa);
+  entry = hash_lookup (nbr->oi->ospf->ls_rxmt_index, &key);
+
+  if (entry == NULL || word >= entry->words
+      || ! CHECK_FLAG (entry->nbrs[word], bit))
+    return;
+
+  UNSET_FLAG (entry->nbrs[word], bit);
+
+  if (--entry->count == 0)
+    {
+      hash_release (nbr->oi->ospf->ls_rxmt_index, entry);
+      ospf_ls_rxmt_entry_free (entry);
+    }
+}
+
+
 /* Management functions for neighbor's ls-retransmit list. */
 unsigned long
 ospf_ls_retransmit_count (struct ospf_neighbor *nbr)
@@ -883,6 +1247,7 @@ ospf_ls_retransmit_add (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 	{
 	  old->retransmit_counter--;
 	  ospf_lsdb_delete (&nbr->ls_rxmt, old);
+	  ospf_ls_rxmt_index_unset (nbr, old);
 	}
       lsa->retransmit_counter++;
       /*
@@ -896,6 +1261,7 @@ ospf_ls_retransmit_add (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
                      ospf_ls_retransmit_count (nbr),
 		     inet_ntoa (nbr->router_id), dump_lsa_key (lsa));
       ospf_lsdb_add (&nbr->ls_rxmt, lsa);
+      ospf_ls_rxmt_index_set (nbr, lsa);
     }
 }
 
@@ -911,6 +1277,7 @@ ospf_ls_retransmit_delete (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
                      ospf_ls_retransmit_count (nbr),
 		     inet_ntoa (nbr->router_id), dump_lsa_key (lsa));
       ospf_lsdb_delete (&nbr->ls_rxmt, lsa);
+      ospf_ls_rxmt_index_unset (nbr, lsa);
     }
 }
 
@@ -934,8 +1301,7 @@ ospf_ls_retransmit_clear (struct ospf_neighbor *nbr)
 	  ospf_ls_retransmit_delete (nbr, lsa);
     }
 
-  ospf_lsa_unlock (&nbr->ls_req_last);
-  nbr->ls_req_last = NULL;
+  ospf_ls_request_inflight_clear (nbr);
 }
 
 /* Lookup LSA from neighbor's ls-retransmit list. */
@@ -945,50 +1311,72 @@ ospf_ls_retransmit_lookup (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
   return ospf_lsdb_lookup (&nbr->ls_rxmt, lsa);
 }
 
+/* Remove the LSA instance from the ls-retransmit list of every neighbor
+ * it is pending for, restricted to neighbors in area when area is not
+ * NULL. Only the neighbors found in the retransmit index are visited.
+ */
 static void
-ospf_ls_retransmit_delete_nbr_if (struct ospf_interface *oi,
-				  struct ospf_lsa *lsa)
+ospf_ls_retransmit_delete_nbr_index (struct ospf *ospf,
+				     struct ospf_area *area,
+				     struct ospf_lsa *lsa)
 {
-  struct route_node *rn;
+  struct ospf_ls_rxmt_entry key;
+  struct ospf_ls_rxmt_entry *entry;
   struct ospf_neighbor *nbr;
   struct ospf_lsa *lsr;
+  unsigned int word;
+  unsigned int words;
+  u_int32_t pending;
+  int i;
+
+  ospf_ls_rxmt_entry_key_set (&key, lsa);
+  if ((entry = hash_lookup (ospf->ls_rxmt_index, &key)) == NULL)
+    return;
+
+  /* The entry goes away together with its last bit, so look it up
+     again for every word and iterate over a snapshot of the word. */
+  words = entry->words;
+  for (word = 0; word < words; word++)
+    {
+      if ((entry = hash_lookup (ospf->ls_rxmt_index, &key)) == NULL)
+	return;
 
-  if (ospf_if_is_enable (oi))
-    for (rn = route_top (oi->nbrs); rn; rn = route_next (rn))
-      /* If LSA find in LS-retransmit list, then remove it. */
-      if ((nbr = rn->info) != NULL)
+      pending = entry->nbrs[word];
+      for (i = 0; pending != 0; i++, pending >>= 1)
 	{
+	  if (! CHECK_FLAG (pending, 1))
+	    continue;
+
+	  nbr = vector_slot (ospf->nbr_slots, word * 32 + i);
+	  if (nbr == NULL || ! ospf_if_is_enable (nbr->oi))
+	    continue;
+	  if (area != NULL && nbr->oi->area != area)
+	    continue;
+
 	  lsr = ospf_ls_retransmit_lookup (nbr, lsa);
-	     
+
 	  /* If LSA find in ls-retransmit list, remove it. */
 	  if (lsr != NULL && lsr->data->ls_seqnum == lsa->data->ls_seqnum)
 	    ospf_ls_retransmit_delete (nbr, lsr);
 	}
+    }
 }
 
 void
 ospf_ls_retransmit_delete_nbr_area (struct ospf_area *area,
 				    struct ospf_lsa *lsa)
 {
-  struct zlistnode *node, *nnode;
-  struct ospf_interface *oi;
+  if (IS_DEBUG_OSPF_EVENT)
+    zlog_debug ("[DBG] ospf_ls_retransmit_delete_nbr_area: LSA[%s]",
+                dump_lsa_key (lsa));
 
-  for (ALL_LIST_ELEMENTS (area->oiflist, node, nnode, oi))
-  {
-    if (IS_DEBUG_OSPF_EVENT)
-      zlog_debug("[DBG] ospf_ls_retransmit_delete_nbr_area: interface %s ar %s", oi->ifp->name, inet_ntoa(lsa->data->adv_router));
-    ospf_ls_retransmit_delete_nbr_if (oi, lsa);
-  }
+  ospf_ls_retransmit_delete_nbr_index (area->ospf, area, lsa);
 }
 
 void
 ospf_ls_retransmit_delete_nbr_as (struct ospf *ospf, struct ospf_lsa *lsa)
 {
-  struct zlistnode *node, *nnode;
-  struct ospf_interface *oi;
-
-  for (ALL_LIST_ELEMENTS (ospf->oiflist, node, nnode, oi))
-    ospf_ls_retransmit_delete_nbr_if (oi, lsa);
+  ospf_ls_retransmit_delete_nbr_index (ospf, NULL, lsa);
 }
 
 
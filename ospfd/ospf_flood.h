@@ -43,6 +43,12 @@ extern void ospf_ls_request_delete (struct ospf_neighbor *,
 extern void ospf_ls_request_delete_all (struct ospf_neighbor *);
 extern struct ospf_lsa *ospf_ls_request_lookup (struct ospf_neighbor *,
 						struct ospf_lsa *);
+extern void ospf_ls_request_mark (struct ospf_neighbor *, struct ospf_lsa *);
+extern int ospf_ls_request_pending_elsewhere (struct ospf_neighbor *,
+					      struct ospf_lsa *);
+extern void ospf_ls_request_inflight_clear (struct ospf_neighbor *);
+extern struct hash *ospf_ls_request_inflight_new (void);
+extern void ospf_ls_request_inflight_free (struct hash *);
 
 extern unsigned long ospf_ls_retransmit_count (struct ospf_neighbor *);
 extern unsigned long ospf_ls_retransmit_count_self (struct ospf_neighbor *,
@@ -61,6 +67,8 @@ extern void ospf_ls_retransmit_delete_nbr_as (struct ospf *,
 					      struct ospf_lsa *);
 extern void ospf_ls_retransmit_add_nbr_all (struct ospf_interface *,
 					    struct ospf_lsa *);
+extern struct hash *ospf_ls_rxmt_index_new (void);
+extern void ospf_ls_rxmt_index_free (struct hash *);
 
 extern void ospf_flood_lsa_area (struct ospf_lsa *, struct ospf_area *);
 extern void ospf_flood_lsa_as (struct ospf_lsa *);
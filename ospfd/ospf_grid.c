@@ -1403,6 +1403,14 @@ int ospf_grid_init (void)
     zlog_warn ("[WRN] ospf_grid_init: Failed to register functions");
     goto out;
   }
+  /* Calendar entries are replaced on every Grid LSA refresh. */
+  memory_slab_enable (MTYPE_OSPF_GRID_COMPUTING_CALENDAR,
+                      sizeof (struct ce_calendar));
+  memory_slab_enable (MTYPE_OSPF_GRID_SUBCLUSTER_CALENDAR,
+                      sizeof (struct sc_calendar));
+  memory_slab_enable (MTYPE_OSPF_GRID_SERVICE_CALENDAR,
+                      sizeof (struct se_calendar));
+
   memset (&OspfGRID, 0, sizeof (struct ospf_grid));
   OspfGRID.status = enabled;        /* GRID enabled */
   OspfGRID.iflist = list_new ();
@@ -3416,10 +3424,11 @@ static int ospf_grid_new_lsa(struct ospf_lsa *lsa)
 
             struct ospf *ospf_inni = ospf_inni_lookup();
             if (ospf_inni)
-              tlvh->routerID = ospf_inni->router_id;
-
-            /* don't forget about Re-calculating checksum. */
-            ospf_lsa_checksum (lsah);
+              /* Only the router ID changes, patch the checksum for it. */
+              ospf_lsa_checksum_update (lsah,
+                                        (u_char *) &tlvh->routerID - (u_char *) lsah,
+                                        &ospf_inni->router_id,
+                                        sizeof (struct in_addr));
           }
           uni_to_inni(lsa, 0);
         }
@@ -238,6 +238,9 @@ ospf_if_new (struct ospf *ospf, struct interface *ifp, struct prefix *p)
   /** Set default values. */
   ospf_if_reset_variables (oi);
 
+  /* The pseudo neighbor takes a slot in ospf->nbr_slots. */
+  oi->ospf = ospf;
+
   /** Add pseudo neighbor. */
   oi->nbr_self = ospf_nbr_new (oi);
 
@@ -251,8 +254,6 @@ ospf_if_new (struct ospf *ospf, struct interface *ifp, struct prefix *p)
   ospf_opaque_type9_lsa_init (oi);
 #endif /* HAVE_OPAQUE_LSA */
 
-  oi->ospf = ospf;
-
   return oi;
 }
 
@@ -172,39 +172,62 @@ get_age (struct ospf_lsa *lsa)
 
 
 /* Fletcher Checksum -- Refer to RFC1008. */
-#define MODX                 4102
 #define LSA_CHECKSUM_OFFSET    15
 
+/* Lane weights for the word-at-a-time loop below.  A 64-bit word is
+ * split into its even and odd bytes, each spread over four 16-bit
+ * lanes; multiplying by these constants leaves in the top lane the sum
+ * of the bytes weighted 8, 7, ... 1 in memory order. */
+#if BYTE_ORDER == LITTLE_ENDIAN
+#define LSA_CKSUM_WEIGHT_EVEN  0x0008000600040002ULL
+#define LSA_CKSUM_WEIGHT_ODD   0x0007000500030001ULL
+#else
+#define LSA_CKSUM_WEIGHT_EVEN  0x0001000300050007ULL
+#define LSA_CKSUM_WEIGHT_ODD   0x0002000400060008ULL
+#endif /* BYTE_ORDER */
+#define LSA_CKSUM_LANES        0x00ff00ff00ff00ffULL
+#define LSA_CKSUM_ONES         0x0001000100010001ULL
+
 u_int16_t
 ospf_lsa_checksum (struct lsa_header *lsa)
 {
-  u_char *sp, *ep, *p, *q;
-  int c0 = 0, c1 = 0;
+  u_char *p, *ep;
+  u_int64_t c0 = 0, c1 = 0;
+  u_int64_t w, even, odd;
   int x, y;
   u_int16_t length;
 
   lsa->checksum = 0;
   length = ntohs (lsa->length) - 2;
-  sp = (u_char *) &lsa->options;
-
-  for (ep = sp + length; sp < ep; sp = q)
+  p = (u_char *) &lsa->options;
+  ep = p + length;
+
+  /* Eight bytes per step: c1 gains 8 * c0 plus the bytes weighted by
+   * how many of the eight single steps they survive, then c0 gains
+   * their sum.  No lane can overflow (8 * 255 * 8 < 65536), and with
+   * 64-bit accumulators no LSA length can either, so the modulo is
+   * taken once at the end rather than every 4102 bytes. */
+  for (; p + 8 <= ep; p += 8)
     {
-      q = sp + MODX;
-      if (q > ep)
-        q = ep;
-      for (p = sp; p < q; p++)
-        {
-          c0 += *p;
-          c1 += c0;
-        }
-      c0 %= 255;
-      c1 %= 255;
+      memcpy (&w, p, sizeof (w));
+      even = w & LSA_CKSUM_LANES;
+      odd = (w >> 8) & LSA_CKSUM_LANES;
+      c1 += 8 * c0
+            + ((even * LSA_CKSUM_WEIGHT_EVEN + odd * LSA_CKSUM_WEIGHT_ODD) >> 48);
+      c0 += ((even + odd) * LSA_CKSUM_ONES) >> 48;
     }
+  for (; p < ep; p++)
+    {
+      c0 += *p;
+      c1 += c0;
+    }
+  c0 %= 255;
+  c1 %= 255;
 
-  x = (((int)length - LSA_CHECKSUM_OFFSET) * c0 - c1) % 255;
+  x = (((int)length - LSA_CHECKSUM_OFFSET) * (int)c0 - (int)c1) % 255;
   if (x <= 0)
     x += 255;
-  y = 510 - c0 - x;
+  y = 510 - (int)c0 - x;
   if (y > 255)
     y -= 255;
 
@@ -214,8 +237,68 @@ ospf_lsa_checksum (struct lsa_header *lsa)
   return (lsa->checksum);
 }
 
+/* Overwrite LEN bytes at byte OFFSET of an LSA that carries a valid
+ * checksum and adjust the checksum for the change only, without
+ * walking the rest of the LSA.  Both Fletcher sums of a checksummed
+ * LSA are zero mod 255, so the bytes' deltas (D0 = sum of deltas,
+ * D1 = sum of position-weighted deltas) determine the change to the
+ * two checksum octets exactly as ospf_lsa_checksum() derives them. */
+u_int16_t
+ospf_lsa_checksum_update (struct lsa_header *lsa, size_t offset,
+                          const void *data, size_t len)
+{
+  const u_char *new = data;
+  u_char *old = (u_char *) lsa;
+  u_char *ck = (u_char *) &lsa->checksum;
+  int64_t d0 = 0, d1 = 0;
+  size_t length, i;
+  int x, y, dx;
+
+  length = ntohs (lsa->length);
+
+  /* Neither the checksum nor the length field can be patched this
+   * way, nor can bytes past the end; recompute from scratch then. */
+  if (offset + len > length
+      || (offset < 20 && offset + len > 16))
+    {
+      memcpy (old + offset, new, len);
+      return ospf_lsa_checksum (lsa);
+    }
+
+  for (i = 0; i < len; i++)
+    {
+      size_t pos = offset + i;
+
+      /* LS age is not covered by the checksum. */
+      if (pos >= 2)
+        {
+          int d = (int) new[i] - (int) old[pos];
+
+          d0 += d;
+          d1 += (int64_t) d * (int64_t)(length - pos);
+        }
+      old[pos] = new[i];
+    }
+
+  d0 %= 255;
+  d1 %= 255;
+  dx = (int)(((int64_t)(length - 2 - LSA_CHECKSUM_OFFSET) * d0 - d1) % 255);
+
+  x = (ck[0] + dx) % 255;
+  if (x <= 0)
+    x += 255;
+  y = (ck[1] - (int) d0 - dx) % 255;
+  if (y <= 0)
+    y += 255;
+
+  ck[0] = x;
+  ck[1] = y;
+
+  return (lsa->checksum);
+}
+
+
 
-
 /* Create OSPF LSA. */
 struct ospf_lsa *
 ospf_lsa_new ()
@@ -260,6 +343,14 @@ ospf_lsa_dup (struct ospf_lsa *lsa)
      queue (which it's not a member of.)
      XXX: Should we add the LSA to the refresh_list queue? */
   new->refresh_list = -1;
+  new->refresh_next = new->refresh_prev = NULL;
+  new->aging_lsdb = NULL;
+  new->aging_next = new->aging_prev = NULL;
+  new->maxage_next = new->maxage_prev = NULL;
+
+  /* The decoded links belong to the original. */
+  new->spf_edges = NULL;
+  new->spf_edge_count = 0;
 
   if (IS_DEBUG_OSPF (lsa, LSA))
     zlog_debug ("LSA: duplicated %p (new: %p)", lsa, new);
@@ -280,6 +371,9 @@ ospf_lsa_free (struct ospf_lsa *lsa)
   if (lsa->data != NULL)
     ospf_lsa_data_free (lsa->data);
 
+  if (lsa->spf_edges != NULL)
+    XFREE (MTYPE_OSPF_SPF_EDGE, lsa->spf_edges);
+
   assert (lsa->refresh_list < 0);
 
   memset (lsa, 0, sizeof (struct ospf_lsa)); 
@@ -2566,12 +2660,8 @@ ospf_summary_lsa_install (struct ospf *ospf, struct ospf_lsa *new,
 	 necessary to re-examine all the AS-external-LSAs.
       */
 
-#if 0
-      /* This doesn't exist yet... */
-      ospf_summary_incremental_update(new); */
-#else /* #if 0 */
-      ospf_spf_calculate_schedule (ospf);
-#endif /* #if 0 */
+      /* Intra-area routes are unaffected, skip Dijkstra. */
+      ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_SUMMARY);
  
       if (IS_DEBUG_OSPF (lsa, LSA_INSTALL))
 	zlog_debug ("ospf_summary_lsa_install(): SPF scheduled");
@@ -2596,15 +2686,9 @@ ospf_summary_asbr_lsa_install (struct ospf *ospf, struct ospf_lsa *new,
 	 destination is an AS boundary router, it may also be
 	 necessary to re-examine all the AS-external-LSAs.
       */
-#if 0
-      /* These don't exist yet... */
-      ospf_summary_incremental_update(new);
-      /* Isn't this done by the above call? 
-	 - RFC 2328 Section 16.5 implies it should be */
-      /* ospf_ase_calculate_schedule(); */
-#else  /* #if 0 */
-      ospf_spf_calculate_schedule (ospf);
-#endif /* #if 0 */
+      /* Intra-area routes are unaffected, skip Dijkstra; the
+         inter-area pass reschedules the ASE calculation. */
+      ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_SUMMARY);
     }
 
   /* register LSA to refresh-list. */
@@ -2629,7 +2713,10 @@ ospf_external_lsa_install (struct ospf *ospf, struct ospf_lsa *new,
       */
 
       if (!IS_LSA_SELF (new))
-        ospf_ase_incremental_update (ospf, new);
+        {
+          ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_EXTERNAL);
+          ospf_ase_incremental_update (ospf, new);
+        }
     }
 
   if (new->data->type == OSPF_AS_NSSA_LSA)
@@ -2848,6 +2935,9 @@ ospf_lsa_install (struct ospf *ospf, struct ospf_interface *oi,
       /* Fallthrough */
     case OSPF_OPAQUE_AREA_LSA:
     case OSPF_OPAQUE_AS_LSA:
+      /* Opaque-LSAs never change routing, just account for them. */
+      if (rt_recalc)
+	ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_OPAQUE);
       new = ospf_opaque_lsa_install (lsa, rt_recalc);
       break;
 #endif /* HAVE_OPAQUE_LSA */
@@ -2960,26 +3050,62 @@ ospf_maxage_flood (struct ospf_lsa *lsa)
 #endif /* ORIGINAL_CODING */
 
 static int
-ospf_maxage_lsa_remover (struct thread *thread)
+ospf_lsa_maxage_exist (struct ospf *ospf, struct ospf_lsa *lsa)
 {
-  struct ospf *ospf = THREAD_ARG (thread);
-  struct ospf_lsa *lsa;
-  struct zlistnode *node, *nnode;
-  int reschedule = 0;
+  return lsa->maxage_prev != NULL || ospf->maxage_lsa == lsa;
+}
 
-  ospf->t_maxage = NULL;
+static void
+ospf_lsa_maxage_link (struct ospf *ospf, struct ospf_lsa *lsa)
+{
+  lsa->maxage_next = NULL;
+  lsa->maxage_prev = ospf->maxage_lsa_tail;
+  if (lsa->maxage_prev)
+    lsa->maxage_prev->maxage_next = lsa;
+  else
+    ospf->maxage_lsa = lsa;
+  ospf->maxage_lsa_tail = lsa;
+  ospf->maxage_count++;
+}
 
-  if (IS_DEBUG_OSPF (lsa, LSA_FLOODING))
-    zlog_debug ("LSA[MaxAge]: remover Start");
+static void
+ospf_lsa_maxage_unlink (struct ospf *ospf, struct ospf_lsa *lsa)
+{
+  if (lsa->maxage_prev)
+    lsa->maxage_prev->maxage_next = lsa->maxage_next;
+  else
+    ospf->maxage_lsa = lsa->maxage_next;
+  if (lsa->maxage_next)
+    lsa->maxage_next->maxage_prev = lsa->maxage_prev;
+  else
+    ospf->maxage_lsa_tail = lsa->maxage_prev;
+  lsa->maxage_next = lsa->maxage_prev = NULL;
+  ospf->maxage_count--;
+}
 
-  reschedule = !ospf_check_nbr_status (ospf);
+/* Flood and remove up to limit MaxAge LSAs (0 for all of them), taking
+   them from the head of ospf->maxage_lsa.  LSAs still on retransmission
+   lists go to the tail, so every LSA is looked at once per run.
+   Returns 1 if the batch made progress and LSAs were left unvisited.  */
+static int
+ospf_maxage_lsa_remove (struct ospf *ospf, u_int32_t limit, int *reschedule)
+{
+  struct ospf_lsa *lsa;
+  u_int32_t total;
+  u_int32_t removed = 0;
+  u_int32_t n;
 
-  if (!reschedule)
-    for (ALL_LIST_ELEMENTS (ospf->maxage_lsa, node, nnode, lsa))
+  n = total = ospf->maxage_count;
+  if (limit && n > limit)
+    n = limit;
+
+  for (; n > 0 && (lsa = ospf->maxage_lsa) != NULL; n--)
       {
         if (lsa->retransmit_counter > 0)
           {
-            reschedule = 1;
+	    ospf_lsa_maxage_unlink (ospf, lsa);
+	    ospf_lsa_maxage_link (ospf, lsa);
+            *reschedule = 1;
             continue;
           }
 
@@ -3009,6 +3135,7 @@ ospf_maxage_lsa_remover (struct thread *thread)
           }
 
 	/* Remove from lsdb. */
+	ospf_lsa_lock (lsa);
 	if (lsa->lsdb)
 	  {
 	    ospf_discard_from_db (ospf, lsa->lsdb, lsa);
@@ -3017,27 +3144,61 @@ ospf_maxage_lsa_remover (struct thread *thread)
         else
           zlog_warn ("[WRN] %s: LSA[Type%d:%s] ospf instance %d: No associated LSDB!", __func__,
                      lsa->data->type, inet_ntoa (lsa->data->id), ospf->instance);
+
+	/* Not the instance in the LSDB, it must not stay at the head. */
+	ospf_lsa_maxage_delete (ospf, lsa);
+	ospf_lsa_unlock (&lsa);
+	removed++;
       }
 
+  return limit && total > limit && removed > 0;
+}
+
+static int
+ospf_maxage_lsa_remover (struct thread *thread)
+{
+  struct ospf *ospf = THREAD_ARG (thread);
+  int reschedule = 0;
+  int more = 0;
+
+  ospf->t_maxage = NULL;
+
+  if (IS_DEBUG_OSPF (lsa, LSA_FLOODING))
+    zlog_debug ("LSA[MaxAge]: remover Start");
+
+  reschedule = !ospf_check_nbr_status (ospf);
+
+  if (!reschedule)
+    more = ospf_maxage_lsa_remove (ospf, OSPF_MAXAGE_REMOVE_BATCH,
+				   &reschedule);
+
   /*    A MaxAge LSA must be removed immediately from the router's link
         state database as soon as both a) it is no longer contained on any
         neighbor Link state retransmission lists and b) none of the router's
         neighbors are in states Exchange or Loading. */
-  if (reschedule)
+  if (more)
+    ospf->t_maxage = thread_add_event (master, ospf_maxage_lsa_remover,
+				       ospf, 0);
+  else if (reschedule)
     OSPF_TIMER_ON (ospf->t_maxage, ospf_maxage_lsa_remover, 2);
 
   return 0;
 }
 
+/* Like ospf_maxage_lsa_remover(), without the batch limit. */
 static int
-ospf_lsa_maxage_exist (struct ospf *ospf, struct ospf_lsa *new)
+ospf_maxage_lsa_remover_all (struct thread *thread)
 {
-  struct zlistnode *node;
-  struct ospf_lsa *lsa;
-  
-  for (ALL_LIST_ELEMENTS_RO (ospf->maxage_lsa, node, lsa))
-    if (lsa == new)
-      return 1;
+  struct ospf *ospf = THREAD_ARG (thread);
+  int reschedule = 0;
+
+  if (ospf_check_nbr_status (ospf))
+    ospf_maxage_lsa_remove (ospf, 0, &reschedule);
+  else
+    reschedule = 1;
+
+  if (reschedule)
+    OSPF_TIMER_ON (ospf->t_maxage, ospf_maxage_lsa_remover, 2);
 
   return 0;
 }
@@ -3045,11 +3206,9 @@ ospf_lsa_maxage_exist (struct ospf *ospf, struct ospf_lsa *new)
 void
 ospf_lsa_maxage_delete (struct ospf *ospf, struct ospf_lsa *lsa)
 {
-  struct zlistnode *n;
-
-  if ((n = listnode_lookup (ospf->maxage_lsa, lsa)))
+  if (ospf_lsa_maxage_exist (ospf, lsa))
     {
-      list_delete_node (ospf->maxage_lsa, n);
+      ospf_lsa_maxage_unlink (ospf, lsa);
       ospf_lsa_unlock (&lsa); /* maxage_lsa */
     }
 }
@@ -3067,7 +3226,7 @@ ospf_lsa_maxage (struct ospf *ospf, struct ospf_lsa *lsa)
       return;
     }
 
-  listnode_add (ospf->maxage_lsa, ospf_lsa_lock (lsa));
+  ospf_lsa_maxage_link (ospf, ospf_lsa_lock (lsa));
 
   if (IS_DEBUG_OSPF (lsa, LSA_FLOODING))
     zlog_debug ("LSA[%s]: MaxAge LSA remover scheduled.", dump_lsa_key (lsa));
@@ -3075,12 +3234,14 @@ ospf_lsa_maxage (struct ospf *ospf, struct ospf_lsa *lsa)
   OSPF_TIMER_ON (ospf->t_maxage, ospf_maxage_lsa_remover, 2);
 }
 
-static int
-ospf_lsa_maxage_walker_remover (struct ospf *ospf, struct ospf_lsa *lsa)
+static void
+ospf_lsa_maxage_walker_remover (struct ospf_lsa *lsa, void *arg)
 {
+  struct ospf *ospf = arg;
+
   /* Stay away from any Local Translated Type-7 LSAs */
   if (CHECK_FLAG (lsa->flags, OSPF_LSA_LOCAL_XLT))
-    return 0;
+    return;
 
   if (IS_LSA_MAXAGE (lsa))
     /* Self-originated LSAs should NOT time-out instead,
@@ -3104,64 +3265,43 @@ ospf_lsa_maxage_walker_remover (struct ospf *ospf, struct ospf_lsa *lsa)
              * from the routing domain, it does not mean a change in network
              * topology, and thus, routing recalculation is not needed here.
              */
+	    ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_OPAQUE);
             break;
 #endif /* HAVE_OPAQUE_LSA */
           case OSPF_AS_EXTERNAL_LSA:
           case OSPF_AS_NSSA_LSA:
+	    ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_EXTERNAL);
 	    ospf_ase_incremental_update (ospf, lsa);
             break;
+          case OSPF_SUMMARY_LSA:
+          case OSPF_ASBR_SUMMARY_LSA:
+	    ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_SUMMARY);
+            break;
           default:
 	    ospf_spf_calculate_schedule (ospf);
             break;
           }
 	ospf_lsa_maxage (ospf, lsa);
       }
-
-  return 0;
 }
 
-/* Periodical check of MaxAge LSA. */
+/* Periodical check of MaxAge LSA.  Only the LSAs the aging wheels of
+   the area and AS databases have due are looked at. */
 int
 ospf_lsa_maxage_walker (struct thread *thread)
 {
   struct ospf *ospf = THREAD_ARG (thread);
-  struct route_node *rn;
-  struct ospf_lsa *lsa;
   struct ospf_area *area;
   struct zlistnode *node, *nnode;
 
   ospf->t_maxage_walker = NULL;
 
   for (ALL_LIST_ELEMENTS (ospf->areas, node, nnode, area))
-    {
-      LSDB_LOOP (ROUTER_LSDB (area), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-      LSDB_LOOP (NETWORK_LSDB (area), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-      LSDB_LOOP (SUMMARY_LSDB (area), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-      LSDB_LOOP (ASBR_SUMMARY_LSDB (area), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-#ifdef HAVE_OPAQUE_LSA
-      LSDB_LOOP (OPAQUE_AREA_LSDB (area), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-      LSDB_LOOP (OPAQUE_LINK_LSDB (area), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-#endif /* HAVE_OPAQUE_LSA */
-      LSDB_LOOP (NSSA_LSDB (area), rn, lsa)
-        ospf_lsa_maxage_walker_remover (ospf, lsa);
-    }
+    ospf_lsdb_aging_run (area->lsdb, ospf_lsa_maxage_walker_remover, ospf);
 
   /* for AS-external-LSAs. */
   if (ospf->lsdb)
-    {
-      LSDB_LOOP (EXTERNAL_LSDB (ospf), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-#ifdef HAVE_OPAQUE_LSA
-      LSDB_LOOP (OPAQUE_AS_LSDB (ospf), rn, lsa)
-	ospf_lsa_maxage_walker_remover (ospf, lsa);
-#endif /* HAVE_OPAQUE_LSA */
-    }
+    ospf_lsdb_aging_run (ospf->lsdb, ospf_lsa_maxage_walker_remover, ospf);
 
   OSPF_TIMER_ON (ospf->t_maxage_walker, ospf_lsa_maxage_walker,
 		 OSPF_LSA_MAXAGE_CHECK_INTERVAL);
@@ -3542,9 +3682,9 @@ ospf_flush_self_originated_lsas_now (struct ospf *ospf)
     {
       OSPF_TIMER_OFF (ospf->t_maxage);
 #ifndef HAVE_OMNIORB
-      thread_execute (master, ospf_maxage_lsa_remover, ospf, 0);
+      thread_execute (master, ospf_maxage_lsa_remover_all, ospf, 0);
 #else
-      thread_execute_no_lock (master, ospf_maxage_lsa_remover, ospf, 0);
+      thread_execute_no_lock (master, ospf_maxage_lsa_remover_all, ospf, 0);
 #endif /* HAVE_OMNIORB */
     }
 
@@ -3786,10 +3926,12 @@ ospf_refresher_register_lsa (struct ospf *ospf, struct ospf_lsa *lsa)
       if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
 	zlog_debug ("LSA[Refresh]: lsa %s with age %d added to index %d",
 		   inet_ntoa (lsa->data->id), LS_AGE (lsa), index);
-      if (!ospf->lsa_refresh_queue.qs[index])
-	ospf->lsa_refresh_queue.qs[index] = list_new ();
-      listnode_add (ospf->lsa_refresh_queue.qs[index],
-                    ospf_lsa_lock (lsa)); /* lsa_refresh_queue */
+      ospf_lsa_lock (lsa); /* lsa_refresh_queue */
+      lsa->refresh_prev = NULL;
+      lsa->refresh_next = ospf->lsa_refresh_queue.qs[index];
+      if (lsa->refresh_next)
+	lsa->refresh_next->refresh_prev = lsa;
+      ospf->lsa_refresh_queue.qs[index] = lsa;
       lsa->refresh_list = index;
       if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
         zlog_debug ("LSA[Refresh:%s]: ospf_refresher_register_lsa(): "
@@ -3798,33 +3940,114 @@ ospf_refresher_register_lsa (struct ospf *ospf, struct ospf_lsa *lsa)
     }
 }
 
+/* Take lsa off its refresher slot or the pending queue, keeping the
+   lsa_refresh_queue lock.  */
+static void
+ospf_refresher_unlink (struct ospf *ospf, struct ospf_lsa *lsa)
+{
+  if (lsa->refresh_prev)
+    lsa->refresh_prev->refresh_next = lsa->refresh_next;
+  else if (lsa->refresh_list == OSPF_LSA_REFRESH_PENDING)
+    ospf->lsa_refresh_queue.pending = lsa->refresh_next;
+  else
+    ospf->lsa_refresh_queue.qs[lsa->refresh_list] = lsa->refresh_next;
+
+  if (lsa->refresh_next)
+    lsa->refresh_next->refresh_prev = lsa->refresh_prev;
+  else if (lsa->refresh_list == OSPF_LSA_REFRESH_PENDING)
+    ospf->lsa_refresh_queue.pending_tail = lsa->refresh_prev;
+
+  if (lsa->refresh_list == OSPF_LSA_REFRESH_PENDING)
+    ospf->lsa_refresh_queue.pending_count--;
+
+  lsa->refresh_next = lsa->refresh_prev = NULL;
+  lsa->refresh_list = -1;
+}
+
 void
 ospf_refresher_unregister_lsa (struct ospf *ospf, struct ospf_lsa *lsa)
 {
   assert (CHECK_FLAG (lsa->flags, OSPF_LSA_SELF));
   if (lsa->refresh_list >= 0)
     {
-      struct zlist *refresh_list = ospf->lsa_refresh_queue.qs[lsa->refresh_list];
-      listnode_delete (refresh_list, lsa);
-      if (!listcount (refresh_list))
-	{
-	  list_free (refresh_list);
-	  ospf->lsa_refresh_queue.qs[lsa->refresh_list] = NULL;
-	}
+      ospf_refresher_unlink (ospf, lsa);
+      ospf_lsa_unlock (&lsa); /* lsa_refresh_queue */
+    }
+}
+
+/* Refresh a share of the pending LSAs: what is left spread evenly over
+   the remaining ticks of the refresh interval, capped by the rate
+   limit.  Whatever does not fit is carried into the next tick, but an
+   LSA past its refresh time plus jitter is refreshed whatever the cap,
+   lest a limit too low for the LSAs originated lets them reach MaxAge.
+   The queue is in refresh order, so those are found at its head.  */
+static void
+ospf_lsa_refresh_pace (struct ospf *ospf)
+{
+  struct ospf_lsa *lsa;
+  time_t elapsed;
+  u_int32_t ticks;
+  u_int32_t n;
+  u_int32_t overdue = 0;
+
+  elapsed = quagga_time (NULL) - ospf->lsa_refresher_started;
+  if (elapsed >= 0 && elapsed < ospf->lsa_refresh_interval)
+    ticks = (ospf->lsa_refresh_interval - elapsed) / OSPF_LSA_REFRESH_TICK;
+  else
+    ticks = 1;
+  if (ticks == 0)
+    ticks = 1;
+
+  n = (ospf->lsa_refresh_queue.pending_count + ticks - 1) / ticks;
+  if (ospf->lsa_refresh_rate_limit && n > ospf->lsa_refresh_rate_limit)
+    n = ospf->lsa_refresh_rate_limit;
+  if (ospf->lsa_refresh_burst_max < n)
+    ospf->lsa_refresh_burst_max = n;
+
+  if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
+    zlog_debug ("LSA[Refresh]: refreshing %u of %u pending LSAs",
+		n, ospf->lsa_refresh_queue.pending_count);
+
+  while ((lsa = ospf->lsa_refresh_queue.pending) != NULL)
+    {
+      if (n > 0)
+	n--;
+      else if (LS_AGE (lsa) >= OSPF_LS_REFRESH_TIME + OSPF_LS_REFRESH_JITTER)
+	overdue++;
+      else
+	break;
+
+      ospf_refresher_unlink (ospf, lsa);
+      ospf_lsa_refresh (ospf, lsa);
       ospf_lsa_unlock (&lsa); /* lsa_refresh_queue */
-      lsa->refresh_list = -1;
     }
+
+  if (overdue && IS_DEBUG_OSPF (lsa, LSA_REFRESH))
+    zlog_debug ("LSA[Refresh]: %u overdue LSAs refreshed over the rate limit",
+		overdue);
+
+  if (ospf->lsa_refresh_queue.pending && !ospf->t_lsa_refresh_pacer)
+    ospf->t_lsa_refresh_pacer =
+      thread_add_timer (master, ospf_lsa_refresh_pacer, ospf,
+			OSPF_LSA_REFRESH_TICK);
+}
+
+int
+ospf_lsa_refresh_pacer (struct thread *t)
+{
+  struct ospf *ospf = THREAD_ARG (t);
+
+  ospf->t_lsa_refresh_pacer = NULL;
+  ospf_lsa_refresh_pace (ospf);
+  return 0;
 }
 
 int
 ospf_lsa_refresh_walker (struct thread *t)
 {
-  struct zlist *refresh_list;
-  struct zlistnode *node, *nnode;
   struct ospf *ospf = THREAD_ARG (t);
   struct ospf_lsa *lsa;
   int i;
-  struct zlist *lsa_to_refresh = list_new ();
 
   if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
     zlog_debug ("LSA[Refresh]:ospf_lsa_refresh_walker(): start");
@@ -3851,25 +4074,24 @@ ospf_lsa_refresh_walker (struct thread *t)
 	zlog_debug ("LSA[Refresh]: ospf_lsa_refresh_walker(): "
 	           "refresh index %d", i);
 
-      refresh_list = ospf->lsa_refresh_queue.qs [i];
-      
-      ospf->lsa_refresh_queue.qs [i] = NULL;
-
-      if (refresh_list)
+      /* Move the slot to the tail of the pending queue, keeping the
+	 lsa_refresh_queue lock. */
+      while ((lsa = ospf->lsa_refresh_queue.qs [i]) != NULL)
 	{
-	  for (ALL_LIST_ELEMENTS (refresh_list, node, nnode, lsa))
-	    {
-	      if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
-		zlog_debug ("LSA[Refresh:%s]: ospf_lsa_refresh_walker(): "
-		           "refresh lsa %p (slot %d)", 
-		           inet_ntoa (lsa->data->id), lsa, i);
-	      
-	      list_delete_node (refresh_list, node);
-	      ospf_lsa_unlock (&lsa); /* lsa_refresh_queue */
-	      lsa->refresh_list = -1;
-	      listnode_add (lsa_to_refresh, lsa);
-	    }
-	  list_free (refresh_list);
+	  if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
+	    zlog_debug ("LSA[Refresh:%s]: ospf_lsa_refresh_walker(): "
+		       "refresh lsa %p (slot %d)", 
+		       inet_ntoa (lsa->data->id), lsa, i);
+
+	  ospf_refresher_unlink (ospf, lsa);
+	  lsa->refresh_list = OSPF_LSA_REFRESH_PENDING;
+	  lsa->refresh_prev = ospf->lsa_refresh_queue.pending_tail;
+	  if (lsa->refresh_prev)
+	    lsa->refresh_prev->refresh_next = lsa;
+	  else
+	    ospf->lsa_refresh_queue.pending = lsa;
+	  ospf->lsa_refresh_queue.pending_tail = lsa;
+	  ospf->lsa_refresh_queue.pending_count++;
 	}
     }
 
@@ -3877,10 +4099,8 @@ ospf_lsa_refresh_walker (struct thread *t)
 					   ospf, ospf->lsa_refresh_interval);
   ospf->lsa_refresher_started = quagga_time (NULL);
 
-  for (ALL_LIST_ELEMENTS (lsa_to_refresh, node, nnode, lsa))
-    ospf_lsa_refresh (ospf, lsa);
-  
-  list_delete (lsa_to_refresh);
+  OSPF_TIMER_OFF (ospf->t_lsa_refresh_pacer);
+  ospf_lsa_refresh_pace (ospf);
   
   if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
     zlog_debug ("LSA[Refresh]: ospf_lsa_refresh_walker(): end");
@@ -80,6 +80,7 @@ struct ospf_lsa
 #define OSPF_LSA_DISCARD          0x10
 #define OSPF_LSA_LOCAL_XLT        0x20
 #define OSPF_LSA_PREMATURE_AGE    0x40
+#define OSPF_LSA_REQUESTED        0x80	/* ls-request copy, in flight */
 
 #ifdef G2MPLS
 
@@ -108,6 +109,10 @@ struct ospf_lsa
   #define LSA_SPF_NOT_EXPLORED	-1
   #define LSA_SPF_IN_SPFTREE	-2
   /* If stat >= 0, stat is LSA position in candidates heap. */
+
+  /* Links decoded for the SPF calculation, built on first use. */
+  struct ospf_spf_edge *spf_edges;
+  int spf_edge_count;
   
   /* References to this LSA in neighbor retransmission lists*/
   int retransmit_counter;
@@ -118,11 +123,23 @@ struct ospf_lsa
   /* Parent LSDB. */
   struct ospf_lsdb *lsdb;
 
+  /* Slot in the aging wheel of an area or AS LSDB. */
+  struct ospf_lsdb *aging_lsdb;
+  struct ospf_lsa *aging_next;
+  struct ospf_lsa *aging_prev;
+  int aging_slot;
+
+  /* Position on ospf->maxage_lsa. */
+  struct ospf_lsa *maxage_next;
+  struct ospf_lsa *maxage_prev;
+
   /* Related Route. */
   void *route;
 
   /* Refreshement List or Queue */
   int refresh_list;
+  struct ospf_lsa *refresh_next;
+  struct ospf_lsa *refresh_prev;
 
 #ifdef HAVE_OPAQUE_LSA
   /* For Type-9 Opaque-LSAs, reference to ospf-interface is required. */
@@ -242,6 +259,8 @@ extern int tv_cmp (struct timeval, struct timeval);
 
 extern int get_age (struct ospf_lsa *);
 extern u_int16_t ospf_lsa_checksum (struct lsa_header *);
+extern u_int16_t ospf_lsa_checksum_update (struct lsa_header *, size_t,
+                                           const void *, size_t);
 extern int ospf_lsa_refresh_delay (struct ospf_lsa *);
 
 extern const char *dump_lsa_key (struct ospf_lsa *);
@@ -323,6 +342,7 @@ extern void ospf_schedule_lsa_flush_area (struct ospf_area *, struct ospf_lsa *)
 extern void ospf_refresher_register_lsa (struct ospf *, struct ospf_lsa *);
 extern void ospf_refresher_unregister_lsa (struct ospf *, struct ospf_lsa *);
 extern int ospf_lsa_refresh_walker (struct thread *);
+extern int ospf_lsa_refresh_pacer (struct thread *);
 
 extern void ospf_lsa_maxage_delete (struct ospf *, struct ospf_lsa *);
 
@@ -25,6 +25,9 @@
 #include "prefix.h"
 #include "table.h"
 #include "memory.h"
+#include "thread.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_asbr.h"
@@ -39,16 +42,46 @@ ospf_lsdb_new ()
   new = XCALLOC (MTYPE_OSPF_LSDB, sizeof (struct ospf_lsdb));
   ospf_lsdb_init (new);
 
+  /* Area and AS databases track when their LSAs reach MaxAge. */
+  new->aging = XCALLOC (MTYPE_OSPF_LSDB_AGING,
+                        sizeof (struct ospf_lsdb_aging));
+  new->aging->tick = recent_relative_time ().tv_sec
+                     / OSPF_LSA_MAXAGE_CHECK_INTERVAL;
+
   return new;
 }
 
+/* The index holds route nodes, looked up by a prefix_ls key; both
+   start with the prefix, so either can be passed in. */
+static unsigned int
+ospf_lsdb_index_key (void *data)
+{
+  struct prefix *p = data;
+
+  return jhash_2words (p->u.lp.id.s_addr, p->u.lp.adv_router.s_addr, 0);
+}
+
+static int
+ospf_lsdb_index_cmp (void *a, void *b)
+{
+  struct prefix *p1 = a;
+  struct prefix *p2 = b;
+
+  return p1->u.lp.id.s_addr == p2->u.lp.id.s_addr
+    && p1->u.lp.adv_router.s_addr == p2->u.lp.adv_router.s_addr;
+}
+
 void
 ospf_lsdb_init (struct ospf_lsdb *lsdb)
 {
   int i;
   
   for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
-    lsdb->type[i].db = route_table_init ();
+    {
+      lsdb->type[i].db = route_table_init ();
+      lsdb->type[i].index = ohash_create (ospf_lsdb_index_key,
+                                          ospf_lsdb_index_cmp);
+    }
 }
 
 void
@@ -68,7 +101,84 @@ ospf_lsdb_cleanup (struct ospf_lsdb *lsdb)
   ospf_lsdb_delete_all (lsdb);
   
   for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
-    route_table_finish (lsdb->type[i].db);
+    {
+      route_table_finish (lsdb->type[i].db);
+      ohash_free (lsdb->type[i].index);
+    }
+
+  if (lsdb->aging)
+    XFREE (MTYPE_OSPF_LSDB_AGING, lsdb->aging);
+}
+
+/* File lsa under the check interval in which it reaches MaxAge,
+   always later than the interval processed last. */
+static void
+ospf_lsdb_aging_add (struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
+{
+  struct ospf_lsdb_aging *aging = lsdb->aging;
+  time_t tick;
+
+  tick = (recent_relative_time ().tv_sec + OSPF_LSA_MAXAGE - LS_AGE (lsa))
+         / OSPF_LSA_MAXAGE_CHECK_INTERVAL + 1;
+  if (tick <= aging->tick)
+    tick = aging->tick + 1;
+
+  lsa->aging_lsdb = lsdb;
+  lsa->aging_slot = tick % OSPF_LSDB_AGING_SLOTS;
+  lsa->aging_prev = NULL;
+  lsa->aging_next = aging->slot[lsa->aging_slot];
+  if (lsa->aging_next)
+    lsa->aging_next->aging_prev = lsa;
+  aging->slot[lsa->aging_slot] = lsa;
+}
+
+static void
+ospf_lsdb_aging_delete (struct ospf_lsa *lsa)
+{
+  struct ospf_lsdb_aging *aging = lsa->aging_lsdb->aging;
+
+  if (lsa->aging_prev)
+    lsa->aging_prev->aging_next = lsa->aging_next;
+  else
+    aging->slot[lsa->aging_slot] = lsa->aging_next;
+  if (lsa->aging_next)
+    lsa->aging_next->aging_prev = lsa->aging_prev;
+
+  lsa->aging_lsdb = NULL;
+  lsa->aging_next = lsa->aging_prev = NULL;
+}
+
+/* Call func for every LSA that reached MaxAge since the last run.  The
+   LSAs are taken off the wheel first; LSAs that are still younger, for
+   instance after a clock step, are filed again.  */
+void
+ospf_lsdb_aging_run (struct ospf_lsdb *lsdb,
+                     void (*func) (struct ospf_lsa *, void *), void *arg)
+{
+  struct ospf_lsdb_aging *aging = lsdb->aging;
+  struct ospf_lsa *lsa;
+  time_t now;
+  int i;
+  int slot;
+
+  if (aging == NULL)
+    return;
+
+  now = recent_relative_time ().tv_sec / OSPF_LSA_MAXAGE_CHECK_INTERVAL;
+  for (i = 0; aging->tick < now && i < OSPF_LSDB_AGING_SLOTS; i++)
+    {
+      aging->tick++;
+      slot = aging->tick % OSPF_LSDB_AGING_SLOTS;
+      while ((lsa = aging->slot[slot]) != NULL)
+	{
+	  ospf_lsdb_aging_delete (lsa);
+	  if (IS_LSA_MAXAGE (lsa))
+	    (*func) (lsa, arg);
+	  else
+	    ospf_lsdb_aging_add (lsdb, lsa);
+	}
+    }
+  aging->tick = now;
 }
 
 static void
@@ -81,6 +191,14 @@ lsdb_prefix_set (struct prefix_ls *lp, struct ospf_lsa *lsa)
   lp->adv_router = lsa->data->adv_router;
 }
 
+/* Route node holding the LSA with the key in lp, if any. */
+static struct route_node *
+ospf_lsdb_index_lookup (struct ospf_lsdb *lsdb, u_char type,
+                        struct prefix_ls *lp)
+{
+  return ohash_lookup (lsdb->type[type].index, lp);
+}
+
 static void
 ospf_lsdb_delete_entry (struct ospf_lsdb *lsdb, struct route_node *rn)
 {
@@ -96,6 +214,9 @@ ospf_lsdb_delete_entry (struct ospf_lsdb *lsdb, struct route_node *rn)
   lsdb->type[lsa->data->type].count--;
   lsdb->type[lsa->data->type].checksum -= ntohs(lsa->data->checksum);
   lsdb->total--;
+  if (lsa->aging_lsdb == lsdb)
+    ospf_lsdb_aging_delete (lsa);
+  ohash_release (lsdb->type[lsa->data->type].index, rn);
   rn->info = NULL;
   route_unlock_node (rn);
 #ifdef MONITOR_LSDB_CHANGE
@@ -116,15 +237,21 @@ ospf_lsdb_add (struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 
   table = lsdb->type[lsa->data->type].db;
   lsdb_prefix_set (&lp, lsa);
-  rn = route_node_get (table, (struct prefix *)&lp);
-  
+  rn = ospf_lsdb_index_lookup (lsdb, lsa->data->type, &lp);
+
   /* nothing to do? */
-  if (rn->info && rn->info == lsa)
+  if (rn && rn->info == lsa)
     return;
-  
-  /* purge old entry? */
-  if (rn->info)
-    ospf_lsdb_delete_entry (lsdb, rn);
+
+  if (rn)
+    {
+      /* purge old entry, keeping the node */
+      route_lock_node (rn);
+      ospf_lsdb_delete_entry (lsdb, rn);
+    }
+  else
+    rn = route_node_get (table, (struct prefix *)&lp);
+  ohash_get (lsdb->type[lsa->data->type].index, rn, hash_alloc_intern);
 
   if (IS_LSA_SELF (lsa))
     lsdb->type[lsa->data->type].count_self++;
@@ -136,13 +263,14 @@ ospf_lsdb_add (struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
     (* lsdb->new_lsa_hook)(lsa);
 #endif /* MONITOR_LSDB_CHANGE */
   lsdb->type[lsa->data->type].checksum += ntohs(lsa->data->checksum);
+  if (lsdb->aging && lsa->aging_lsdb == NULL)
+    ospf_lsdb_aging_add (lsdb, lsa);
   rn->info = ospf_lsa_lock (lsa); /* lsdb */
 }
 
 void
 ospf_lsdb_delete (struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 {
-  struct route_table *table;
   struct prefix_ls lp;
   struct route_node *rn;
 
@@ -162,14 +290,10 @@ ospf_lsdb_delete (struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
       return;
     }
   
-  table = lsdb->type[lsa->data->type].db;
   lsdb_prefix_set (&lp, lsa);
-  rn = route_node_lookup (table, (struct prefix *) &lp);
+  rn = ospf_lsdb_index_lookup (lsdb, lsa->data->type, &lp);
   if (rn && (rn->info == lsa))
-    {
-      ospf_lsdb_delete_entry (lsdb, rn);
-      route_unlock_node (rn); /* route_node_lookup */
-    }
+    ospf_lsdb_delete_entry (lsdb, rn);
 }
 
 void
@@ -208,33 +332,20 @@ ospf_lsdb_clean_stat (struct ospf_lsdb *lsdb)
 struct ospf_lsa *
 ospf_lsdb_lookup (struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 {
-  struct route_table *table;
   struct prefix_ls lp;
   struct route_node *rn;
-  struct ospf_lsa *find;
 
-  table = lsdb->type[lsa->data->type].db;
   lsdb_prefix_set (&lp, lsa);
-  rn = route_node_lookup (table, (struct prefix *) &lp);
-  if (rn)
-    {
-      find = rn->info;
-      route_unlock_node (rn);
-      return find;
-    }
-  return NULL;
+  rn = ospf_lsdb_index_lookup (lsdb, lsa->data->type, &lp);
+  return rn ? rn->info : NULL;
 }
 
 struct ospf_lsa *
 ospf_lsdb_lookup_by_id (struct ospf_lsdb *lsdb, u_char type,
 		       struct in_addr id, struct in_addr adv_router)
 {
-  struct route_table *table;
   struct prefix_ls lp;
   struct route_node *rn;
-  struct ospf_lsa *find;
-
-  table = lsdb->type[type].db;
 
   memset (&lp, 0, sizeof (struct prefix_ls));
   lp.family = 0;
@@ -242,14 +353,8 @@ ospf_lsdb_lookup_by_id (struct ospf_lsdb *lsdb, u_char type,
   lp.id = id;
   lp.adv_router = adv_router;
 
-  rn = route_node_lookup (table, (struct prefix *) &lp);
-  if (rn)
-    {
-      find = rn->info;
-      route_unlock_node (rn);
-      return find;
-    }
-  return NULL;
+  rn = ospf_lsdb_index_lookup (lsdb, type, &lp);
+  return rn ? rn->info : NULL;
 }
 
 struct ospf_lsa *
@@ -272,6 +377,8 @@ ospf_lsdb_lookup_by_id_next (struct ospf_lsdb *lsdb, u_char type,
 
   if (first)
       rn = route_top (table);
+  else if ((rn = ospf_lsdb_index_lookup (lsdb, type, &lp)) != NULL)
+    rn = route_next (route_lock_node (rn));
   else
     {
       rn = route_node_get (table, (struct prefix *) &lp);
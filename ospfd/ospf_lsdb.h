@@ -23,7 +23,23 @@
 #ifndef _ZEBRA_OSPF_LSDB_H
 #define _ZEBRA_OSPF_LSDB_H
 
-/* OSPF LSDB structure. */
+/* MaxAge wheel of an area or AS LSDB: LSAs are filed by the check
+   interval in which they reach MaxAge, so the walker only looks at the
+   LSAs that are due. */
+#define OSPF_LSDB_AGING_SLOTS \
+  (OSPF_LSA_MAXAGE / OSPF_LSA_MAXAGE_CHECK_INTERVAL + 2)
+
+struct ospf_lsdb_aging
+{
+  time_t tick;				/* last interval processed */
+  struct ospf_lsa *slot[OSPF_LSDB_AGING_SLOTS];
+};
+
+/* OSPF LSDB structure.  Each LSA type keeps its LSAs in a route table,
+   ordered by (id, adv_router) for LSDB_LOOP, DD and SNMP walks, and in
+   an open-addressing hash of the same route nodes for exact lookups.
+   Opaque-LSAs of one opaque type share the top 8 bits of their id, so
+   they are adjacent in the route table order. */
 struct ospf_lsdb
 {
   struct
@@ -32,8 +48,12 @@ struct ospf_lsdb
     unsigned long count_self;
     unsigned int checksum;
     struct route_table *db;
+    struct ohash *index;		/* route nodes with an LSA */
   } type[OSPF_MAX_LSA];
   unsigned long total;
+
+  /* NULL for neighbor lists. */
+  struct ospf_lsdb_aging *aging;
 #define MONITOR_LSDB_CHANGE 1 /* XXX */
 #ifdef MONITOR_LSDB_CHANGE
   /* Hooks for callback functions to catch every add/del event. */
@@ -82,5 +102,8 @@ extern unsigned long ospf_lsdb_count (struct ospf_lsdb *, int);
 extern unsigned long ospf_lsdb_count_self (struct ospf_lsdb *, int);
 extern unsigned int ospf_lsdb_checksum (struct ospf_lsdb *, int);
 extern unsigned long ospf_lsdb_isempty (struct ospf_lsdb *);
+extern void ospf_lsdb_aging_run (struct ospf_lsdb *,
+                                 void (*) (struct ospf_lsa *, void *),
+                                 void *);
 
 #endif /* _ZEBRA_OSPF_LSDB_H */
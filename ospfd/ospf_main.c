@@ -27,6 +27,7 @@
 #include "thread.h"
 #include "prefix.h"
 #include "linklist.h"
+#include "table.h"
 #include "if.h"
 #include "vector.h"
 #include "vty.h"
@@ -300,6 +301,11 @@ main (int argc, char **argv)
   vty_init (master);
   memory_init ();
 
+  /* Objects churned by flooding and SPF come from slabs. */
+  memory_slab_enable (MTYPE_OSPF_LSA, sizeof (struct ospf_lsa));
+  memory_slab_enable (MTYPE_LINK_NODE, sizeof (struct zlistnode));
+  memory_slab_enable (MTYPE_ROUTE_NODE, sizeof (struct route_node));
+
   access_list_init ();
   prefix_list_init ();
 
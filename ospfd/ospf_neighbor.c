@@ -96,9 +96,12 @@ ospf_nbr_new (struct ospf_interface *oi)
   ospf_lsdb_init (&nbr->db_sum);
   ospf_lsdb_init (&nbr->ls_rxmt);
   ospf_lsdb_init (&nbr->ls_req);
+  nbr->ls_req_inflight = list_new ();
 
   nbr->crypt_seqnum = 0;
 
+  nbr->slot = vector_set (oi->ospf->nbr_slots, nbr);
+
   return nbr;
 }
 
@@ -122,6 +125,7 @@ ospf_nbr_free (struct ospf_neighbor *nbr)
   ospf_lsdb_cleanup (&nbr->db_sum);
   ospf_lsdb_cleanup (&nbr->ls_req);
   ospf_lsdb_cleanup (&nbr->ls_rxmt);
+  list_delete (nbr->ls_req_inflight);
   
   /* Clear last send packet. */
   if (nbr->last_send)
@@ -142,6 +146,8 @@ ospf_nbr_free (struct ospf_neighbor *nbr)
   /* Cancel all events. *//* Thread lookup cost would be negligible. */
   thread_cancel_event (master, nbr);
 
+  vector_unset (nbr->oi->ospf->nbr_slots, nbr->slot);
+
   XFREE (MTYPE_OSPF_NEIGHBOR, nbr);
 }
 
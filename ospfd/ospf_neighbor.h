@@ -31,6 +31,9 @@ struct ospf_neighbor
   /* This neighbor's parent ospf interface. */
   struct ospf_interface *oi;
 
+  /* Compact id of this neighbor in ospf->nbr_slots. */
+  unsigned int slot;
+
   /* OSPF neighbor Information */
   u_char state;				/* NSM status. */
   u_char dd_flags;			/* DD bit flags. */
@@ -63,7 +66,7 @@ struct ospf_neighbor
   struct ospf_lsdb ls_rxmt;
   struct ospf_lsdb db_sum;
   struct ospf_lsdb ls_req;
-  struct ospf_lsa *ls_req_last;
+  struct zlist *ls_req_inflight;	/* Last LSA of each pending LS Request. */
 
   u_int32_t crypt_seqnum;           /* Cryptographic Sequence Number. */
 
@@ -88,6 +91,8 @@ struct ospf_neighbor
   struct timeval ts_last_regress;   /* last regressive NSM change     */
   const char *last_regress_str;     /* Event which last regressed NSM */
   u_int32_t state_change;           /* NSM state change counter       */
+  struct timeval ts_exstart;        /* last entry into ExStart        */
+  struct timeval tv_to_full;        /* last ExStart to Full duration  */
 };
 
 /* Macros. */
@@ -615,6 +615,13 @@ nsm_notice_state_change (struct ospf_neighbor *nbr, int next_state, int event)
                 LOOKUP (ospf_nsm_state_msg, next_state),
                 ospf_nsm_event_str [event]);
 
+  /* Database exchange duration, ExStart to Full. */
+  if (next_state == NSM_ExStart && nbr->state < NSM_ExStart)
+    nbr->ts_exstart = recent_relative_time ();
+  else if (next_state == NSM_Full && nbr->state != NSM_Full
+           && (nbr->ts_exstart.tv_sec || nbr->ts_exstart.tv_usec))
+    nbr->tv_to_full = tv_sub (recent_relative_time (), nbr->ts_exstart);
+
   /* Advance in NSM */
   if (next_state > nbr->state)
     nbr->ts_last_progress = recent_relative_time ();
@@ -865,7 +872,8 @@ ospf_check_nbr_loading (struct ospf_neighbor *nbr)
     {
       if (ospf_ls_request_isempty (nbr))
 	OSPF_NSM_EVENT_SCHEDULE (nbr, NSM_LoadingDone);
-      else if (nbr->ls_req_last == NULL)
+      else if (listcount (nbr->ls_req_inflight)
+               < nbr->oi->ospf->ls_req_window)
 	ospf_ls_req_event (nbr);
     }
 }
@@ -34,6 +34,8 @@
 #include "sockopt.h"
 #include "checksum.h"
 #include "md5.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_network.h"
@@ -397,6 +399,9 @@ ospf_ls_req_timer (struct thread *thread)
   nbr = THREAD_ARG (thread);
   nbr->t_ls_req = NULL;
 
+  /* Nothing answered within RxmtInterval, request everything again. */
+  ospf_ls_request_inflight_clear (nbr);
+
   /* Send Link State Request. */
   if (ospf_ls_request_count (nbr))
     ospf_ls_req_send (nbr);
@@ -407,6 +412,23 @@ ospf_ls_req_timer (struct thread *thread)
   return 0;
 }
 
+/* An outstanding LS Request was answered, fill the window again. */
+static int
+ospf_ls_req_more (struct thread *thread)
+{
+  struct ospf_neighbor *nbr;
+
+  nbr = THREAD_ARG (thread);
+  nbr->t_ls_req = NULL;
+
+  if (ospf_ls_request_count (nbr))
+    ospf_ls_req_send (nbr);
+
+  OSPF_NSM_TIMER_ON (nbr->t_ls_req, ospf_ls_req_timer, nbr->v_ls_req);
+
+  return 0;
+}
+
 void
 ospf_ls_req_event (struct ospf_neighbor *nbr)
 {
@@ -415,7 +437,7 @@ ospf_ls_req_event (struct ospf_neighbor *nbr)
       thread_cancel (nbr->t_ls_req);
       nbr->t_ls_req = NULL;
     }
-  nbr->t_ls_req = thread_add_event (master, ospf_ls_req_timer, nbr, 0);
+  nbr->t_ls_req = thread_add_event (master, ospf_ls_req_more, nbr, 0);
 }
 
 /* Cyclic timer function.  Fist registered in ospf_nbr_new () in
@@ -2927,7 +2949,7 @@ empty:
 static int
 ospf_make_ls_req_func (struct stream *s, u_int16_t *length,
 		       unsigned long delta, struct ospf_neighbor *nbr,
-		       struct ospf_lsa *lsa)
+		       struct ospf_lsa *lsa, struct ospf_lsa **last)
 {
   struct ospf_interface *oi;
 
@@ -2941,15 +2963,20 @@ ospf_make_ls_req_func (struct stream *s, u_int16_t *length,
   stream_put_ipv4 (s, lsa->data->id.s_addr);
   stream_put_ipv4 (s, lsa->data->adv_router.s_addr);
   
-  ospf_lsa_unlock (&nbr->ls_req_last);
-  nbr->ls_req_last = ospf_lsa_lock (lsa);
+  ospf_ls_request_mark (nbr, lsa);
+  *last = lsa;
   
   *length += 12;
   return 1;
 }
 
+/* Put into the LS Request the LSAs which are neither in flight to this
+ * neighbor nor already requested from another one. The last LSA put is
+ * returned in last.
+ */
 static int
-ospf_make_ls_req (struct ospf_neighbor *nbr, struct stream *s)
+ospf_make_ls_req (struct ospf_neighbor *nbr, struct stream *s,
+		  struct ospf_lsa **last)
 {
   struct ospf_lsa *lsa;
   u_int16_t length = OSPF_LS_REQ_MIN_SIZE;
@@ -2960,17 +2987,24 @@ ospf_make_ls_req (struct ospf_neighbor *nbr, struct stream *s)
   struct ospf_lsdb *lsdb;
 
   lsdb = &nbr->ls_req;
+  *last = NULL;
 
   for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
     {
       table = lsdb->type[i].db;
       for (rn = route_top (table); rn; rn = route_next (rn))
 	if ((lsa = (rn->info)) != NULL)
-	  if (ospf_make_ls_req_func (s, &length, delta, nbr, lsa) == 0)
-	    {
-	      route_unlock_node (rn);
-	      break;
-	    }
+	  {
+	    if (CHECK_FLAG (lsa->flags, OSPF_LSA_REQUESTED)
+		|| ospf_ls_request_pending_elsewhere (nbr, lsa))
+	      continue;
+
+	    if (ospf_make_ls_req_func (s, &length, delta, nbr, lsa, last) == 0)
+	      {
+		route_unlock_node (rn);
+		return length;
+	      }
+	  }
     }
   return length;
 }
@@ -2985,8 +3019,30 @@ ls_age_increment (struct ospf_lsa *lsa, int delay)
   return (age > OSPF_LSA_MAXAGE ? OSPF_LSA_MAXAGE : age);
 }
 
+/* LS Update body built once per flooding round and shared by every
+   interface of the same (area, auth-type, MTU, transmit-delay) class. */
+struct ospf_ls_upd_batch
+{
+  /* Class of interfaces the body is valid for. */
+  struct in_addr area_id;
+  int auth_type;
+  size_t size;
+  u_int32_t transmit_delay;
+
+  /* LSAs packed into the body, in order. */
+  struct ospf_lsa **lsas;
+  unsigned int count;
+
+  /* Set when packing stopped because the next LSA did not fit. */
+  u_char full;
+
+  /* Finished packet, duplicated for every reuse. */
+  struct ospf_packet *op;
+};
+
 static int
-ospf_make_ls_upd (struct ospf_interface *oi, struct zlist *update, struct stream *s)
+ospf_make_ls_upd (struct ospf_interface *oi, struct zlist *update,
+		  struct stream *s, struct ospf_ls_upd_batch *batch)
 {
   struct ospf_lsa *lsa;
   struct zlistnode *node;
@@ -3019,7 +3075,11 @@ ospf_make_ls_upd (struct ospf_interface *oi, struct zlist *update, struct stream
 
       /* Will it fit? */
       if (length + delta + ntohs (lsa->data->length) > size_noauth)
-        break;
+        {
+          if (batch)
+            batch->full = 1;
+          break;
+        }
 
       /* Keep pointer to LS age. */
       lsah = (struct lsa_header *) (STREAM_DATA (s) + stream_get_endp (s));
@@ -3036,6 +3096,9 @@ ospf_make_ls_upd (struct ospf_interface *oi, struct zlist *update, struct stream
       length += ntohs (lsa->data->length);
       count++;
 
+      if (batch)
+        batch->lsas[batch->count++] = ospf_lsa_lock (lsa); /* batch */
+
       list_delete_node (update, node);
       ospf_lsa_unlock (&lsa); /* oi->ls_upd_queue */
     }
@@ -3328,11 +3391,12 @@ ospf_db_desc_resend (struct ospf_neighbor *nbr)
 }
 
 /* Send Link State Request. */
-void
-ospf_ls_req_send (struct ospf_neighbor *nbr)
+static int
+ospf_ls_req_send_packet (struct ospf_neighbor *nbr)
 {
   struct ospf_interface *oi;
   struct ospf_packet *op;
+  struct ospf_lsa *last;
   u_int16_t length = OSPF_HEADER_SIZE;
 
   oi = nbr->oi;
@@ -3346,13 +3410,16 @@ ospf_ls_req_send (struct ospf_neighbor *nbr)
   ospf_make_header (OSPF_MSG_LS_REQ, oi, op->s);
 
   /* Prepare OSPF Link State Request body. */
-  length += ospf_make_ls_req (nbr, op->s);
+  length += ospf_make_ls_req (nbr, op->s, &last);
   if (length == OSPF_HEADER_SIZE)
     {
       ospf_packet_free (op);
-      return;
+      return 0;
     }
 
+  /* The request is answered once its last LSA is received. */
+  listnode_add (nbr->ls_req_inflight, ospf_lsa_lock (last));
+
   /* Fill OSPF header. */
   ospf_fill_header (oi, op->s, length);
 
@@ -3368,8 +3435,22 @@ ospf_ls_req_send (struct ospf_neighbor *nbr)
   /* Hook thread to write packet. */
   OSPF_ISM_WRITE_ON (oi->ospf);
 
-  /* Add Link State Request Retransmission Timer. */
-  OSPF_NSM_TIMER_ON (nbr->t_ls_req, ospf_ls_req_timer, nbr->v_ls_req);
+  return 1;
+}
+
+/* Send LS Requests until the neighbor's in-flight window is full. */
+void
+ospf_ls_req_send (struct ospf_neighbor *nbr)
+{
+  while (listcount (nbr->ls_req_inflight) < nbr->oi->ospf->ls_req_window)
+    if (ospf_ls_req_send_packet (nbr) == 0)
+      break;
+
+  /* Add Link State Request Retransmission Timer.  It is needed even if
+     nothing was sent: what is left may be in flight to another
+     neighbor that never answers it. */
+  if (ospf_ls_request_count (nbr))
+    OSPF_NSM_TIMER_ON (nbr->t_ls_req, ospf_ls_req_timer, nbr->v_ls_req);
 }
 
 /* Send Link State Update with an LSA. */
@@ -3387,6 +3468,17 @@ ospf_ls_upd_send_lsa (struct ospf_neighbor *nbr, struct ospf_lsa *lsa,
   list_delete (update);
 }
 
+/* Size of a regular (non-fragmented) LS Update packet on interface. */
+static size_t
+ospf_ls_upd_packet_size (struct ospf_interface *oi)
+{
+#ifdef GMPLS
+  return oi->ifp->mtu - SCNGW_HDR_SIZE;
+#else
+  return oi->ifp->mtu;
+#endif /* GMPLS */
+}
+
 /* Determine size for packet. Must be at least big enough to accomodate next
  * LSA on list, which may be bigger than MTU size.
  *
@@ -3437,13 +3529,7 @@ ospf_ls_upd_packet_new (struct zlist *update, struct ospf_interface *oi)
 #endif /* GMPLS */
     }
   else
-    {
-#ifdef GMPLS
-    size = oi->ifp->mtu - SCNGW_HDR_SIZE;
-#else
-    size = oi->ifp->mtu;
-#endif /* GMPLS */
-    }
+    size = ospf_ls_upd_packet_size (oi);
 
   /* XXX Should this be - sizeof(struct ip)?? -gdt */
   if (size > OSPF_MAX_PACKET_SIZE)
@@ -3460,25 +3546,225 @@ ospf_ls_upd_packet_new (struct zlist *update, struct ospf_interface *oi)
   return ospf_packet_new (size);
 }
 
+/* LS Update batch hash key: class fields plus the first packed LSA. */
+static unsigned int
+ospf_ls_upd_batch_hash_key (void *data)
+{
+  struct ospf_ls_upd_batch *batch = data;
+  unsigned long first = (unsigned long) batch->lsas[0];
+
+  return jhash_3words (batch->area_id.s_addr,
+		       (u_int32_t) batch->size ^ (batch->auth_type << 16),
+		       (u_int32_t) first ^ batch->transmit_delay, 0);
+}
+
+static int
+ospf_ls_upd_batch_hash_cmp (void *a, void *b)
+{
+  struct ospf_ls_upd_batch *b1 = a;
+  struct ospf_ls_upd_batch *b2 = b;
+
+  return (b1->area_id.s_addr == b2->area_id.s_addr
+	  && b1->auth_type == b2->auth_type
+	  && b1->size == b2->size
+	  && b1->transmit_delay == b2->transmit_delay
+	  && b1->lsas[0] == b2->lsas[0]);
+}
+
+static struct ospf_ls_upd_batch *
+ospf_ls_upd_batch_new (struct ospf_interface *oi, size_t size)
+{
+  struct ospf_ls_upd_batch *new;
+
+  new = XCALLOC (MTYPE_OSPF_LS_UPD_BATCH, sizeof (struct ospf_ls_upd_batch));
+
+  new->area_id = oi->area->area_id;
+  new->auth_type = ospf_auth_type (oi);
+  new->size = size;
+  new->transmit_delay = OSPF_IF_PARAM (oi, transmit_delay);
+
+  /* Upper bound of LSAs which can be packed in one body. */
+  new->lsas = XCALLOC (MTYPE_OSPF_LS_UPD_BATCH,
+		       sizeof (struct ospf_lsa *)
+		       * (size / OSPF_LSA_HEADER_SIZE + 1));
+
+  return new;
+}
+
+static void
+ospf_ls_upd_batch_free (void *data)
+{
+  struct ospf_ls_upd_batch *batch = data;
+  unsigned int i;
+
+  for (i = 0; i < batch->count; i++)
+    ospf_lsa_unlock (&batch->lsas[i]); /* batch */
+
+  if (batch->op)
+    ospf_packet_free (batch->op);
+
+  XFREE (MTYPE_OSPF_LS_UPD_BATCH, batch->lsas);
+  XFREE (MTYPE_OSPF_LS_UPD_BATCH, batch);
+}
+
+/* Drop all LS Update bodies built in this flooding round. */
+void
+ospf_ls_upd_batch_flush (struct ospf *ospf)
+{
+  OSPF_TIMER_OFF (ospf->t_ls_upd_batch);
+
+  if (ospf->ls_upd_batch == NULL)
+    return;
+
+  hash_clean (ospf->ls_upd_batch, ospf_ls_upd_batch_free);
+  hash_free (ospf->ls_upd_batch);
+  ospf->ls_upd_batch = NULL;
+}
+
+/* Runs after the LS Update events queued in the same round. */
+static int
+ospf_ls_upd_batch_flush_event (struct thread *thread)
+{
+  struct ospf *ospf = THREAD_ARG (thread);
+
+  ospf->t_ls_upd_batch = NULL;
+  ospf_ls_upd_batch_flush (ospf);
+
+  return 0;
+}
+
+/* Keep a built body for other interfaces of the same class. */
+static void
+ospf_ls_upd_batch_add (struct ospf *ospf, struct ospf_ls_upd_batch *batch,
+		       struct ospf_packet *op)
+{
+  ospf->ls_upd_batch_built++;
+
+  if (batch->count == 0)
+    {
+      ospf_ls_upd_batch_free (batch);
+      return;
+    }
+
+  if (ospf->ls_upd_batch == NULL)
+    ospf->ls_upd_batch = hash_create (ospf_ls_upd_batch_hash_key,
+				      ospf_ls_upd_batch_hash_cmp);
+
+  /* Another body of this class starts with the same LSA; keep that one. */
+  if (hash_lookup (ospf->ls_upd_batch, batch) != NULL)
+    {
+      ospf_ls_upd_batch_free (batch);
+      return;
+    }
+
+  batch->op = ospf_packet_dup (op);
+  hash_get (ospf->ls_upd_batch, batch, hash_alloc_intern);
+
+  if (ospf->t_ls_upd_batch == NULL)
+    ospf->t_ls_upd_batch =
+      thread_add_event (master, ospf_ls_upd_batch_flush_event, ospf, 0);
+}
+
+/* Look for a body already built in this round whose LSAs are exactly
+ * the ones the update list would pack next on this interface. On match
+ * the LSAs are consumed from the list and a copy of the packet, with
+ * the authentication fields of this interface, is returned.
+ */
+static struct ospf_packet *
+ospf_ls_upd_batch_reuse (struct ospf_interface *oi, struct zlist *update)
+{
+  struct ospf_ls_upd_batch key;
+  struct ospf_ls_upd_batch *batch;
+  struct ospf_packet *op;
+  struct ospf_lsa *lsa;
+  struct zlistnode *node;
+  unsigned int i;
+
+  if (oi->ospf->ls_upd_batch == NULL || listcount (update) == 0)
+    return NULL;
+
+  lsa = listgetdata (listhead (update));
+
+  key.area_id = oi->area->area_id;
+  key.auth_type = ospf_auth_type (oi);
+  key.size = ospf_ls_upd_packet_size (oi);
+  key.transmit_delay = OSPF_IF_PARAM (oi, transmit_delay);
+  key.lsas = &lsa;
+
+  if ((batch = hash_lookup (oi->ospf->ls_upd_batch, &key)) == NULL)
+    return NULL;
+
+  /* A body that ran out of LSAs must match the whole list. */
+  if (listcount (update) < batch->count
+      || (!batch->full && listcount (update) != batch->count))
+    return NULL;
+
+  i = 0;
+  for (ALL_LIST_ELEMENTS_RO (update, node, lsa))
+    {
+      if (i == batch->count || lsa != batch->lsas[i])
+	break;
+      i++;
+    }
+
+  if (i != batch->count)
+    return NULL;
+
+  for (i = 0; i < batch->count; i++)
+    {
+      node = listhead (update);
+      lsa = listgetdata (node);
+      list_delete_node (update, node);
+      ospf_lsa_unlock (&lsa); /* oi->ls_upd_queue */
+    }
+
+  /* Checksum is computed with zeroed authentication data, so only the
+     authentication fields differ between interfaces. */
+  op = ospf_packet_dup (batch->op);
+  ospf_make_auth (oi, (struct ospf_header *) STREAM_DATA (op->s));
+
+  oi->ospf->ls_upd_batch_reused++;
+
+  return op;
+}
+
 static void
 ospf_ls_upd_queue_send (struct ospf_interface *oi, struct zlist *update,
 			struct in_addr addr)
 {
   struct ospf_packet *op;
+  struct ospf_ls_upd_batch *batch = NULL;
   u_int16_t length = OSPF_HEADER_SIZE;
 
   if (IS_DEBUG_OSPF_EVENT)
     zlog_debug ("[DBG] listcount = %d, dst %s", listcount (update), inet_ntoa(addr));
+
+  /* Reuse a body built for another interface in this round. */
+  if ((op = ospf_ls_upd_batch_reuse (oi, update)) != NULL)
+    {
+      if (IS_DEBUG_OSPF_EVENT)
+        zlog_debug ("[DBG] ospf_ls_upd_queue_send: reusing LS Update body"
+                    " on %s", IF_NAME (oi));
+
+      op->dst.s_addr = addr.s_addr;
+      ospf_packet_add (oi, op);
+      OSPF_ISM_WRITE_ON (oi->ospf);
+      return;
+    }
   
   op = ospf_ls_upd_packet_new (update, oi);
 
+  /* Only regular MTU-sized bodies are shared, never fragments. */
+  if (STREAM_SIZE (op->s) == ospf_ls_upd_packet_size (oi))
+    batch = ospf_ls_upd_batch_new (oi, STREAM_SIZE (op->s));
+
   /* Prepare OSPF common header. */
   ospf_make_header (OSPF_MSG_LS_UPD, oi, op->s);
 
   /* Prepare OSPF Link State Update body.
    * Includes Type-7 translation. 
    */
-  length += ospf_make_ls_upd (oi, update, op->s);
+  length += ospf_make_ls_upd (oi, update, op->s, batch);
 
   /* Fill OSPF header. */
   ospf_fill_header (oi, op->s, length);
@@ -3486,6 +3772,9 @@ ospf_ls_upd_queue_send (struct ospf_interface *oi, struct zlist *update,
   /* Set packet length. */
   op->length = length;
 
+  if (batch)
+    ospf_ls_upd_batch_add (oi->ospf, batch, op);
+
   /* Decide destination address. */
   op->dst.s_addr = addr.s_addr;
 
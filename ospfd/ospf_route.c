@@ -268,6 +268,9 @@ ospf_route_install (struct ospf *ospf, struct route_table *rt)
 				       (struct prefix_ipv4 *) &rn->p, or))
 	    ospf_zebra_add_discard ((struct prefix_ipv4 *) &rn->p);
       }
+
+  /* Hand the whole diff to zebra at once. */
+  ospf_zebra_route_flush ();
 }
 
 static void
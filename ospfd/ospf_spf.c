@@ -46,12 +46,154 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "ospfd/ospf_abr.h"
 #include "ospfd/ospf_dump.h"
 
+#define ROUTER_LSA_MIN_SIZE 12
+#define ROUTER_LSA_TOS_SIZE 4
+
 static void ospf_vertex_free (void *);
 /* List of allocated vertices, to simplify cleanup of SPF.
  * Not thread-safe obviously. If it ever needs to be, it'd have to be
  * dynamically allocated at begin of ospf_spf_calculate
  */
 static struct zlist vertex_list = { .del = ospf_vertex_free };
+
+/* Vertices, their parent/children lists, parents and nexthops only live
+ * for one ospf_spf_calculate() run.  They are bump-allocated from an
+ * arena which is rewound in one go at the end of the run; the chunks
+ * are kept around for the next run.
+ */
+#define OSPF_SPF_ARENA_CHUNK	16384
+#define OSPF_SPF_ARENA_ALIGN(n)	(((n) + 7) & ~((size_t) 7))
+
+struct ospf_spf_arena_chunk
+{
+  struct ospf_spf_arena_chunk *next;
+  size_t size;
+  size_t used;
+};
+
+static struct
+{
+  struct ospf_spf_arena_chunk *head;
+  struct ospf_spf_arena_chunk *cur;
+} spf_arena;
+
+static void *
+ospf_spf_arena_alloc (size_t size)
+{
+  struct ospf_spf_arena_chunk *chunk;
+  size_t hdr = OSPF_SPF_ARENA_ALIGN (sizeof (struct ospf_spf_arena_chunk));
+  void *p;
+
+  size = OSPF_SPF_ARENA_ALIGN (size);
+
+  /* Move on to the next kept chunk, or grow the arena. */
+  while ((chunk = spf_arena.cur) == NULL || chunk->used + size > chunk->size)
+    {
+      if (chunk && chunk->next)
+        {
+          spf_arena.cur = chunk->next;
+          continue;
+        }
+
+      chunk = XMALLOC (MTYPE_OSPF_SPF_ARENA,
+                       hdr + MAX (size, OSPF_SPF_ARENA_CHUNK));
+      chunk->next = NULL;
+      chunk->size = MAX (size, OSPF_SPF_ARENA_CHUNK);
+      chunk->used = 0;
+
+      if (spf_arena.cur)
+        spf_arena.cur->next = chunk;
+      else
+        spf_arena.head = chunk;
+      spf_arena.cur = chunk;
+    }
+
+  p = (u_char *) chunk + hdr + chunk->used;
+  chunk->used += size;
+  memset (p, 0, size);
+
+  return p;
+}
+
+/* Release everything allocated during this run. */
+static void
+ospf_spf_arena_reset (void)
+{
+  struct ospf_spf_arena_chunk *chunk;
+
+  for (chunk = spf_arena.head; chunk; chunk = chunk->next)
+    chunk->used = 0;
+  spf_arena.cur = spf_arena.head;
+}
+
+/* Decode the links of a router- or network-LSA into a flat edge array.
+ * LSA data is never modified once installed, so the array is cached on
+ * the LSA and reused by later runs until the LSA is replaced.
+ */
+static struct ospf_spf_edge *
+ospf_spf_edges (struct ospf_lsa *lsa, int *count)
+{
+  struct ospf_spf_edge *e;
+  struct router_lsa_link *l;
+  struct network_lsa *nl;
+  u_char *p, *lim;
+  int i, n;
+
+  if (lsa->spf_edges)
+    {
+      *count = lsa->spf_edge_count;
+      return lsa->spf_edges;
+    }
+
+  p = ((u_char *) lsa->data) + OSPF_LSA_HEADER_SIZE + 4;
+  lim = ((u_char *) lsa->data) + ntohs (lsa->data->length);
+
+  if (lsa->data->type == OSPF_ROUTER_LSA)
+    {
+      for (n = 0; p < lim; n++)
+        {
+          l = (struct router_lsa_link *) p;
+          p += (ROUTER_LSA_MIN_SIZE +
+                (l->m[0].tos_count * ROUTER_LSA_TOS_SIZE));
+        }
+    }
+  else
+    n = (ntohs (lsa->data->length) - OSPF_LSA_HEADER_SIZE - 4) / 4;
+
+  *count = 0;
+  if (n <= 0)
+    return NULL;
+
+  e = XCALLOC (MTYPE_OSPF_SPF_EDGE, n * sizeof (struct ospf_spf_edge));
+
+  if (lsa->data->type == OSPF_ROUTER_LSA)
+    {
+      p = ((u_char *) lsa->data) + OSPF_LSA_HEADER_SIZE + 4;
+      for (i = 0; i < n; i++)
+        {
+          l = (struct router_lsa_link *) p;
+          p += (ROUTER_LSA_MIN_SIZE +
+                (l->m[0].tos_count * ROUTER_LSA_TOS_SIZE));
+
+          e[i].id = l->link_id;
+          e[i].link = l;
+          e[i].metric = ntohs (l->m[0].metric);
+          e[i].type = l->m[0].type;
+        }
+    }
+  else
+    {
+      nl = (struct network_lsa *) lsa->data;
+      for (i = 0; i < n; i++)
+        e[i].id = nl->routers[i];
+    }
+
+  lsa->spf_edges = e;
+  lsa->spf_edge_count = n;
+  *count = n;
+
+  return e;
+}
 
 /* Heap related functions, for the managment of the candidates, to
  * be used with pqueue. */
@@ -94,46 +236,8 @@ update_stat (void *node , int position)
 static struct vertex_nexthop *
 vertex_nexthop_new (void)
 {
-  return XCALLOC (MTYPE_OSPF_NEXTHOP, sizeof (struct vertex_nexthop));
+  return ospf_spf_arena_alloc (sizeof (struct vertex_nexthop));
 }
-
-static void
-vertex_nexthop_free (struct vertex_nexthop *nh)
-{
-  XFREE (MTYPE_OSPF_NEXTHOP, nh);
-}
-
-/* Free the canonical nexthop objects for an area, ie the nexthop objects
- * attached to the first-hop router vertices, and any intervening network
- * vertices.
- */
-static void
-ospf_canonical_nexthops_free (struct vertex *root)
-{
-  struct zlistnode *node, *nnode;
-  struct vertex *child;
-  
-  for (ALL_LIST_ELEMENTS (root->children, node, nnode, child))
-    {
-      struct zlistnode *n2, *nn2;
-      struct vertex_parent *vp;
-      
-      /* router vertices through an attached network each
-       * have a distinct (canonical / not inherited) nexthop
-       * which must be freed.
-       *
-       * A network vertex can only have router vertices as its
-       * children, so only one level of recursion is possible.
-       */
-      if (child->type == OSPF_VERTEX_NETWORK)
-        ospf_canonical_nexthops_free (child);
-      
-      /* Free child nexthops pointing back to this root vertex */
-      for (ALL_LIST_ELEMENTS (child->parents, n2, nn2, vp))
-        if (vp->parent == root && vp->nexthop)
-          vertex_nexthop_free (vp->nexthop);
-    }
-}      
 
 /* TODO: Parent list should be excised, in favour of maintaining only
  * vertex_nexthop, with refcounts.
@@ -143,10 +247,7 @@ vertex_parent_new (struct vertex *v, int backlink, struct vertex_nexthop *hop)
 {
   struct vertex_parent *new;
   
-  new = XMALLOC (MTYPE_OSPF_VERTEX_PARENT, sizeof (struct vertex_parent));
-  
-  if (new == NULL)
-    return NULL;
+  new = ospf_spf_arena_alloc (sizeof (struct vertex_parent));
   
   new->parent = v;
   new->backlink = backlink;
@@ -154,27 +255,22 @@ vertex_parent_new (struct vertex *v, int backlink, struct vertex_nexthop *hop)
   return new;
 }
 
-static void
-vertex_parent_free (void *p)
-{
-  XFREE (MTYPE_OSPF_VERTEX_PARENT, p);
-}
 
 static struct vertex *
 ospf_vertex_new (struct ospf_lsa *lsa)
 {
   struct vertex *new;
 
-  new = XCALLOC (MTYPE_OSPF_VERTEX, sizeof (struct vertex));
+  new = ospf_spf_arena_alloc (sizeof (struct vertex));
 
   new->flags = 0;
   new->stat = &(lsa->stat);
   new->type = lsa->data->type;
   new->id = lsa->data->id;
   new->lsa = lsa->data;
-  new->children = list_new ();
-  new->parents = list_new ();
-  new->parents->del = vertex_parent_free;
+  new->edges = ospf_spf_edges (lsa, &new->edge_count);
+  new->children = ospf_spf_arena_alloc (sizeof (struct zlist));
+  new->parents = ospf_spf_arena_alloc (sizeof (struct zlist));
   
   new->distance = 1;
   listnode_add (&vertex_list, new);
@@ -202,17 +298,11 @@ ospf_vertex_free (void *data)
    */
   //assert (listcount (v->parents) == 0);
   
-  if (v->children)
-    list_delete (v->children);
-  v->children = NULL;
-  
-  if (v->parents)
-    list_delete (v->parents);
-  v->parents = NULL;
-  
-  v->lsa = NULL;
-  
-  XFREE (MTYPE_OSPF_VERTEX, v);
+  /* The lists themselves, the parents and the vertex live in the arena,
+   * only the list nodes need to go.
+   */
+  list_delete_all_node (v->children);
+  list_delete_all_node (v->parents);
 }
 
 static void
@@ -295,61 +385,45 @@ ospf_spf_init (struct ospf_area *area)
 
 /* return index of link back to V from W, or -1 if no link found */
 static int
-ospf_lsa_has_link (struct lsa_header *w, struct lsa_header *v)
+ospf_spf_has_link (struct ospf_spf_edge *e, int count, u_char w_type,
+                   struct lsa_header *v)
 {
-  unsigned int i, length;
-  struct router_lsa *rl;
-  struct network_lsa *nl;
+  int i;
 
   /* In case of W is Network LSA. */
-  if (w->type == OSPF_NETWORK_LSA)
+  if (w_type == OSPF_NETWORK_LSA)
     {
       if (v->type == OSPF_NETWORK_LSA)
         return -1;
 
-      nl = (struct network_lsa *) w;
-      length = (ntohs (w->length) - OSPF_LSA_HEADER_SIZE - 4) / 4;
-
-      for (i = 0; i < length; i++)
-        if (IPV4_ADDR_SAME (&nl->routers[i], &v->id))
+      for (i = 0; i < count; i++)
+        if (IPV4_ADDR_SAME (&e[i].id, &v->id))
           return i;
       return -1;
     }
 
   /* In case of W is Router LSA. */
-  if (w->type == OSPF_ROUTER_LSA)
+  if (w_type == OSPF_ROUTER_LSA)
     {
-      rl = (struct router_lsa *) w;
-
-      length = ntohs (w->length);
-
-      for (i = 0;
-           i < ntohs (rl->links) && length >= sizeof (struct router_lsa);
-           i++, length -= 12)
+      for (i = 0; i < count; i++)
         {
-          switch (rl->link[i].type)
+          switch (e[i].type)
             {
             case LSA_LINK_TYPE_POINTOPOINT:
             case LSA_LINK_TYPE_VIRTUALLINK:
               /* Router LSA ID. */
               if (v->type == OSPF_ROUTER_LSA &&
-                  IPV4_ADDR_SAME (&rl->link[i].link_id, &v->id))
-                {
-                  return i;
-                }
+                  IPV4_ADDR_SAME (&e[i].id, &v->id))
+                return i;
               break;
             case LSA_LINK_TYPE_TRANSIT:
               /* Network LSA ID. */
               if (v->type == OSPF_NETWORK_LSA &&
-                  IPV4_ADDR_SAME (&rl->link[i].link_id, &v->id))
-                {
-                  return i;
-                }
+                  IPV4_ADDR_SAME (&e[i].id, &v->id))
+                return i;
               break;
-            case LSA_LINK_TYPE_STUB:
-              /* Stub can't lead anywhere, carry on */
-              continue;
             default:
+              /* Stub can't lead anywhere, carry on */
               break;
             }
         }
@@ -357,9 +431,6 @@ ospf_lsa_has_link (struct lsa_header *w, struct lsa_header *v)
   return -1;
 }
 
-#define ROUTER_LSA_MIN_SIZE 12
-#define ROUTER_LSA_TOS_SIZE 4
-
 /* Find the next link after prev_link from v to w.  If prev_link is
  * NULL, return the first link from v to w.  Ignore stub and virtual links;
  * these link types will never be returned.
@@ -368,38 +439,31 @@ static struct router_lsa_link *
 ospf_get_next_link (struct vertex *v, struct vertex *w,
                     struct router_lsa_link *prev_link)
 {
-  u_char *p;
-  u_char *lim;
-  struct router_lsa_link *l;
+  struct ospf_spf_edge *e;
+  int i = 0;
 
-  if (prev_link == NULL)
-    p = ((u_char *) v->lsa) + OSPF_LSA_HEADER_SIZE + 4;
-  else
+  if (prev_link != NULL)
     {
-      p = (u_char *) prev_link;
-      p += (ROUTER_LSA_MIN_SIZE +
-            (prev_link->m[0].tos_count * ROUTER_LSA_TOS_SIZE));
+      while (i < v->edge_count && v->edges[i].link != prev_link)
+        i++;
+      i++;
     }
 
-  lim = ((u_char *) v->lsa) + ntohs (v->lsa->length);
-
-  while (p < lim)
+  for (; i < v->edge_count; i++)
     {
-      l = (struct router_lsa_link *) p;
-
-      p += (ROUTER_LSA_MIN_SIZE + (l->m[0].tos_count * ROUTER_LSA_TOS_SIZE));
+      e = &v->edges[i];
 
-      if (l->m[0].type == LSA_LINK_TYPE_STUB)
+      if (e->type == LSA_LINK_TYPE_STUB)
         continue;
 
       /* Defer NH calculation via VLs until summaries from
          transit areas area confidered             */
 
-      if (l->m[0].type == LSA_LINK_TYPE_VIRTUALLINK)
+      if (e->type == LSA_LINK_TYPE_VIRTUALLINK)
         continue;
 
-      if (IPV4_ADDR_SAME (&l->link_id, &w->id))
-        return l;
+      if (IPV4_ADDR_SAME (&e->id, &w->id))
+        return e->link;
     }
 
   return NULL;
@@ -408,15 +472,8 @@ ospf_get_next_link (struct vertex *v, struct vertex *w,
 static void
 ospf_spf_flush_parents (struct vertex *w)
 {
-  struct vertex_parent *vp;
-  struct zlistnode *ln, *nn;
-  
-  /* delete the existing nexthops */
-  for (ALL_LIST_ELEMENTS (w->parents, ln, nn, vp))
-    {
-      list_delete_node (w->parents, ln);
-      vertex_parent_free (vp);
-    }
+  /* delete the existing nexthops, the parents stay in the arena */
+  list_delete_all_node (w->parents);
 }
 
 /* 
@@ -467,7 +524,9 @@ ospf_spf_add_parent (struct vertex *v, struct vertex *w,
     }
   
   /* new parent is <= existing parents, add it to parent list */  
-  vp = vertex_parent_new (v, ospf_lsa_has_link (w->lsa, v->lsa), newhop);
+  vp = vertex_parent_new (v, ospf_spf_has_link (w->edges, w->edge_count,
+                                                w->type, v->lsa),
+                          newhop);
   listnode_add (w->parents, vp);
 
   return;
@@ -716,10 +775,9 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
 	       struct pqueue * candidate)
 {
   struct ospf_lsa *w_lsa = NULL;
-  u_char *p;
-  u_char *lim;
+  struct ospf_spf_edge *e, *w_edges;
   struct router_lsa_link *l = NULL;
-  struct in_addr *r;
+  int i, w_count;
   int type = 0;
 
   /* If this is a router-LSA, and bit V of the router-LSA (see Section
@@ -736,34 +794,30 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
                 v->type == OSPF_VERTEX_ROUTER ? "Router" : "Network",
                 inet_ntoa(v->lsa->id));
   
-  p = ((u_char *) v->lsa) + OSPF_LSA_HEADER_SIZE + 4;
-  lim = ((u_char *) v->lsa) + ntohs (v->lsa->length);
-
-  while (p < lim)
+  for (i = 0; i < v->edge_count; i++)
     {
       struct vertex *w;
       unsigned int distance;
       
+      e = &v->edges[i];
+
       /* In case of V is Router-LSA. */
       if (v->lsa->type == OSPF_ROUTER_LSA)
         {
-          l = (struct router_lsa_link *) p;
-
-          p += (ROUTER_LSA_MIN_SIZE +
-                (l->m[0].tos_count * ROUTER_LSA_TOS_SIZE));
+          l = e->link;
 
           /* (a) If this is a link to a stub network, examine the next
              link in V's LSA.  Links to stub networks will be
              considered in the second stage of the shortest path
              calculation. */
-          if ((type = l->m[0].type) == LSA_LINK_TYPE_STUB)
+          if ((type = e->type) == LSA_LINK_TYPE_STUB)
             continue;
           
           /* Infinite distance links shouldn't be followed, except
            * for local links (a stub-routed router still wants to
            * calculate tree, so must follow its own links).
            */
-          if ((v != area->spf) && l->m[0].metric >= OSPF_OUTPUT_COST_INFINITE)
+          if ((v != area->spf) && e->metric >= OSPF_OUTPUT_COST_INFINITE)
             continue;
 
           /* (b) Otherwise, W is a transit vertex (router or transit
@@ -777,23 +831,21 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
                 {
                   if (IS_DEBUG_OSPF_EVENT)
                     zlog_debug ("[DBG] looking up LSA through VL: %s",
-                               inet_ntoa (l->link_id));
+                               inet_ntoa (e->id));
                 }
 
-              w_lsa = ospf_lsa_lookup (area, OSPF_ROUTER_LSA, l->link_id,
-                                       l->link_id);
+              w_lsa = ospf_lsa_lookup (area, OSPF_ROUTER_LSA, e->id, e->id);
               if (w_lsa)
                 {
                   if (IS_DEBUG_OSPF_EVENT)
-                    zlog_debug ("[DBG] found Router LSA %s", inet_ntoa (l->link_id));
+                    zlog_debug ("[DBG] found Router LSA %s", inet_ntoa (e->id));
                 }
               break;
             case LSA_LINK_TYPE_TRANSIT:
               if (IS_DEBUG_OSPF_EVENT)
                 zlog_debug ("[DBG] Looking up Network LSA, ID: %s",
-                           inet_ntoa (l->link_id));
-              w_lsa = ospf_lsa_lookup_by_id (area, OSPF_NETWORK_LSA,
-                                             l->link_id);
+                           inet_ntoa (e->id));
+              w_lsa = ospf_lsa_lookup_by_id (area, OSPF_NETWORK_LSA, e->id);
               if (w_lsa)
                 if (IS_DEBUG_OSPF_EVENT)
                   zlog_debug ("[DBG] found the LSA");
@@ -806,11 +858,8 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
       else
         {
           /* In case of V is Network-LSA. */
-          r = (struct in_addr *) p;
-          p += sizeof (struct in_addr);
-
           /* Lookup the vertex W's LSA. */
-          w_lsa = ospf_lsa_lookup_by_id (area, OSPF_ROUTER_LSA, *r);
+          w_lsa = ospf_lsa_lookup_by_id (area, OSPF_ROUTER_LSA, e->id);
           if (w_lsa)
             {
               if (IS_DEBUG_OSPF_EVENT)
@@ -835,7 +884,8 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
           continue;
         }
 
-      if (ospf_lsa_has_link (w_lsa->data, v->lsa) < 0 )
+      w_edges = ospf_spf_edges (w_lsa, &w_count);
+      if (ospf_spf_has_link (w_edges, w_count, w_lsa->data->type, v->lsa) < 0)
         {
           if (IS_DEBUG_OSPF_EVENT)
             zlog_debug ("[DBG] The LSA doesn't have a link back");
@@ -859,7 +909,7 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
 
       /* calculate link cost D. */
       if (v->lsa->type == OSPF_ROUTER_LSA)
-	distance = v->distance + ntohs (l->m[0].metric);
+	distance = v->distance + e->metric;
       else /* v is not a Router-LSA */
 	distance = v->distance;
 
@@ -958,10 +1008,8 @@ ospf_spf_process_stubs (struct ospf_area *area, struct vertex *v,
                inet_ntoa (area->area_id));
   if (v->type == OSPF_VERTEX_ROUTER)
     {
-      u_char *p;
-      u_char *lim;
-      struct router_lsa_link *l;
       struct router_lsa *rlsa;
+      int i;
 
       if (IS_DEBUG_OSPF_EVENT)
         zlog_debug ("[DBG] ospf_process_stubs():processing router LSA, id: %s",
@@ -972,19 +1020,9 @@ ospf_spf_process_stubs (struct ospf_area *area, struct vertex *v,
       if (IS_DEBUG_OSPF_EVENT)
         zlog_debug ("[DBG] ospf_process_stubs(): we have %d links to process",
                    ntohs (rlsa->links));
-      p = ((u_char *) v->lsa) + OSPF_LSA_HEADER_SIZE + 4;
-      lim = ((u_char *) v->lsa) + ntohs (v->lsa->length);
-
-      while (p < lim)
-        {
-          l = (struct router_lsa_link *) p;
-
-          p += (ROUTER_LSA_MIN_SIZE +
-                (l->m[0].tos_count * ROUTER_LSA_TOS_SIZE));
-
-          if (l->m[0].type == LSA_LINK_TYPE_STUB)
-            ospf_intra_add_stub (rt, l, v, area);
-        }
+      for (i = 0; i < v->edge_count; i++)
+        if (v->edges[i].type == LSA_LINK_TYPE_STUB)
+          ospf_intra_add_stub (rt, v->edges[i].link, v, area);
     }
 
   ospf_vertex_dump("ospf_process_stubs(): after examining links: ", v, 1, 1);
@@ -1092,6 +1130,7 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
 {
   struct pqueue *candidate;
   struct vertex *v;
+  unsigned long nvertex;
   
   if (IS_DEBUG_OSPF_EVENT)
     {
@@ -1187,16 +1226,14 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
   pqueue_delete (candidate);
   
   ospf_vertex_dump (__func__, area->spf, 0, 1);
-  /* Free nexthop information, canonical versions of which are attached
-   * the first level of router vertices attached to the root vertex, see
-   * ospf_nexthop_calculation.
-   */
-  ospf_canonical_nexthops_free (area->spf);
-  
+  nvertex = listcount (&vertex_list);
+
   /* Free SPF vertices, but not the list. List has ospf_vertex_free
-   * as deconstructor.
+   * as deconstructor.  Vertices, parents and nexthops themselves are
+   * released with the arena.
    */
   list_delete_all_node (&vertex_list);
+  ospf_spf_arena_reset ();
   
   /* Increment SPF Calculation Counter. */
   area->spf_calculation++;
@@ -1204,10 +1241,86 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
   quagga_gettime (QUAGGA_CLK_MONOTONIC, &area->ospf->ts_spf);
 
   if (IS_DEBUG_OSPF_EVENT)
-    zlog_debug ("[DBG] ospf_spf_calculate: Stop. %ld vertices",
-                mtype_stats_alloc(MTYPE_OSPF_VERTEX));
+    zlog_debug ("[DBG] ospf_spf_calculate: Stop. %lu vertices", nvertex);
 }
 
+/* Copy the intra-area part of the previous routing tables, which only
+   depends on the SPF trees, as the base for an inter-area recalculation. */
+static struct ospf_route *
+ospf_spf_route_dup (struct ospf_route *or)
+{
+  struct ospf_route *new;
+
+  new = ospf_route_new ();
+  new->type = or->type;
+  new->id = or->id;
+  new->mask = or->mask;
+  new->path_type = or->path_type;
+  new->cost = or->cost;
+  new->u = or->u;
+  ospf_route_copy_nexthops (new, or->paths);
+
+  return new;
+}
+
+static void
+ospf_spf_copy_intra (struct ospf *ospf, struct route_table *new_table,
+		     struct route_table *new_rtrs)
+{
+  struct route_node *rn, *new_rn;
+  struct ospf_route *or;
+  struct zlist *or_list;
+  struct zlistnode *node;
+
+  for (rn = route_top (ospf->new_table); rn; rn = route_next (rn))
+    if ((or = rn->info) != NULL
+	&& or->type == OSPF_DESTINATION_NETWORK
+	&& or->path_type == OSPF_PATH_INTRA_AREA)
+      {
+	new_rn = route_node_get (new_table, &rn->p);
+	new_rn->info = ospf_spf_route_dup (or);
+      }
+
+  for (rn = route_top (ospf->new_rtrs); rn; rn = route_next (rn))
+    if ((or_list = rn->info) != NULL)
+      for (ALL_LIST_ELEMENTS_RO (or_list, node, or))
+	{
+	  if (or->path_type != OSPF_PATH_INTRA_AREA)
+	    continue;
+
+	  new_rn = route_node_get (new_rtrs, &rn->p);
+	  if (new_rn->info == NULL)
+	    new_rn->info = list_new ();
+	  else
+	    route_unlock_node (new_rn);
+
+	  listnode_add (new_rn->info, ospf_spf_route_dup (or));
+	}
+}
+
+/* Transit-summary processing (RFC 2328 16.3) rewrites intra-area
+   routes in place, so their copies cannot be reused while any area
+   is examined for transit summaries: a transit area, a configured
+   virtual link or a Shortcut ABR. */
+static int
+ospf_spf_intra_reusable (struct ospf *ospf)
+{
+  struct zlistnode *node;
+  struct ospf_area *area;
+
+  if (ospf->abr_type == OSPF_ABR_SHORTCUT)
+    return 0;
+
+  if (ospf->vlinks && listcount (ospf->vlinks))
+    return 0;
+
+  for (ALL_LIST_ELEMENTS_RO (ospf->areas, node, area))
+    if (ospf_area_is_transit (area))
+      return 0;
+
+  return 1;
+}
+
 /* Timer for SPF calculation. */
 static int
 ospf_spf_calculate_timer (struct thread *thread)
@@ -1216,35 +1329,53 @@ ospf_spf_calculate_timer (struct thread *thread)
   struct route_table *new_table, *new_rtrs;
   struct ospf_area *area;
   struct zlistnode *node, *nnode;
+  u_char pending;
 
   if (IS_DEBUG_OSPF_EVENT)
     zlog_debug ("[DBG] SPF: Timer (SPF calculation expire)");
 
   ospf->t_spf_calc = NULL;
+  pending = ospf->spf_pending;
+  ospf->spf_pending = 0;
 
   /* Allocate new table tree. */
   new_table = route_table_init ();
   new_rtrs = route_table_init ();
 
-  ospf_vl_unapprove (ospf);
+  /* Only summary-LSAs changed: the SPF trees are still valid, so keep
+     the intra-area routes and redo the inter-area part (RFC 2328 16.5). */
+  if (pending == (1 << OSPF_SPF_CHANGE_SUMMARY)
+      && ospf->new_table && ospf->new_rtrs
+      && ospf_spf_intra_reusable (ospf))
+    {
+      if (IS_DEBUG_OSPF_EVENT)
+        zlog_debug ("[DBG] SPF: summary-LSAs only, skipping Dijkstra");
 
-  /* Calculate SPF for each area. */
-  for (ALL_LIST_ELEMENTS (ospf->areas, node, nnode, area))
+      ospf_spf_copy_intra (ospf, new_table, new_rtrs);
+      ospf->spf_partial++;
+    }
+  else
     {
-      /* Do backbone last, so as to first discover intra-area paths
-       * for any back-bone virtual-links
-       */
-      if (ospf->backbone && ospf->backbone == area)
-        continue;
-      
-      ospf_spf_calculate (area, new_table, new_rtrs);
+      ospf_vl_unapprove (ospf);
+
+      /* Calculate SPF for each area. */
+      for (ALL_LIST_ELEMENTS (ospf->areas, node, nnode, area))
+        {
+          /* Do backbone last, so as to first discover intra-area paths
+           * for any back-bone virtual-links
+           */
+          if (ospf->backbone && ospf->backbone == area)
+            continue;
+
+          ospf_spf_calculate (area, new_table, new_rtrs);
+        }
+
+      /* SPF for backbone, if required */
+      if (ospf->backbone)
+        ospf_spf_calculate (ospf->backbone, new_table, new_rtrs);
+
+      ospf_vl_shut_unapproved (ospf);
     }
-  
-  /* SPF for backbone, if required */
-  if (ospf->backbone)
-    ospf_spf_calculate (ospf->backbone, new_table, new_rtrs);
-  
-  ospf_vl_shut_unapproved (ospf);
 
   ospf_ia_routing (ospf, new_table, new_rtrs);
 
@@ -1283,21 +1414,31 @@ ospf_spf_calculate_timer (struct thread *thread)
   return 0;
 }
 
-/* Add schedule for SPF calculation.  To avoid frequenst SPF calc, we
-   set timer for SPF calc. */
+/* Account for an LSA change of the given class and schedule whatever
+   route recalculation it needs.  Opaque-LSAs never affect routing and
+   AS-external-LSAs are handled by ospf_ase_incremental_update(), so
+   only topology and summary changes arm the SPF timer. */
 void
-ospf_spf_calculate_schedule (struct ospf *ospf)
+ospf_spf_schedule_change (struct ospf *ospf, int change)
 {
   unsigned long delay, elapsed, ht;
   struct timeval result;
 
-  if (IS_DEBUG_OSPF_EVENT)
-    zlog_debug ("[DBG] SPF: calculation timer scheduled");
-
   /* OSPF instance does not exist. */
   if (ospf == NULL)
     return;
-  
+
+  assert (change >= 0 && change < OSPF_SPF_CHANGE_MAX);
+  ospf->spf_changes[change]++;
+
+  if (change == OSPF_SPF_CHANGE_EXTERNAL || change == OSPF_SPF_CHANGE_OPAQUE)
+    return;
+
+  SET_FLAG (ospf->spf_pending, 1 << change);
+
+  if (IS_DEBUG_OSPF_EVENT)
+    zlog_debug ("[DBG] SPF: calculation timer scheduled");
+
   /* SPF calculation timer is already scheduled. */
   if (ospf->t_spf_calc)
     {
@@ -1345,3 +1486,11 @@ ospf_spf_calculate_schedule (struct ospf *ospf)
   ospf->t_spf_calc =
     thread_add_timer_msec (master, ospf_spf_calculate_timer, ospf, delay);
 }
+
+/* Add schedule for SPF calculation.  To avoid frequenst SPF calc, we
+   set timer for SPF calc. */
+void
+ospf_spf_calculate_schedule (struct ospf *ospf)
+{
+  ospf_spf_schedule_change (ospf, OSPF_SPF_CHANGE_TOPOLOGY);
+}
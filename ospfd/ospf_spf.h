@@ -32,6 +32,15 @@
 
 /* The "root" is the node running the SPF calculation */
 
+/** A link of a router- or network-LSA, decoded once and cached on the LSA */
+struct ospf_spf_edge
+{
+  struct in_addr id;               /** Link ID, or attached router */
+  struct router_lsa_link *link;    /** raw link, NULL for Network-LSA */
+  u_int16_t metric;                /** host order, 0 for Network-LSA */
+  u_char type;                     /** LSA_LINK_TYPE_*, 0 for Network-LSA */
+};
+
 /** A router or network in an area */
 struct vertex
 {
@@ -43,6 +52,8 @@ struct vertex
   u_int32_t distance;        /** from root to this vertex */  
   struct zlist *parents;     /** list of parents in SPF tree */
   struct zlist *children;    /** list of children in SPF tree*/
+  struct ospf_spf_edge *edges; /** decoded links of the LSA */
+  int edge_count;
 };
 
 /* A nexthop taken on the root node to get to this (parent) vertex */
@@ -60,6 +71,7 @@ struct vertex_parent
 };
 
 extern void ospf_spf_calculate_schedule (struct ospf *);
+extern void ospf_spf_schedule_change (struct ospf *, int);
 extern void ospf_rtrs_free (struct route_table *);
 
 /* void ospf_spf_calculate_timer_add (); */
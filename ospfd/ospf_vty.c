@@ -2626,6 +2626,64 @@ ALIAS (no_ospf_refresh_timer,
        "Adjust refresh parameters\n"
        "Unset refresh timer\n")
 
+DEFUN (ospf_refresh_rate_limit, ospf_refresh_rate_limit_cmd,
+       "refresh rate-limit <1-65535>",
+       "Adjust refresh parameters\n"
+       "Limit the number of LSAs refreshed per second\n"
+       "Number of LSAs\n")
+{
+  struct ospf *ospf = vty->index;
+  unsigned int limit;
+
+  VTY_GET_INTEGER_RANGE ("refresh rate-limit", limit, argv[0], 1, 65535);
+
+  ospf->lsa_refresh_rate_limit = limit;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ospf_refresh_rate_limit, no_ospf_refresh_rate_limit_cmd,
+       "no refresh rate-limit",
+       NO_STR
+       "Adjust refresh parameters\n"
+       "Limit the number of LSAs refreshed per second\n")
+{
+  struct ospf *ospf = vty->index;
+
+  ospf->lsa_refresh_rate_limit = 0;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (ospf_ls_request_window, ospf_ls_request_window_cmd,
+       "ls-request window <1-64>",
+       "Adjust Link State Request parameters\n"
+       "Outstanding Link State Request packets per neighbor\n"
+       "Number of packets\n")
+{
+  struct ospf *ospf = vty->index;
+  unsigned int window;
+
+  VTY_GET_INTEGER_RANGE ("ls-request window", window, argv[0], 1, 64);
+
+  ospf->ls_req_window = window;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ospf_ls_request_window, no_ospf_ls_request_window_cmd,
+       "no ls-request window",
+       NO_STR
+       "Adjust Link State Request parameters\n"
+       "Outstanding Link State Request packets per neighbor\n")
+{
+  struct ospf *ospf = vty->index;
+
+  ospf->ls_req_window = OSPF_LS_REQUEST_WINDOW_DEFAULT;
+
+  return CMD_SUCCESS;
+}
+
 DEFUN (ospf_auto_cost_reference_bandwidth,
        ospf_auto_cost_reference_bandwidth_cmd,
        "auto-cost reference-bandwidth <1-4294967>",
@@ -2927,6 +2985,30 @@ DEFUN (show_ip_ospf,
   /* Show refresh parameters. */
   vty_out (vty, " Refresh timer %d secs%s",
 	   ospf->lsa_refresh_interval, VTY_NEWLINE);
+  if (ospf->lsa_refresh_rate_limit)
+    vty_out (vty, " Refresh rate limited to %u LSAs per second%s",
+	     ospf->lsa_refresh_rate_limit, VTY_NEWLINE);
+  vty_out (vty, " LSAs pending refresh %u, largest refresh batch %u%s",
+	   ospf->lsa_refresh_queue.pending_count,
+	   ospf->lsa_refresh_burst_max, VTY_NEWLINE);
+
+  /* Show route recalculation by LSA change class. */
+  vty_out (vty, " LSA changes: topology %u, summary %u, external %u, "
+	   "opaque %u%s",
+	   ospf->spf_changes[OSPF_SPF_CHANGE_TOPOLOGY],
+	   ospf->spf_changes[OSPF_SPF_CHANGE_SUMMARY],
+	   ospf->spf_changes[OSPF_SPF_CHANGE_EXTERNAL],
+	   ospf->spf_changes[OSPF_SPF_CHANGE_OPAQUE], VTY_NEWLINE);
+  vty_out (vty, " Inter-area recalculations without SPF %u%s",
+	   ospf->spf_partial, VTY_NEWLINE);
+
+  /* Show LS Request window. */
+  vty_out (vty, " Outstanding LS Requests per neighbor %d%s",
+	   ospf->ls_req_window, VTY_NEWLINE);
+
+  /* Show flooding statistics. */
+  vty_out (vty, " LS Update bodies built %u, shared across interfaces %u%s",
+	   ospf->ls_upd_batch_built, ospf->ls_upd_batch_reused, VTY_NEWLINE);
 	   
   /* Show ABR/ASBR flags. */
   if (CHECK_FLAG (ospf->flags, OSPF_FLAG_ABR))
@@ -3488,6 +3570,10 @@ show_ip_ospf_neighbor_detail_sub (struct vty *vty, struct ospf_interface *oi,
                (nbr->last_regress_str ? nbr->last_regress_str : "??"),
                VTY_NEWLINE);
     }
+  if (nbr->tv_to_full.tv_sec || nbr->tv_to_full.tv_usec)
+    vty_out (vty, "      Last database exchange took %s%s",
+             ospf_timeval_dump (&nbr->tv_to_full, timebuf, sizeof(timebuf)),
+             VTY_NEWLINE);
   /* Show Designated Rotuer ID. */
   vty_out (vty, "    DR is %s,", inet_ntoa (nbr->d_router));
   /* Show Backup Designated Rotuer ID. */
@@ -3503,8 +3589,9 @@ show_ip_ospf_neighbor_detail_sub (struct vty *vty, struct ospf_interface *oi,
   vty_out (vty, "    Database Summary List %d%s",
 	   ospf_db_summary_count (nbr), VTY_NEWLINE);
   /* Show Link State Request list. */
-  vty_out (vty, "    Link State Request List %ld%s",
-	   ospf_ls_request_count (nbr), VTY_NEWLINE);
+  vty_out (vty, "    Link State Request List %ld, %d of %d requests in flight%s",
+	   ospf_ls_request_count (nbr), listcount (nbr->ls_req_inflight),
+	   oi->ospf->ls_req_window, VTY_NEWLINE);
   /* Show Link State Retransmission list. */
   vty_out (vty, "    Link State Retransmission List %ld%s",
 	   ospf_ls_retransmit_count (nbr), VTY_NEWLINE);
@@ -4479,6 +4566,120 @@ show_lsa_detail (struct vty *vty, struct ospf *ospf, int type,
     }
 }
 
+/* Number of LSAs printed per step of a streamed database walk. */
+#define OSPF_SHOW_LSA_STEP 32
+
+/* Position of `show ip ospf database LSA' between steps. */
+struct show_lsa_walk
+{
+  struct ospf *ospf;
+  int type;
+  struct in_addr area_id;	/* area being shown, areas go by ID */
+  int area_done;		/* go on with the area after area_id */
+  int started;
+  struct prefix last;
+};
+
+/* Print the next OSPF_SHOW_LSA_STEP LSAs of the walk, resuming after
+   the last one printed.  Returns 0 once every table has been shown. */
+static int
+show_lsa_detail_step (struct vty *vty, void *arg)
+{
+  struct show_lsa_walk *w = arg;
+  struct route_table *rt;
+  struct route_node *rn;
+  struct ospf_lsa *lsa;
+  struct zlistnode *node;
+  struct ospf_area *area;
+  int count = 0;
+
+  /* The instance may have gone away since the last step. */
+  if (! listnode_lookup (om->ospf, w->ospf))
+    return 0;
+
+  switch (w->type)
+    {
+    case OSPF_AS_EXTERNAL_LSA:
+#ifdef HAVE_OPAQUE_LSA
+    case OSPF_OPAQUE_AS_LSA:
+#endif /* HAVE_OPAQUE_LSA */
+      if (w->area_done)
+        return 0;
+      if (! w->started)
+        vty_out (vty, "                %s %s%s",
+                 show_database_desc[w->type],
+                 VTY_NEWLINE, VTY_NEWLINE);
+      rt = AS_LSDB (w->ospf, w->type);
+      break;
+    default:
+      /* Areas are sorted by ID and may come and go between steps, so
+         look the area up again rather than holding on to it. */
+      area = NULL;
+      for (ALL_LIST_ELEMENTS_RO (w->ospf->areas, node, area))
+        if (ntohl (area->area_id.s_addr) > ntohl (w->area_id.s_addr)
+            || (! w->area_done
+                && area->area_id.s_addr == w->area_id.s_addr))
+          break;
+      if (! node)
+        return 0;
+      if (area->area_id.s_addr != w->area_id.s_addr || w->area_done)
+        {
+          /* A new area, or the one shown was removed. */
+          w->area_id = area->area_id;
+          w->area_done = 0;
+          w->started = 0;
+        }
+      if (! w->started)
+        vty_out (vty, "%s                %s (Area %s)%s%s",
+                 VTY_NEWLINE, show_database_desc[w->type],
+                 ospf_area_desc_string (area), VTY_NEWLINE, VTY_NEWLINE);
+      rt = AREA_LSDB (area, w->type);
+      break;
+    }
+
+  if (w->started)
+    rn = route_next (route_node_get (rt, &w->last));
+  else
+    rn = route_top (rt);
+  w->started = 1;
+
+  for (; rn; rn = route_next (rn))
+    if ((lsa = rn->info))
+      {
+        if (show_function[lsa->data->type] != NULL)
+          show_function[lsa->data->type] (vty, lsa);
+        if (++count == OSPF_SHOW_LSA_STEP)
+          {
+            w->last = rn->p;
+            route_unlock_node (rn);
+            return 1;
+          }
+      }
+
+  /* This table is done, go on with the next area. */
+  w->area_done = 1;
+  w->started = 0;
+  return 1;
+}
+
+static void
+show_lsa_detail_walk_free (void *arg)
+{
+  XFREE (MTYPE_TMP, arg);
+}
+
+/* Show all LSAs of a type, a few at a time as the vty drains. */
+static void
+show_lsa_detail_all (struct vty *vty, struct ospf *ospf, int type)
+{
+  struct show_lsa_walk *w;
+
+  w = XCALLOC (MTYPE_TMP, sizeof (struct show_lsa_walk));
+  w->ospf = ospf;
+  w->type = type;
+  vty_out_stream (vty, show_lsa_detail_step, show_lsa_detail_walk_free, w);
+}
+
 /** Show detail TNA opaque information
   * if id is NULL then show all TNAs.
   * @param vty
@@ -4686,13 +4887,12 @@ show_ip_ospf_database_summary (struct vty *vty, struct ospf *ospf, int self)
 static void
 show_ip_ospf_database_maxage (struct vty *vty, struct ospf *ospf)
 {
-  struct zlistnode *node;
   struct ospf_lsa *lsa;
 
   vty_out (vty, "%s                MaxAge Link States:%s%s",
            VTY_NEWLINE, VTY_NEWLINE, VTY_NEWLINE);
 
-  for (ALL_LIST_ELEMENTS_RO (ospf->maxage_lsa, node, lsa))
+  for (lsa = ospf->maxage_lsa; lsa; lsa = lsa->maxage_next)
     {
       vty_out (vty, "Link type: %d%s", lsa->data->type, VTY_NEWLINE);
       vty_out (vty, "Link State ID: %s%s",
@@ -4860,7 +5060,7 @@ DEFUN (show_ip_ospf_database,
 
   /* `show ip ospf database LSA'. */
   if (argc == 1 + CLI_ARG_GMPLS)
-    show_lsa_detail (vty, ospf, type, NULL, NULL);
+    show_lsa_detail_all (vty, ospf, type);
   else if (argc >= 2 + CLI_ARG_GMPLS)
   {
     ret = inet_aton (argv[1 + CLI_ARG_GMPLS], &id);
@@ -8926,6 +9126,13 @@ ospf_config_instance_write (struct vty *vty, struct ospf *ospf)
   if (ospf->lsa_refresh_interval != OSPF_LSA_REFRESH_INTERVAL_DEFAULT)
     vty_out (vty, " refresh timer %d%s",
   ospf->lsa_refresh_interval, VTY_NEWLINE);
+  if (ospf->lsa_refresh_rate_limit)
+    vty_out (vty, " refresh rate-limit %u%s",
+	     ospf->lsa_refresh_rate_limit, VTY_NEWLINE);
+
+  /* LS Request window print. */
+  if (ospf->ls_req_window != OSPF_LS_REQUEST_WINDOW_DEFAULT)
+    vty_out (vty, " ls-request window %d%s", ospf->ls_req_window, VTY_NEWLINE);
 
   /* Redistribute information print. */
   config_write_ospf_redistribute (vty, ospf);
@@ -9433,6 +9640,14 @@ ospf_vty_init (void)
   install_element (OSPF_NODE, &ospf_refresh_timer_cmd);
   install_element (OSPF_NODE, &no_ospf_refresh_timer_val_cmd);
   install_element (OSPF_NODE, &no_ospf_refresh_timer_cmd);
+
+  /* refresh rate-limit commands */
+  install_element (OSPF_NODE, &ospf_refresh_rate_limit_cmd);
+  install_element (OSPF_NODE, &no_ospf_refresh_rate_limit_cmd);
+
+  /* ls-request window commands */
+  install_element (OSPF_NODE, &ospf_ls_request_window_cmd);
+  install_element (OSPF_NODE, &no_ospf_ls_request_window_cmd);
   
   /* max-metric commands */
   install_element (OSPF_NODE, &ospf_max_metric_router_lsa_admin_cmd);
@@ -488,94 +488,47 @@ ospf_interface_address_delete (int command, struct zclient *zclient,
   return 0;
 }
 
-void
-ospf_zebra_add (struct prefix_ipv4 *p, struct ospf_route *or)
-{
-  u_char message;
-  u_char distance;
-  u_char flags;
-  int psize;
-  struct stream *s;
-  struct ospf_path *path;
-  struct zlistnode *node;
-
-  if (zclient->redist[ZEBRA_ROUTE_OSPF])
-    {
-      message = 0;
-      flags = 0;
-
-      /* OSPF pass nexthop and metric */
-      SET_FLAG (message, ZAPI_MESSAGE_NEXTHOP);
-      SET_FLAG (message, ZAPI_MESSAGE_METRIC);
-
-      /* Distance value. */
-      distance = ospf_distance_apply (p, or);
-      if (distance)
-        SET_FLAG (message, ZAPI_MESSAGE_DISTANCE);
-
-      /* Make packet. */
-      s = zclient->obuf;
-      stream_reset (s);
-
-      /* Put command, type, flags, message. */
-      zclient_create_header (s, ZEBRA_IPV4_ROUTE_ADD);
-      stream_putc (s, ZEBRA_ROUTE_OSPF);
-      stream_putc (s, flags);
-      stream_putc (s, message);
-
-      /* Put prefix information. */
-      psize = PSIZE (p->prefixlen);
-      stream_putc (s, p->prefixlen);
-      stream_write (s, (u_char *) & p->prefix, psize);
-
-      /* Nexthop count. */
-      stream_putc (s, or->paths->count);
-
-      /* Nexthop, ifindex, distance and metric information. */
-      for (ALL_LIST_ELEMENTS_RO (or->paths, node, path))
-        {
-          if (path->nexthop.s_addr != INADDR_ANY)
-            {
-              stream_putc (s, ZEBRA_NEXTHOP_IPV4);
-              stream_put_in_addr (s, &path->nexthop);
-            }
-          else
-            {
-              stream_putc (s, ZEBRA_NEXTHOP_IFINDEX);
-              if (path->oi)
-                stream_putl (s, path->oi->ifp->ifindex);
-              else
-                stream_putl (s, 0);
-            }
+/* Route changes are queued into one ZEBRA_IPV4_ROUTE_BULK message,
+   sent by ospf_zebra_route_flush() once a route table diff is done, or
+   from an event for changes made elsewhere. */
+static struct thread *ospf_zebra_t_flush = NULL;
 
-          if (IS_DEBUG_OSPF (zebra, ZEBRA_REDISTRIBUTE))
-            {
-	      char buf[2][INET_ADDRSTRLEN];
-	      zlog_debug("Zebra: Route add %s/%d nexthop %s",
-			 inet_ntop(AF_INET, &p->prefix,
-				   buf[0], sizeof(buf[0])),
-			 p->prefixlen,
-			 inet_ntop(AF_INET, &path->nexthop,
-				   buf[1], sizeof(buf[1])));
-            }
-        }
+static int
+ospf_zebra_route_flush_event (struct thread *thread)
+{
+  ospf_zebra_t_flush = NULL;
+  zapi_ipv4_bulk_flush (zclient);
+  return 0;
+}
 
-      if (CHECK_FLAG (message, ZAPI_MESSAGE_DISTANCE))
-        stream_putc (s, distance);
-      if (CHECK_FLAG (message, ZAPI_MESSAGE_METRIC))
-        {
-          if (or->path_type == OSPF_PATH_TYPE1_EXTERNAL)
-            stream_putl (s, or->cost + or->u.ext.type2_cost);
-          else if (or->path_type == OSPF_PATH_TYPE2_EXTERNAL)
-            stream_putl (s, or->u.ext.type2_cost);
-          else
-            stream_putl (s, or->cost);
-        }
+static void
+ospf_zebra_route_queue (u_char cmd, struct prefix_ipv4 *p,
+                        struct zapi_ipv4 *api)
+{
+  zapi_ipv4_bulk_add (cmd, zclient, p, api);
 
-      stream_putw_at (s, 0, stream_get_endp (s));
+  if (ospf_zebra_t_flush == NULL)
+    ospf_zebra_t_flush =
+      thread_add_event (master, ospf_zebra_route_flush_event, NULL, 0);
+}
 
-      //zclient_send_message(zclient);
+/* Send the route changes queued so far. */
+void
+ospf_zebra_route_flush (void)
+{
+  if (ospf_zebra_t_flush)
+    {
+      thread_cancel (ospf_zebra_t_flush);
+      ospf_zebra_t_flush = NULL;
     }
+  zapi_ipv4_bulk_flush (zclient);
+}
+
+void
+ospf_zebra_add (struct prefix_ipv4 *p, struct ospf_route *or)
+{
+  /* OSPF routes are intentionally not installed into the RIB. */
+  return;
 }
 
 void
@@ -616,7 +569,7 @@ ospf_zebra_delete (struct prefix_ipv4 *p, struct ospf_route *or)
                          p->prefixlen);
             }
 
-          zapi_ipv4_route (ZEBRA_IPV4_ROUTE_DELETE, zclient, p, &api);
+          ospf_zebra_route_queue (ZEBRA_IPV4_ROUTE_DELETE, p, &api);
 
           if (IS_DEBUG_OSPF (zebra, ZEBRA_REDISTRIBUTE) && api.nexthop_num)
             {
@@ -651,7 +604,7 @@ ospf_zebra_add_discard (struct prefix_ipv4 *p)
       api.nexthop_num = 0;
       api.ifindex_num = 0;
 
-      zapi_ipv4_route (ZEBRA_IPV4_ROUTE_ADD, zclient, p, &api);
+      ospf_zebra_route_queue (ZEBRA_IPV4_ROUTE_ADD, p, &api);
 
       if (IS_DEBUG_OSPF (zebra, ZEBRA_REDISTRIBUTE))
         zlog_debug ("Zebra: Route add discard %s/%d",
@@ -673,7 +626,7 @@ ospf_zebra_delete_discard (struct prefix_ipv4 *p)
       api.nexthop_num = 0;
       api.ifindex_num = 0;
 
-      zapi_ipv4_route (ZEBRA_IPV4_ROUTE_DELETE, zclient, p, &api);
+      ospf_zebra_route_queue (ZEBRA_IPV4_ROUTE_DELETE, p, &api);
 
       if (IS_DEBUG_OSPF (zebra, ZEBRA_REDISTRIBUTE))
         zlog_debug ("Zebra: Route delete discard %s/%d",
@@ -49,6 +49,7 @@ extern void ospf_zebra_delete (struct prefix_ipv4 *, struct ospf_route *);
 
 extern void ospf_zebra_add_discard (struct prefix_ipv4 *);
 extern void ospf_zebra_delete_discard (struct prefix_ipv4 *);
+extern void ospf_zebra_route_flush (void);
 
 extern int ospf_default_originate_timer (struct thread *);
 
@@ -192,7 +192,6 @@ ospf_new (adj_type_t interface_type)
   new->spf_hold_multiplier = 1;
 
   /* MaxAge init. */
-  new->maxage_lsa = list_new ();
   new->t_maxage_walker =
     thread_add_timer (master, ospf_lsa_maxage_walker,
                       new, OSPF_LSA_MAXAGE_CHECK_INTERVAL);
@@ -224,6 +223,12 @@ ospf_new (adj_type_t interface_type)
   new->oi_write_q = list_new ();
   new->rc_interface = NULL;
 
+  new->nbr_slots = vector_init (VECTOR_MIN_SIZE);
+  new->ls_rxmt_index = ospf_ls_rxmt_index_new ();
+
+  new->ls_req_window = OSPF_LS_REQUEST_WINDOW_DEFAULT;
+  new->ls_req_inflight = ospf_ls_request_inflight_new ();
+
   new->read_tna = 0;
   return new;
 }
@@ -544,6 +549,12 @@ ospf_finish_final (struct ospf *ospf)
   for (ALL_LIST_ELEMENTS (ospf->oiflist, node, nnode, oi))
     ospf_if_free (oi);
 
+  ospf_ls_upd_batch_flush (ospf);
+
+  ospf_ls_rxmt_index_free (ospf->ls_rxmt_index);
+  ospf_ls_request_inflight_free (ospf->ls_req_inflight);
+  vector_free (ospf->nbr_slots);
+
   /* Clear static neighbors */
   for (rn = route_top (ospf->nbr_nbma); rn; rn = route_next (rn))
     if ((nbr_nbma = rn->info))
@@ -595,6 +606,7 @@ ospf_finish_final (struct ospf *ospf)
   OSPF_TIMER_OFF (ospf->t_asbr_check);
   OSPF_TIMER_OFF (ospf->t_distribute_update);
   OSPF_TIMER_OFF (ospf->t_lsa_refresher);
+  OSPF_TIMER_OFF (ospf->t_lsa_refresh_pacer);
   OSPF_TIMER_OFF (ospf->t_read);
   OSPF_TIMER_OFF (ospf->t_write);
 #ifdef HAVE_OPAQUE_LSA
@@ -614,10 +626,8 @@ ospf_finish_final (struct ospf *ospf)
   ospf_lsdb_delete_all (ospf->lsdb);
   ospf_lsdb_free (ospf->lsdb);
 
-  for (ALL_LIST_ELEMENTS (ospf->maxage_lsa, node, nnode, lsa))
-    ospf_lsa_unlock (&lsa); /* maxage_lsa */
-
-  list_delete (ospf->maxage_lsa);
+  while ((lsa = ospf->maxage_lsa) != NULL)
+    ospf_lsa_maxage_delete (ospf, lsa);
 
   if (ospf->old_table)
     ospf_route_table_free (ospf->old_table);
@@ -25,6 +25,7 @@
 
 #include "filter.h"
 #include "log.h"
+#include "vector.h"
 
 #define OSPF_VERSION            2
 
@@ -92,6 +93,13 @@
 #define OSPF_SPF_HOLDTIME_DEFAULT           1000
 #define OSPF_SPF_MAX_HOLDTIME_DEFAULT	    10000
 
+/* OSPF LSA change classes, see ospf_spf_schedule_change(). */
+#define OSPF_SPF_CHANGE_TOPOLOGY            0   /* Router/network, full SPF */
+#define OSPF_SPF_CHANGE_SUMMARY             1   /* Summary, inter-area only */
+#define OSPF_SPF_CHANGE_EXTERNAL            2   /* AS-external, ASE only */
+#define OSPF_SPF_CHANGE_OPAQUE              3   /* Opaque, no recalculation */
+#define OSPF_SPF_CHANGE_MAX                 4
+
 /* OSPF interface default values. */
 #define OSPF_OUTPUT_COST_DEFAULT           10
 #define OSPF_OUTPUT_COST_INFINITE	   UINT16_MAX
@@ -209,6 +217,9 @@ struct ospf
   unsigned int spf_holdtime;		/* SPF hold time. */
   unsigned int spf_max_holdtime;	/* SPF maximum-holdtime */
   unsigned int spf_hold_multiplier;	/* Adaptive multiplier for hold time */
+  u_char spf_pending;			/* Change classes behind t_spf_calc */
+  u_int32_t spf_changes[OSPF_SPF_CHANGE_MAX]; /* LSA changes per class */
+  u_int32_t spf_partial;		/* Recalculations without Dijkstra */
   
   int default_originate;		/* Default information originate. */
 #define DEFAULT_ORIGINATE_NONE		0
@@ -251,7 +262,10 @@ struct ospf
   /* Time stamps. */
   struct timeval ts_spf;		/* SPF calculation time stamp. */
 
-  struct zlist *maxage_lsa;              /* List of MaxAge LSA for deletion. */
+  struct ospf_lsa *maxage_lsa;          /* MaxAge LSAs for deletion. */
+  struct ospf_lsa *maxage_lsa_tail;
+  u_int32_t maxage_count;
+#define OSPF_MAXAGE_REMOVE_BATCH 256	/* LSAs per remover run */
   int redistribute;                     /* Num of redistributed protocols. */
 
   /* Threads. */
@@ -274,6 +288,24 @@ struct ospf
   int fd;
   struct stream *ibuf;
   struct zlist *oi_write_q;
+
+  /* LS Update bodies built in the current flooding round, shared by
+     interfaces of the same (area, auth-type, MTU) class. */
+  struct hash *ls_upd_batch;
+  struct thread *t_ls_upd_batch;
+  u_int32_t ls_upd_batch_built;		/* LS Update bodies encoded. */
+  u_int32_t ls_upd_batch_reused;	/* LS Updates sent from a shared body. */
+
+  /* Neighbors by compact slot id, and for every LSA on some neighbor's
+     retransmit list the set of slots it is pending for. */
+  vector nbr_slots;
+  struct hash *ls_rxmt_index;
+
+  /* Outstanding LS Request packets allowed per neighbor, and the LSAs
+     currently requested from any neighbor. */
+#define OSPF_LS_REQUEST_WINDOW_DEFAULT 1
+  u_int16_t ls_req_window;
+  struct hash *ls_req_inflight;
   
   /* Distribute lists out of other route sources. */
   struct 
@@ -306,16 +338,27 @@ struct ospf
 #define OSPF_LSA_REFRESHER_GRANULARITY 10
 #define OSPF_LSA_REFRESHER_SLOTS ((OSPF_LS_REFRESH_TIME + \
                                   OSPF_LS_REFRESH_SHIFT)/10 + 1)
+/* refresh_list value of LSAs due for refresh, waiting in pending. */
+#define OSPF_LSA_REFRESH_PENDING OSPF_LSA_REFRESHER_SLOTS
   struct
   {
     u_int16_t index;
-    struct zlist *qs[OSPF_LSA_REFRESHER_SLOTS];
+    struct ospf_lsa *qs[OSPF_LSA_REFRESHER_SLOTS];
+
+    /* Due LSAs, oldest first, paced out over the refresh interval. */
+    struct ospf_lsa *pending;
+    struct ospf_lsa *pending_tail;
+    u_int32_t pending_count;
   } lsa_refresh_queue;
   
   struct thread *t_lsa_refresher;
+  struct thread *t_lsa_refresh_pacer;
   time_t lsa_refresher_started;
 #define OSPF_LSA_REFRESH_INTERVAL_DEFAULT 10
   u_int16_t lsa_refresh_interval;
+#define OSPF_LSA_REFRESH_TICK 1
+  u_int32_t lsa_refresh_rate_limit;	/* LSAs per tick, 0 unlimited */
+  u_int32_t lsa_refresh_burst_max;	/* largest batch paced out */
   
   /* Distance parameter. */
   u_char distance_all;
@@ -1596,6 +1596,68 @@ DEFUNSH (VTYSH_ALL,
 	return CMD_SUCCESS;
 }
 
+DEFUNSH (VTYSH_ALL,
+	 vtysh_log_buffered,
+	 vtysh_log_buffered_cmd,
+	 "log buffered <16-65536>",
+	 "Logging control\n"
+	 "Write informational and debug messages after each event\n"
+	 "Number of messages kept until then\n")
+{
+	return CMD_SUCCESS;
+}
+
+DEFUNSH (VTYSH_ALL,
+	 no_vtysh_log_buffered,
+	 no_vtysh_log_buffered_cmd,
+	 "no log buffered",
+	 NO_STR
+	 "Logging control\n"
+	 "Write every message at once\n")
+{
+	return CMD_SUCCESS;
+}
+
+ALIAS_SH (VTYSH_ALL,
+	  no_vtysh_log_buffered,
+	  no_vtysh_log_buffered_val_cmd,
+	  "no log buffered <16-65536>",
+	  NO_STR
+	  "Logging control\n"
+	  "Write every message at once\n"
+	  "Number of messages kept until then\n");
+
+DEFUNSH (VTYSH_ALL,
+	 vtysh_log_rate_limit,
+	 vtysh_log_rate_limit_cmd,
+	 "log rate-limit <1-100000>",
+	 "Logging control\n"
+	 "Limit the messages logged from one place in the code\n"
+	 "Messages per second\n")
+{
+	return CMD_SUCCESS;
+}
+
+DEFUNSH (VTYSH_ALL,
+	 no_vtysh_log_rate_limit,
+	 no_vtysh_log_rate_limit_cmd,
+	 "no log rate-limit",
+	 NO_STR
+	 "Logging control\n"
+	 "Do not limit the messages logged from one place in the code\n")
+{
+	return CMD_SUCCESS;
+}
+
+ALIAS_SH (VTYSH_ALL,
+	  no_vtysh_log_rate_limit,
+	  no_vtysh_log_rate_limit_val_cmd,
+	  "no log rate-limit <1-100000>",
+	  NO_STR
+	  "Logging control\n"
+	  "Do not limit the messages logged from one place in the code\n"
+	  "Messages per second\n");
+
 DEFUNSH (VTYSH_ALL,
 	 vtysh_service_password_encrypt,
 	 vtysh_service_password_encrypt_cmd,
@@ -2446,6 +2508,12 @@ vtysh_init_vty (void)
 	install_element (CONFIG_NODE, &no_vtysh_log_record_priority_cmd);
 	install_element (CONFIG_NODE, &vtysh_log_timestamp_precision_cmd);
 	install_element (CONFIG_NODE, &no_vtysh_log_timestamp_precision_cmd);
+	install_element (CONFIG_NODE, &vtysh_log_buffered_cmd);
+	install_element (CONFIG_NODE, &no_vtysh_log_buffered_cmd);
+	install_element (CONFIG_NODE, &no_vtysh_log_buffered_val_cmd);
+	install_element (CONFIG_NODE, &vtysh_log_rate_limit_cmd);
+	install_element (CONFIG_NODE, &no_vtysh_log_rate_limit_cmd);
+	install_element (CONFIG_NODE, &no_vtysh_log_rate_limit_val_cmd);
 
 	install_element (CONFIG_NODE, &vtysh_service_password_encrypt_cmd);
 	install_element (CONFIG_NODE, &no_vtysh_service_password_encrypt_cmd);
@@ -36,5 +36,8 @@ int kernel_address_delete_ipv4 (struct interface *a, struct connected *b)
   return 0;
 }
 
+void kernel_flush (void) { return; }
+void kernel_drain (void) { return; }
+
 void kernel_init (void) { return; }
 #pragma weak route_read = kernel_init
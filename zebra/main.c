@@ -38,6 +38,7 @@
 #include "zebra/router-id.h"
 #include "zebra/irdp.h"
 #include "zebra/rtadv.h"
+#include "zebra/rt.h"
 
 #ifdef GMPLS
 #include "lib/corba.h"
@@ -175,7 +176,11 @@ sigint (void)
   zlog_notice ("Terminating on signal");
 
   if (!retain_mode)
-    rib_close ();
+    {
+      rib_close ();
+      /* The routes withdrawn above are only queued so far. */
+      kernel_drain ();
+    }
 #ifdef HAVE_IRDP
   irdp_finish();
 #endif
@@ -73,6 +73,10 @@ struct rib
   u_char nexthop_num;
   u_char nexthop_active_num;
   u_char nexthop_fib_num;
+
+  /* Bumped by rib_install_kernel(), so that a late failure report can
+     tell this install from an older one. */
+  u_int32_t fib_gen;
 };
 
 /* Static route information. */
@@ -238,7 +242,30 @@ extern struct rib *rib_match_ipv4 (struct in_addr);
 
 extern struct rib *rib_lookup_ipv4 (struct prefix_ipv4 *);
 
+/* FIB programming counters, shown by "show zebra statistics".  The
+   kernel interface fills in the batching fields if it batches. */
+struct rib_fib_stats
+{
+  unsigned long installs;	/* routes handed to the kernel */
+  unsigned long removals;
+  unsigned long failures;	/* routes the kernel refused */
+  unsigned long batches;	/* kernel writes carrying routes */
+  unsigned long inflight;	/* sent, not yet acknowledged */
+  unsigned long inflight_max;
+
+  /* Installs plus removals per second. */
+  time_t rate_sec;		/* second rate_count is counting */
+  unsigned long rate_count;
+  unsigned long rate_last;	/* count of the second before */
+  unsigned long rate_peak;
+};
+
+extern struct rib_fib_stats rib_fib_stats;
+extern void rib_install_kernel_failed (struct prefix *, u_int32_t);
+
 extern void rib_update (void);
+extern void rib_bulk_begin (void);
+extern void rib_bulk_end (void);
 extern void rib_weed_tables (void);
 extern void rib_sweep_route (void);
 extern void rib_close (void);
@@ -336,6 +336,17 @@ kernel_ioctl_ipv4 (u_long cmd, struct prefix *p, struct rib *rib, int family)
   return ret;
 }
 
+/* Routes are written to the kernel as they come; nothing is held back. */
+void
+kernel_flush (void)
+{
+}
+
+void
+kernel_drain (void)
+{
+}
+
 int
 kernel_add_ipv4 (struct prefix *p, struct rib *rib)
 {
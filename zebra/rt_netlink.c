@@ -35,6 +35,7 @@
 #include "rib.h"
 #include "thread.h"
 #include "privs.h"
+#include "memory.h"
 
 #include "zebra/zserv.h"
 #include "zebra/rt.h"
@@ -49,8 +50,18 @@ struct nlsock
   int seq;
   struct sockaddr_nl snl;
   const char *name;
-} netlink      = { -1, 0, {0}, "netlink-listen"},     /* kernel messages */
-  netlink_cmd  = { -1, 0, {0}, "netlink-cmd"};        /* command channel */
+  char *buf;                    /* receive buffer, see netlink_parse_info */
+  size_t bufsiz;
+} netlink      = { -1, 0, {0}, "netlink-listen", NULL, 0}, /* kernel messages */
+  netlink_cmd  = { -1, 0, {0}, "netlink-cmd", NULL, 0};    /* command channel */
+
+/* Initial receive buffer size.  The kernel fills dump datagrams up to
+   the size of the reader's buffer, capped at 32K. */
+#define NL_RCV_BUF_SIZE    32768
+
+/* Messages handed to a filter by netlink_parse_info, for the startup
+   timing log. */
+static unsigned long netlink_parse_count;
 
 struct message nlmsg_str[] = {
   {RTM_NEWROUTE, "RTM_NEWROUTE"},
@@ -86,6 +97,40 @@ extern struct zebra_privs_t zserv_privs;
 
 extern u_int32_t nl_rcvbufsize;
 
+/* Route messages are not sent one by one with a wait for each ACK.
+   netlink_route_multipath() packs them into netlink_batch, which goes
+   out in one sendmsg() when it fills up or from a zero-delay event once
+   the RIB work queue yields.  The kernel's ACKs are read as they
+   arrive and matched to the route by sequence number; anything else
+   on netlink_cmd first drains the batch, so its replies are its own. */
+#define NL_BATCH_SIZE      32768
+#define NL_BATCH_INFLIGHT  1024
+
+struct nl_batch_pending
+{
+  u_int32_t seq;
+  int cmd;			/* 0 if the slot is free */
+  struct prefix p;
+  u_int32_t fib_gen;		/* rib->fib_gen of an RTM_NEWROUTE */
+};
+
+static struct
+{
+  /* Messages queued, not yet sent. */
+  char buf[NL_BATCH_SIZE];
+  size_t len;
+  unsigned int msgs;
+
+  /* Messages queued or sent, not yet acknowledged, by seq % INFLIGHT. */
+  struct nl_batch_pending pending[NL_BATCH_INFLIGHT];
+  unsigned int inflight;
+
+  struct thread *t_flush;
+  struct thread *t_read;
+} netlink_batch;
+
+static int netlink_batch_drain (void);
+
 /* Note: on netlink systems, there should be a 1-to-1 mapping between interface
    names and ifindex values. */
 static void
@@ -279,6 +324,9 @@ netlink_request (int family, int type, struct nlsock *nl)
       return -1;
     }
 
+  if (nl == &netlink_cmd)
+    netlink_batch_drain ();
+
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
@@ -326,10 +374,15 @@ netlink_parse_info (int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
   int ret = 0;
   int error;
 
+  if (nl->buf == NULL)
+    {
+      nl->bufsiz = NL_RCV_BUF_SIZE;
+      nl->buf = XMALLOC (MTYPE_TMP, nl->bufsiz);
+    }
+
   while (1)
     {
-      char buf[4096];
-      struct iovec iov = { buf, sizeof buf };
+      struct iovec iov = { nl->buf, 0 };
       struct sockaddr_nl snl;
       struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
       struct nlmsghdr *h;
@@ -338,7 +391,22 @@ netlink_parse_info (int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
       if (zserv_privs.change (ZPRIVS_RAISE))
         zlog (NULL, LOG_ERR, "Can't raise privileges");
 
-      status = recvmsg (nl->sock, &msg, 0);
+      /* Peek at the datagram length first and grow the buffer to fit,
+         so a large dump reply is never truncated. */
+      status = recvmsg (nl->sock, &msg, MSG_PEEK | MSG_TRUNC);
+      if (status > 0 && (size_t) status > nl->bufsiz)
+        {
+          nl->bufsiz = status;
+          nl->buf = XREALLOC (MTYPE_TMP, nl->buf, nl->bufsiz);
+        }
+      if (status >= 0)
+        {
+          iov.iov_base = nl->buf;
+          iov.iov_len = nl->bufsiz;
+          msg.msg_namelen = sizeof snl;
+          msg.msg_flags = 0;
+          status = recvmsg (nl->sock, &msg, 0);
+        }
       save_errno = errno;
 
       if (zserv_privs.change (ZPRIVS_LOWER))
@@ -375,7 +443,8 @@ netlink_parse_info (int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
           continue;
         }
 
-      for (h = (struct nlmsghdr *) buf; NLMSG_OK (h, (unsigned int) status);
+      for (h = (struct nlmsghdr *) nl->buf;
+           NLMSG_OK (h, (unsigned int) status);
            h = NLMSG_NEXT (h, status))
         {
           /* Finish of reading. */
@@ -454,6 +523,7 @@ netlink_parse_info (int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
               continue;
             }
 
+          netlink_parse_count++;
           error = (*filter) (&snl, h);
           if (error < 0)
             {
@@ -708,13 +778,15 @@ netlink_interface_addr (struct sockaddr_nl *snl, struct nlmsghdr *h)
   return 0;
 }
 
-/* Looking up routing table by netlink interface. */
+/* Looking up routing table by netlink interface.  Called once per
+   route of the startup dump, so only the attributes used are picked
+   out, after the cheap header checks. */
 int
 netlink_routing_table (struct sockaddr_nl *snl, struct nlmsghdr *h)
 {
   int len;
   struct rtmsg *rtm;
-  struct rtattr *tb[RTA_MAX + 1];
+  struct rtattr *rta;
   u_char flags = 0;
 
   char anyaddr[16] = { 0 };
@@ -743,9 +815,6 @@ netlink_routing_table (struct sockaddr_nl *snl, struct nlmsghdr *h)
   if (len < 0)
     return -1;
 
-  memset (tb, 0, sizeof tb);
-  netlink_parse_rtattr (tb, RTA_MAX, RTM_RTA (rtm), len);
-
   if (rtm->rtm_flags & RTM_F_CLONED)
     return 0;
   if (rtm->rtm_protocol == RTPROT_REDIRECT)
@@ -762,23 +831,26 @@ netlink_routing_table (struct sockaddr_nl *snl, struct nlmsghdr *h)
 
   index = 0;
   metric = 0;
-  dest = NULL;
+  dest = anyaddr;
   gate = NULL;
 
-  if (tb[RTA_OIF])
-    index = *(int *) RTA_DATA (tb[RTA_OIF]);
-
-  if (tb[RTA_DST])
-    dest = RTA_DATA (tb[RTA_DST]);
-  else
-    dest = anyaddr;
-
   /* Multipath treatment is needed. */
-  if (tb[RTA_GATEWAY])
-    gate = RTA_DATA (tb[RTA_GATEWAY]);
-
-  if (tb[RTA_PRIORITY])
-    metric = *(int *) RTA_DATA(tb[RTA_PRIORITY]);
+  for (rta = RTM_RTA (rtm); RTA_OK (rta, len); rta = RTA_NEXT (rta, len))
+    switch (rta->rta_type)
+      {
+      case RTA_OIF:
+        index = *(int *) RTA_DATA (rta);
+        break;
+      case RTA_DST:
+        dest = RTA_DATA (rta);
+        break;
+      case RTA_GATEWAY:
+        gate = RTA_DATA (rta);
+        break;
+      case RTA_PRIORITY:
+        metric = *(int *) RTA_DATA (rta);
+        break;
+      }
 
   if (rtm->rtm_family == AF_INET)
     {
@@ -1088,6 +1160,22 @@ netlink_information_fetch (struct sockaddr_nl *snl, struct nlmsghdr *h)
   return 0;
 }
 
+/* Log how long one of the startup dumps took. */
+static void
+netlink_dump_log (const char *what, struct timeval *start,
+                  unsigned long count)
+{
+  struct timeval now;
+  long msec;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  msec = (now.tv_sec - start->tv_sec) * 1000
+         + (now.tv_usec - start->tv_usec) / 1000;
+
+  zlog_info ("%s: read %lu messages in %ld.%03ld seconds",
+             what, netlink_parse_count - count, msec / 1000, msec % 1000);
+}
+
 /* Interface lookup by netlink socket. */
 int
 interface_lookup_netlink (void)
@@ -1095,6 +1183,11 @@ interface_lookup_netlink (void)
   int ret;
   int flags;
   int snb_ret;
+  struct timeval start;
+  unsigned long count;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  count = netlink_parse_count;
 
   /* 
    * Change netlink socket flags to blocking to ensure we get 
@@ -1109,43 +1202,50 @@ interface_lookup_netlink (void)
   /* Get interface information. */
   ret = netlink_request (AF_PACKET, RTM_GETLINK, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
   ret = netlink_parse_info (netlink_interface, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
 
   /* Get IPv4 address of the interfaces. */
   ret = netlink_request (AF_INET, RTM_GETADDR, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
   ret = netlink_parse_info (netlink_interface_addr, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
 
 #ifdef HAVE_IPV6
   /* Get IPv6 address of the interfaces. */
   ret = netlink_request (AF_INET6, RTM_GETADDR, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
   ret = netlink_parse_info (netlink_interface_addr, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
 #endif /* HAVE_IPV6 */
 
+ out:
   /* restore socket flags */
   if (snb_ret == 0)
     set_netlink_nonblocking (&netlink_cmd, &flags);
-  return 0;
+  netlink_dump_log ("interface dump", &start, count);
+  return ret;
 }
 
 /* Routing table read function using netlink interface.  Only called
-   bootstrap time. */
+   bootstrap time.  The dumped routes are inserted as one RIB bulk. */
 int
 netlink_route_read (void)
 {
   int ret;
   int flags;
   int snb_ret;
+  struct timeval start;
+  unsigned long count;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  count = netlink_parse_count;
 
   /* 
    * Change netlink socket flags to blocking to ensure we get 
@@ -1157,28 +1257,34 @@ netlink_route_read (void)
           "%s:%i Warning: Could not set netlink socket to blocking.",
           __FUNCTION__, __LINE__);
 
+  rib_bulk_begin ();
+
   /* Get IPv4 routing table. */
   ret = netlink_request (AF_INET, RTM_GETROUTE, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
   ret = netlink_parse_info (netlink_routing_table, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
 
 #ifdef HAVE_IPV6
   /* Get IPv6 routing table. */
   ret = netlink_request (AF_INET6, RTM_GETROUTE, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
   ret = netlink_parse_info (netlink_routing_table, &netlink_cmd);
   if (ret < 0)
-    return ret;
+    goto out;
 #endif /* HAVE_IPV6 */
 
+ out:
+  rib_bulk_end ();
+
   /* restore flags */
   if (snb_ret == 0)
     set_netlink_nonblocking (&netlink_cmd, &flags);
-  return 0;
+  netlink_dump_log ("route dump", &start, count);
+  return ret;
 }
 
 /* Utility function  comes from iproute2. 
@@ -1267,6 +1373,9 @@ netlink_talk (struct nlmsghdr *n, struct nlsock *nl)
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
+  if (nl == &netlink_cmd)
+    netlink_batch_drain ();
+
   n->nlmsg_seq = ++nl->seq;
 
   /* Request an acknowledgement by setting NLM_F_ACK */
@@ -1315,6 +1424,301 @@ netlink_talk (struct nlmsghdr *n, struct nlsock *nl)
   return status;
 }
 
+/* Log a kernel error for a route message, quietly for the errors a
+   route whose interface just went away is expected to produce. */
+static void
+netlink_route_error (struct nlsock *nl, struct nlmsgerr *err)
+{
+  int loglvl = LOG_ERR;
+  int errnum = err->error;
+  int msg_type = err->msg.nlmsg_type;
+
+  if (-errnum == ENODEV || -errnum == ESRCH)
+    loglvl = LOG_DEBUG;
+
+  zlog (NULL, loglvl, "%s error: %s, type=%s(%u), seq=%u, pid=%u",
+        nl->name, safe_strerror (-errnum), lookup (nlmsg_str, msg_type),
+        msg_type, err->msg.nlmsg_seq, err->msg.nlmsg_pid);
+}
+
+/* A batched message is done with, successfully if error is 0. */
+static void
+netlink_batch_complete (struct nl_batch_pending *pend, int error)
+{
+  if (error && pend->cmd == RTM_NEWROUTE)
+    rib_install_kernel_failed (&pend->p, pend->fib_gen);
+  else if (error)
+    rib_fib_stats.failures++;
+
+  pend->cmd = 0;
+  netlink_batch.inflight--;
+  rib_fib_stats.inflight = netlink_batch.inflight;
+}
+
+/* Forget every message in flight, e.g. after their ACKs were lost. */
+static void
+netlink_batch_forget (void)
+{
+  int i;
+
+  for (i = 0; i < NL_BATCH_INFLIGHT; i++)
+    if (netlink_batch.pending[i].cmd)
+      netlink_batch_complete (&netlink_batch.pending[i], 0);
+}
+
+/* Read ACKs for batched messages until the socket has no more or
+   nothing is left in flight. */
+static int
+netlink_batch_recv (void)
+{
+  struct nl_batch_pending *pend;
+  struct nlmsgerr *err;
+  struct nlmsghdr *h;
+  int status;
+  int save_errno;
+
+  while (netlink_batch.inflight > 0)
+    {
+      char buf[4096];
+      struct iovec iov = { buf, sizeof buf };
+      struct sockaddr_nl snl;
+      struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+
+      status = recvmsg (netlink_cmd.sock, &msg, 0);
+      save_errno = errno;
+
+      if (status < 0)
+        {
+          if (save_errno == EINTR)
+            continue;
+          if (save_errno == EWOULDBLOCK || save_errno == EAGAIN)
+            break;
+          zlog (NULL, LOG_ERR, "%s recvmsg overrun: %s",
+                netlink_cmd.name, safe_strerror (save_errno));
+          /* Acknowledgements may have been dropped; do not wait on them. */
+          netlink_batch_forget ();
+          return -1;
+        }
+      if (status == 0)
+        {
+          zlog (NULL, LOG_ERR, "%s EOF", netlink_cmd.name);
+          netlink_batch_forget ();
+          return -1;
+        }
+
+      for (h = (struct nlmsghdr *) buf; NLMSG_OK (h, (unsigned int) status);
+           h = NLMSG_NEXT (h, status))
+        {
+          if (h->nlmsg_type != NLMSG_ERROR
+              || h->nlmsg_len < NLMSG_LENGTH (sizeof (struct nlmsgerr)))
+            {
+              if (IS_ZEBRA_DEBUG_KERNEL)
+                zlog_debug ("netlink_batch_recv: ignoring message type %s(%u)",
+                            lookup (nlmsg_str, h->nlmsg_type), h->nlmsg_type);
+              continue;
+            }
+
+          err = (struct nlmsgerr *) NLMSG_DATA (h);
+          pend = &netlink_batch.pending[err->msg.nlmsg_seq % NL_BATCH_INFLIGHT];
+          if (pend->cmd == 0 || pend->seq != err->msg.nlmsg_seq)
+            {
+              zlog_warn ("netlink_batch_recv: unexpected ACK, seq=%u",
+                         err->msg.nlmsg_seq);
+              continue;
+            }
+
+          if (err->error)
+            netlink_route_error (&netlink_cmd, err);
+          else if (IS_ZEBRA_DEBUG_KERNEL)
+            zlog_debug ("netlink_batch_recv: %s ACK: type=%s(%u), seq=%u",
+                        netlink_cmd.name,
+                        lookup (nlmsg_str, err->msg.nlmsg_type),
+                        err->msg.nlmsg_type, err->msg.nlmsg_seq);
+
+          netlink_batch_complete (pend, err->error);
+        }
+    }
+
+  return 0;
+}
+
+static int
+netlink_batch_read (struct thread *thread)
+{
+  netlink_batch.t_read = NULL;
+
+  netlink_batch_recv ();
+
+  if (netlink_batch.inflight > 0)
+    netlink_batch.t_read =
+      thread_add_read (zebrad.master, netlink_batch_read, NULL,
+                       netlink_cmd.sock);
+  return 0;
+}
+
+/* Send whatever is queued in one sendmsg(). */
+static int
+netlink_batch_flush (void)
+{
+  struct sockaddr_nl snl;
+  struct iovec iov = { (void *) netlink_batch.buf, netlink_batch.len };
+  struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+  struct nlmsghdr *h;
+  int status;
+  int save_errno;
+  size_t off, len;
+
+  if (netlink_batch.t_flush)
+    {
+      thread_cancel (netlink_batch.t_flush);
+      netlink_batch.t_flush = NULL;
+    }
+  if (netlink_batch.msgs == 0)
+    return 0;
+
+  memset (&snl, 0, sizeof snl);
+  snl.nl_family = AF_NETLINK;
+
+  if (IS_ZEBRA_DEBUG_KERNEL)
+    zlog_debug ("netlink_batch_flush: %s %u messages, %lu bytes",
+                netlink_cmd.name, netlink_batch.msgs,
+                (unsigned long) netlink_batch.len);
+
+  if (zserv_privs.change (ZPRIVS_RAISE))
+    zlog (NULL, LOG_ERR, "Can't raise privileges");
+  do
+    status = sendmsg (netlink_cmd.sock, &msg, 0);
+  while (status < 0 && errno == EINTR);
+  save_errno = errno;
+  if (zserv_privs.change (ZPRIVS_LOWER))
+    zlog (NULL, LOG_ERR, "Can't lower privileges");
+
+  rib_fib_stats.batches++;
+  len = netlink_batch.len;
+  netlink_batch.len = 0;
+  netlink_batch.msgs = 0;
+
+  if (status < 0)
+    {
+      zlog (NULL, LOG_ERR, "netlink_batch_flush sendmsg() error: %s",
+            safe_strerror (save_errno));
+
+      /* None of them reached the kernel. */
+      for (off = 0; off < len; off += NLMSG_ALIGN (h->nlmsg_len))
+        {
+          struct nl_batch_pending *pend;
+
+          h = (struct nlmsghdr *) (netlink_batch.buf + off);
+          pend = &netlink_batch.pending[h->nlmsg_seq % NL_BATCH_INFLIGHT];
+          if (pend->cmd && pend->seq == h->nlmsg_seq)
+            netlink_batch_complete (pend, -save_errno);
+        }
+      return -1;
+    }
+
+  if (netlink_batch.t_read == NULL)
+    netlink_batch.t_read =
+      thread_add_read (zebrad.master, netlink_batch_read, NULL,
+                       netlink_cmd.sock);
+  return 0;
+}
+
+static int
+netlink_batch_timer (struct thread *thread)
+{
+  netlink_batch.t_flush = NULL;
+  netlink_batch_flush ();
+  return 0;
+}
+
+/* Send what is queued and wait for every ACK still outstanding. */
+static int
+netlink_batch_drain (void)
+{
+  int flags = 0;
+  int ret = 0;
+
+  netlink_batch_flush ();
+  if (netlink_batch.inflight == 0)
+    return 0;
+
+  if (set_netlink_blocking (&netlink_cmd, &flags) < 0)
+    {
+      netlink_batch_forget ();
+      return -1;
+    }
+  while (netlink_batch.inflight > 0 && ret == 0)
+    ret = netlink_batch_recv ();
+  set_netlink_nonblocking (&netlink_cmd, &flags);
+
+  if (netlink_batch.t_read)
+    {
+      thread_cancel (netlink_batch.t_read);
+      netlink_batch.t_read = NULL;
+    }
+  return ret;
+}
+
+/* Queue a route message for the kernel. */
+static int
+netlink_batch_add (struct nlmsghdr *n, struct prefix *p, struct rib *rib)
+{
+  struct nl_batch_pending *pend;
+  size_t len = NLMSG_ALIGN (n->nlmsg_len);
+
+  /* Keep what is in flight, queued messages included, within what the
+     pending table can match. */
+  if (netlink_batch.inflight >= NL_BATCH_INFLIGHT)
+    netlink_batch_drain ();
+  if (netlink_batch.len + len > sizeof (netlink_batch.buf))
+    netlink_batch_flush ();
+
+  n->nlmsg_seq = ++netlink_cmd.seq;
+  n->nlmsg_flags |= NLM_F_ACK;
+
+  if (IS_ZEBRA_DEBUG_KERNEL)
+    zlog_debug ("netlink_batch_add: %s type %s(%u), seq=%u", netlink_cmd.name,
+                lookup (nlmsg_str, n->nlmsg_type), n->nlmsg_type,
+                n->nlmsg_seq);
+
+  memcpy (netlink_batch.buf + netlink_batch.len, n, n->nlmsg_len);
+  memset (netlink_batch.buf + netlink_batch.len + n->nlmsg_len, 0,
+          len - n->nlmsg_len);
+  netlink_batch.len += len;
+  netlink_batch.msgs++;
+
+  pend = &netlink_batch.pending[n->nlmsg_seq % NL_BATCH_INFLIGHT];
+  pend->seq = n->nlmsg_seq;
+  pend->cmd = n->nlmsg_type;
+  prefix_copy (&pend->p, p);
+  pend->fib_gen = rib->fib_gen;
+  netlink_batch.inflight++;
+  rib_fib_stats.inflight = netlink_batch.inflight;
+  if (netlink_batch.inflight > rib_fib_stats.inflight_max)
+    rib_fib_stats.inflight_max = netlink_batch.inflight;
+
+  if (netlink_batch.t_flush == NULL)
+    netlink_batch.t_flush =
+      thread_add_event (zebrad.master, netlink_batch_timer, NULL, 0);
+  return 0;
+}
+
+/* Send the route messages queued so far, e.g. at the end of a RIB
+   work queue run. */
+void
+kernel_flush (void)
+{
+  netlink_batch_flush ();
+}
+
+/* Send the route messages queued so far and wait for the kernel's
+   answers, e.g. before exiting. */
+void
+kernel_drain (void)
+{
+  netlink_batch_drain ();
+}
+
 /* Routing table change via netlink interface. */
 int
 netlink_route (int cmd, int family, void *dest, int length, void *gate,
@@ -1396,7 +1800,6 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib,
                          int family)
 {
   int bytelen;
-  struct sockaddr_nl snl;
   struct nexthop *nexthop = NULL;
   int nexthop_num = 0;
   int discard;
@@ -1762,12 +2165,8 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib,
 
 skip:
 
-  /* Destination netlink address. */
-  memset (&snl, 0, sizeof snl);
-  snl.nl_family = AF_NETLINK;
-
-  /* Talk to netlink socket. */
-  return netlink_talk (&req.n, &netlink_cmd);
+  /* Queue it; errors come back asynchronously. */
+  return netlink_batch_add (&req.n, p, rib);
 }
 
 int
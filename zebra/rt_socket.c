@@ -184,6 +184,17 @@ kernel_rtm_ipv4 (int cmd, struct prefix *p, struct rib *rib, int family)
   return 0; /*XXX*/
 }
 
+/* Routes are written to the kernel as they come; nothing is held back. */
+void
+kernel_flush (void)
+{
+}
+
+void
+kernel_drain (void)
+{
+}
+
 int
 kernel_add_ipv4 (struct prefix *p, struct rib *rib)
 {
@@ -315,8 +315,6 @@ extern "C" {
 			struct zlistnode             * cnode, *cnnode;
 			struct connected             * c;
 			void                         * data;
-			uint32_t                       key;
-			char                           t_name[7];
 
 			TELinks = lrm_tel_proxy->getFromAdjType(adjacencyType);
 
@@ -324,10 +322,7 @@ extern "C" {
 				   TELinks->length());
 
 			for (size_t i = 0; i < TELinks->length(); i++) {
-				/* Create fake interface */
-				key = TELinks[i].parms.telkey;
-				sprintf(t_name, "tel%d", key);
-				ifp = if_create(t_name, strlen(t_name));
+				ifp = tel_get(TELinks[i].parms.telkey);
 
 				telinksdata2if(TELinks[i], ifp);
 
@@ -344,10 +339,6 @@ extern "C" {
 								ifp,
 								c);
 				}
-				/* Delete fake interface */
-				list_delete (ifp->connected);
-				XFREE (MTYPE_IF, ifp);
-				ifp = 0;
 			}
 		} catch (CORBA::SystemException & e) {
 			zlog_err("Cannot get TE Links from LRM: "
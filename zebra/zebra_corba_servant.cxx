@@ -48,6 +48,37 @@ ZEBRA_i::~ZEBRA_i()
 {
 }
 
+/* Check OSPF is registered */
+static void
+tel_check_clients(const char * what)
+{
+	if (list_isempty(zebrad.client_list)) {
+		zlog_err("OSPF not yet registered. Cannot %s TE-link", what);
+		throw std::runtime_error("OSPF not registered");
+	}
+}
+
+/* Send one TE-link attribute update to every client */
+static void
+tel_send_update(struct interface * ifp,
+		int                type)
+{
+	struct zlistnode * clnode, * clnnode;
+	struct zserv     * client;
+	void             * datal;
+
+	zlog_debug("Going to send TE-link update to OSPF");
+
+	for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
+		client = (struct zserv*) datal;
+		if (zsend_te_interface_update(client, ifp, type) < 0) {
+			zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
+				 "to OSPF");
+			throw std::runtime_error("zclient/zserv error");
+		}
+	}
+}
+
 void
 ZEBRA_i::add(Types::uint32                  telKey,
 	     const gmplsTypes::TELinkData& telData)
@@ -58,21 +89,12 @@ ZEBRA_i::add(Types::uint32                  telKey,
 		struct connected             * c;
 		struct zserv                 * client;
 		void                         * data, * datal;
-		uint32_t                       key;
-		char                           t_name[7];
 
 		zlog_debug("Received TE-link add from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot add TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
+		tel_check_clients("add");
 
-		/* Create fake interface */
-		key = telData.parms.telkey;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		ifp = tel_get(telData.parms.telkey);
 
 		zlog_debug("\n\n\n LOC TEL %x \n\n\n", (uint32_t) telData.localId.ipv4());
 		zlog_debug("\n\n\n REM TEL %x \n\n\n", (uint32_t) telData.remoteId.ipv4());
@@ -99,11 +121,6 @@ ZEBRA_i::add(Types::uint32                  telKey,
 			}
 		}
 
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
-
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot add Te-link from LRM: %s", e.what());
 		throw ZEBRA::TeLink::InternalProblems();
@@ -124,29 +141,23 @@ ZEBRA_i::del(Types::uint32 telKey)
 		struct zlistnode             * clnode, *clnnode;
 		struct zserv                 * client;
 		void                         * datal;
-		uint32_t                       key;
-		char                           t_name[7];
 
 		zlog_debug("Received TE-link delete from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot delete TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
+		tel_check_clients("delete");
 
-		/* Create fake interface */
-		key = telKey;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		ifp = tel_lookup(telKey);
+		if (ifp == 0) {
+			/* Not learnt from LRM: let clients drop it anyway */
+			ifp = tel_get(telKey);
 
-		ifp->ifindex   = key;
-		ifp->flags     = 4163; //IFF_UP and IFF_RUNNING should be enough
-		ifp->mtu       = 65536;
-		ifp->mtu6      = 65536;
-		ifp->metric    = 1;
-		ifp->status    = ZEBRA_INTERFACE_ACTIVE;
-		ifp->bandwidth = 0;
+			ifp->flags     = 4163; //IFF_UP and IFF_RUNNING should be enough
+			ifp->mtu       = 65536;
+			ifp->mtu6      = 65536;
+			ifp->metric    = 1;
+			ifp->status    = ZEBRA_INTERFACE_ACTIVE;
+			ifp->bandwidth = 0;
+		}
 
 		zlog_debug("Going to send TE-link delete to OSPF");
 
@@ -159,10 +170,8 @@ ZEBRA_i::del(Types::uint32 telKey)
 				throw std::runtime_error("zclient/zserv error");
 			}
 		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+
+		tel_release(telKey);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot delete Te-link from LRM: %s", e.what());
@@ -182,44 +191,21 @@ ZEBRA_i::updateMetric(Types::uint32 telKey,
 {
 	try {
 		struct interface *             ifp;
-		struct zlistnode             * clnode, *clnnode;
-		struct zserv                 * client;
-		void                         * datal;
-		uint32_t                       key;
-		uint32_t                       tem;
-		char                           t_name[7];
 
 		zlog_debug("Received TE-link updateMetric from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot update TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
-
-		/* Create fake interface */
-		key = telKey;
-		tem = metric;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		tel_check_clients("update");
 
-		ifp->te_metric = tem;
+		ifp = tel_lookup(telKey);
+		if (ifp && ifp->te_metric == metric) {
+			zlog_debug("TE-link %u metric unchanged", telKey);
+			return;
+		}
 
-		zlog_debug("Going to send TE-link update to OSPF");
+		ifp = tel_get(telKey);
+		ifp->te_metric = metric;
 
-		/* Retrieve OSPF client structure */
-		for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-			client = (struct zserv*) datal;
-			if (zsend_te_interface_update(client, ifp, METRIC_UPDATE) < 0) {
-				zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-					 "to OSPF");
-				throw std::runtime_error("zclient/zserv error");
-			}
-		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+		tel_send_update(ifp, METRIC_UPDATE);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -240,44 +226,21 @@ ZEBRA_i::updateColor(Types::uint32 telKey,
 {
 	try {
 		struct interface *             ifp;
-		struct zlistnode             * clnode, *clnnode;
-		struct zserv                 * client;
-		void                         * datal;
-		uint32_t                       key;
-		uint32_t                       color;
-		char                           t_name[7];
 
 		zlog_debug("Received TE-link updateColor from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot update TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
+		tel_check_clients("update");
 
-		/* Create fake interface */
-		key = telKey;
-		color = colorMask;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		ifp = tel_lookup(telKey);
+		if (ifp && ifp->te_link_color == colorMask) {
+			zlog_debug("TE-link %u color unchanged", telKey);
+			return;
+		}
 
-		ifp->te_link_color = color;
+		ifp = tel_get(telKey);
+		ifp->te_link_color = colorMask;
 
-		zlog_debug("Going to send TE-link update to OSPF");
-
-		/* Retrieve OSPF client structure */
-		for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-			client = (struct zserv*) datal;
-			if (zsend_te_interface_update(client, ifp, LINK_CLR_UPDATE) < 0) {
-				zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-					 "to OSPF");
-				throw std::runtime_error("zclient/zserv error");
-			}
-		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+		tel_send_update(ifp, LINK_CLR_UPDATE);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -301,25 +264,33 @@ ZEBRA_i::updateBw(Types::uint32                              telKey,
 {
 	try {
 		struct interface *             ifp;
-		struct zlistnode             * clnode, *clnnode;
-		struct zserv                 * client;
-		void                         * datal;
-		uint32_t                       key;
-		sw_cap_t                       swcap;
-		char                           t_name[7];
+		bool                           same;
 
 		zlog_debug("Received TE-link updateBw from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot update TE-link");
-			throw std::runtime_error("OSPF not registered");
+		tel_check_clients("update");
+
+		ifp = tel_lookup(telKey);
+		if (ifp) {
+			same = adv_rsrv_calendar_same(calendar,
+						      ifp->adv_rsrv_calendar);
+			for (int i = 0; same && i < MAX_BW_PRIORITIES; i++) {
+				same = (ifp->te_avail_bw_per_prio[i] == availBw[i] &&
+					ifp->te_max_LSP_bw[i] == maxLspBw[i]);
+			}
+			if (same && lambdaBit.bitmap.length() > 0) {
+				same = (ifp->te_swcap == SWCAP_LSC &&
+					lambdas_bitmap_same(lambdaBit,
+							    ifp->lambdas_bitmap));
+			}
+			if (same) {
+				zlog_debug("TE-link %u bandwidth unchanged",
+					   telKey);
+				return;
+			}
 		}
 
-		/* Create fake interface */
-		key = telKey;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		ifp = tel_get(telKey);
 
 		for (int i = 0; i < MAX_BW_PRIORITIES; i++) {
 			ifp->te_avail_bw_per_prio[i] = availBw[i];
@@ -337,21 +308,7 @@ ZEBRA_i::updateBw(Types::uint32                              telKey,
 					    ifp->lambdas_bitmap);
 		}
 
-		zlog_debug("Going to send TE-link update to OSPF");
-
-		/* Retrieve OSPF client structure */
-		for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-			client = (struct zserv*) datal;
-			if (zsend_te_interface_update(client, ifp, BW_UPDATE) < 0) {
-				zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-					 "to OSPF");
-				throw std::runtime_error("zclient/zserv error");
-			}
-		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+		tel_send_update(ifp, BW_UPDATE);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -382,54 +339,28 @@ ZEBRA_i::updateSrlg(Types::uint32               telKey,
 {
 	try {
 		struct interface *             ifp;
-		struct zlistnode             * clnode, *clnnode;
-		struct zserv                 * client;
-		void                         * datal;
-		uint32_t                       key;
 		uint32_t *                     new_data;
-		char                           t_name[7];
 
 		zlog_debug("Received TE-link updateSrlg from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot update TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
-
-		/* Create fake interface */
-		key = telKey;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		tel_check_clients("update");
 
-		if (ifp->te_SRLG_ids != NULL) {
-			list_delete_all_node(ifp->te_SRLG_ids);
-		} else {
-			ifp->te_SRLG_ids = list_new();
-			//ifp->te_SRLG_ids->del = del_te_SRLG_id;
+		ifp = tel_lookup(telKey);
+		if (ifp && srlg_same(srlg, ifp->te_SRLG_ids)) {
+			zlog_debug("TE-link %u SRLGs unchanged", telKey);
+			return;
 		}
 
+		ifp = tel_get(telKey);
+
+		list_delete_all_node(ifp->te_SRLG_ids);
 		for (int j = 0; j < srlg.length(); j++) {
 			new_data = (uint32_t *)malloc(sizeof(uint32_t));
 			*new_data = srlg[j];
 			listnode_add(ifp->te_SRLG_ids, new_data);
 		}
 
-		zlog_debug("Going to send TE-link update to OSPF");
-
-		/* Retrieve OSPF client structure */
-		for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-			client = (struct zserv*) datal;
-			if (zsend_te_interface_update(client, ifp, SRLGid_UPDATE) < 0) {
-				zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-					 "to OSPF");
-				throw std::runtime_error("zclient/zserv error");
-			}
-		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+		tel_send_update(ifp, SRLGid_UPDATE);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -449,70 +380,26 @@ ZEBRA_i::updateTna(Types::uint32             telKey,
 {
 	try {
 		struct interface *             ifp;
-		struct zlistnode             * clnode, *clnnode;
-		struct zserv                 * client;
-		void                         * datal;
-		uint32_t                       key;
 		g2mpls_addr_t                  tna;
 		gmplsTypes::tnaId_var         tnaTmp;
-		char                           t_name[7];
 
-		zlog_debug("Received TE-link updateMteric from LRM");
+		zlog_debug("Received TE-link updateTna from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot update TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
-
-		/* Create fake interface */
-		key = telKey;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
-
-		/* zeroing */
-		ifp->te_TNA_address_type  = IPv4;
-		ifp->te_TNA_prefix_length = 0;
-		ifp->te_TNA_address = (u_int32_t *) malloc(4);
-		memset(ifp->te_TNA_address, 0, 4);
+		tel_check_clients("update");
 
 		tnaTmp = tnaId;
 		tna << tnaTmp;
 
-		ifp->te_TNA_address_type  = tna.type;
-		ifp->te_TNA_prefix_length = 32;
-		switch (ifp->te_TNA_address_type) {
-			case IPv4:
-				ifp->te_TNA_address = (u_int32_t *) malloc(4);
-				memcpy(ifp->te_TNA_address , &tna.value.ipv4, 4);
-				break;
-			case IPv6:
-				ifp->te_TNA_address = (u_int32_t *) malloc(16);
-				memcpy(ifp->te_TNA_address , &tna.value.ipv6, 16);
-				break;
-			case NSAP:
-				ifp->te_TNA_address = (u_int32_t *) malloc(20);
-				memcpy(ifp->te_TNA_address , &tna.value.nsap, 20);
-				break;
-			default:
-				throw std::runtime_error("Bad TNA type");
+		ifp = tel_lookup(telKey);
+		if (ifp && tel_tna_same(ifp, tna)) {
+			zlog_debug("TE-link %u TNA unchanged", telKey);
+			return;
 		}
 
-		zlog_debug("Going to send TE-link update to OSPF");
+		ifp = tel_get(telKey);
+		tel_set_tna(ifp, &tna);
 
-		/* Retrieve OSPF client structure */
-		for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-			client = (struct zserv*) datal;
-			if (zsend_te_interface_update(client, ifp, TNA_UPDATE) < 0) {
-				zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-					 "to OSPF");
-				throw std::runtime_error("zclient/zserv error");
-			}
-		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+		tel_send_update(ifp, TNA_UPDATE);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -533,44 +420,24 @@ ZEBRA_i::updateProtection(Types::uint32         telKey,
 {
 	try {
 		struct interface *             ifp;
-		struct zlistnode             * clnode, *clnnode;
-		struct zserv                 * client;
-		void                         * datal;
-		uint32_t                       key;
 		gmpls_prottype_t               protection;
-		char                           t_name[7];
-
-		zlog_debug("Received TE-link updateMteric from LRM");
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot update TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
+		zlog_debug("Received TE-link updateProtection from LRM");
 
-		/* Create fake interface */
-		key = telKey;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		tel_check_clients("update");
 
 		protection << prot;
-		ifp->te_protection_type = (u_int8_t) protection;
-
-		zlog_debug("Going to send TE-link update to OSPF");
 
-		/* Retrieve OSPF client structure */
-		for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-			client = (struct zserv*) datal;
-			if (zsend_te_interface_update(client, ifp, PROTECTION_UPDATE) < 0) {
-				zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-					 "to OSPF");
-				throw std::runtime_error("zclient/zserv error");
-			}
+		ifp = tel_lookup(telKey);
+		if (ifp && ifp->te_protection_type == (u_int8_t) protection) {
+			zlog_debug("TE-link %u protection unchanged", telKey);
+			return;
 		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+
+		ifp = tel_get(telKey);
+		ifp->te_protection_type = (u_int8_t) protection;
+
+		tel_send_update(ifp, PROTECTION_UPDATE);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -590,42 +457,22 @@ ZEBRA_i::updatePower(Types::uint32         telKey,
 {
     try {
 	    struct interface *             ifp;
-	    struct zlistnode             * clnode, *clnnode;
-	    struct zserv                 * client;
-	    void                         * datal;
-	    uint32_t                       key;
-	    char                           t_name[7];
 
 	    zlog_debug("Received TE-link updatePower from LRM");
 
-	    /* Check OSPF is registered */
-	    if (list_isempty(zebrad.client_list)) {
-		    zlog_err("OSPF not yet registered. Cannot update TE-link");
-		    throw std::runtime_error("OSPF not registered");
-	    }
+	    tel_check_clients("update");
 
-	    /* Create fake interface */
-	    key = telKey;
-	    sprintf(t_name, "tel%d", key);
-	    ifp = if_create(t_name, strlen(t_name));
+	    ifp = tel_lookup(telKey);
+	    if (ifp && ifp->te_energy_consumption == powerConsumption) {
+		    zlog_debug("TE-link %u power consumption unchanged",
+			       telKey);
+		    return;
+	    }
 
+	    ifp = tel_get(telKey);
 	    ifp->te_energy_consumption = powerConsumption;
 
-	    zlog_debug("Going to send TE-link update to OSPF");
-
-	    /* Retrieve OSPF client structure */
-	    for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-		    client = (struct zserv*) datal;
-		    if (zsend_te_interface_update(client, ifp, ENERGY_UPDATE) < 0) {
-			    zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-				     "to OSPF");
-			    throw std::runtime_error("zclient/zserv error");
-		    }
-	    }
-	    /* Delete fake interface */
-	    list_delete (ifp->connected);
-	    XFREE (MTYPE_IF, ifp);
-	    ifp = 0;
+	    tel_send_update(ifp, ENERGY_UPDATE);
 
     } catch (std::runtime_error & e) {
 	    zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -645,44 +492,26 @@ ZEBRA_i::updateReplanningInfo(Types::uint32         telKey,
 {
     try {
 		struct interface *             ifp;
-		struct zlistnode             * clnode, *clnnode;
-		struct zserv                 * client;
-		void                         * datal;
-		uint32_t                       key;
-		char                           t_name[7];
 
 		zlog_debug("Received TE-link updateReplanningInfo from LRM downgrade: %d, upgrade: %d", 
 						replanInfo.maxBwDowngrade, replanInfo.maxBwUpgrade);
 
-		/* Check OSPF is registered */
-		if (list_isempty(zebrad.client_list)) {
-			zlog_err("OSPF not yet registered. Cannot update TE-link");
-			throw std::runtime_error("OSPF not registered");
-		}
+		tel_check_clients("update");
 
-		/* Create fake interface */
-		key = telKey;
-		sprintf(t_name, "tel%d", key);
-		ifp = if_create(t_name, strlen(t_name));
+		ifp = tel_lookup(telKey);
+		if (ifp &&
+		    ifp->te_max_bw_upgrade == replanInfo.maxBwUpgrade &&
+		    ifp->te_max_bw_downgrade == replanInfo.maxBwDowngrade) {
+			zlog_debug("TE-link %u replanning info unchanged",
+				   telKey);
+			return;
+		}
 
+		ifp = tel_get(telKey);
 		ifp->te_max_bw_upgrade = replanInfo.maxBwUpgrade;
 		ifp->te_max_bw_downgrade = replanInfo.maxBwDowngrade;
 
-		zlog_debug("Going to send TE-link update to OSPF");
-
-		/* Retrieve OSPF client structure */
-		for (ALL_LIST_ELEMENTS(zebrad.client_list, clnode, clnnode, datal)) {
-			client = (struct zserv*) datal;
-			if (zsend_te_interface_update(client, ifp, BW_REPLANNING_UPDATE) < 0) {
-				zlog_err("Cannot send ZEBRA_INTERFACE_UPDATE"
-					 "to OSPF");
-				throw std::runtime_error("zclient/zserv error");
-			}
-		}
-		/* Delete fake interface */
-		list_delete (ifp->connected);
-		XFREE (MTYPE_IF, ifp);
-		ifp = 0;
+		tel_send_update(ifp, BW_REPLANNING_UPDATE);
 
 	} catch (std::runtime_error & e) {
 		zlog_err("Cannot update Te-link from LRM: %s", e.what());
@@ -696,7 +525,6 @@ ZEBRA_i::updateReplanningInfo(Types::uint32         telKey,
 	}
 }
 
-
 ZEBRA_Node_i::ZEBRA_Node_i()
 {
 }
@@ -28,6 +28,8 @@
 #include "zebra.h"
 #include "log.h"
 #include "prefix.h"
+#include "hash.h"
+#include "memory.h"
 
 #include "g2mpls_corba_utils.h"
 
@@ -135,6 +137,8 @@ void telinksdata2if(const gmplsTypes::TELinkData & tel,
 	ifc->destination    = (struct prefix *) peer;
 	ifc->ifp            = ifp;
 
+	/* TE-links are kept across updates: replace the old address */
+	list_delete_all_node(ifp->connected);
 	listnode_add (ifp->connected, ifc);
 
 	/*now we send the te link TE params to ospf*/
@@ -217,12 +221,6 @@ void telinksdata2if(const gmplsTypes::TELinkData & tel,
 		listnode_add(ifp->te_SRLG_ids, new_data);
 	}
 
-	/* zeroing */
-	ifp->te_TNA_address_type  = IPv4;
-	ifp->te_TNA_prefix_length = 0;
-	ifp->te_TNA_address = (u_int32_t *) malloc(4);
-	memset(ifp->te_TNA_address, 0, 4);
-
 	gmplsTypes::tnaId_var tnaTmp;
 	tnaTmp = tel.parms.tna;
 
@@ -230,26 +228,245 @@ void telinksdata2if(const gmplsTypes::TELinkData & tel,
 
 	if ( ifp->adj_type == UNI  ||
 	     (ifp->adj_type == ENNI && !is_addr_null(tna))) {
-		ifp->te_TNA_address_type  = tna.type;
-		ifp->te_TNA_prefix_length = 32;
-		switch (ifp->te_TNA_address_type) {
-			case IPv4:
-				ifp->te_TNA_address = (u_int32_t *) malloc(4);
-				memcpy(ifp->te_TNA_address , &tna.value.ipv4, 4);
-				break;
-			case IPv6:
-				ifp->te_TNA_address = (u_int32_t *) malloc(16);
-				memcpy(ifp->te_TNA_address , &tna.value.ipv6, 16);
-				break;
-			case NSAP:
-				ifp->te_TNA_address = (u_int32_t *) malloc(20);
-				memcpy(ifp->te_TNA_address , &tna.value.nsap, 20);
-				break;
-			default:
-				throw std::runtime_error("Bad TNA type");
-		}
+		tel_set_tna(ifp, &tna);
+	} else {
+		tel_set_tna(ifp, 0);
 	}
 	zlog_debug("End Wrinting TE parameters into interface");
 	/*END of TE-link parameters*/
 }
 
+/* Replace the TNA address of a TE-link; a NULL tna zeroes it. */
+void
+tel_set_tna(struct interface *    ifp,
+	    const g2mpls_addr_t * tna)
+{
+	const void * addr;
+	size_t       len;
+
+	if (tna == 0) {
+		free(ifp->te_TNA_address);
+		ifp->te_TNA_address_type  = IPv4;
+		ifp->te_TNA_prefix_length = 0;
+		ifp->te_TNA_address = (u_int32_t *) malloc(4);
+		memset(ifp->te_TNA_address, 0, 4);
+		return;
+	}
+
+	switch (tna->type) {
+		case IPv4:
+			addr = &tna->value.ipv4;
+			len  = 4;
+			break;
+		case IPv6:
+			addr = &tna->value.ipv6;
+			len  = 16;
+			break;
+		case NSAP:
+			addr = &tna->value.nsap;
+			len  = 20;
+			break;
+		default:
+			throw std::runtime_error("Bad TNA type");
+	}
+
+	free(ifp->te_TNA_address);
+	ifp->te_TNA_address_type  = tna->type;
+	ifp->te_TNA_prefix_length = 32;
+	ifp->te_TNA_address = (u_int32_t *) malloc(len);
+	memcpy(ifp->te_TNA_address, addr, len);
+}
+
+bool
+tel_tna_same(struct interface *    ifp,
+	     const g2mpls_addr_t & tna)
+{
+	size_t len;
+
+	if (ifp->te_TNA_address == 0 ||
+	    ifp->te_TNA_prefix_length != 32 ||
+	    ifp->te_TNA_address_type != tna.type) {
+		return false;
+	}
+
+	switch (tna.type) {
+		case IPv4:
+			return !memcmp(ifp->te_TNA_address, &tna.value.ipv4, 4);
+		case IPv6:
+			return !memcmp(ifp->te_TNA_address, &tna.value.ipv6, 16);
+		case NSAP:
+			return !memcmp(ifp->te_TNA_address, &tna.value.nsap, 20);
+		default:
+			return false;
+	}
+}
+
+bool
+adv_rsrv_calendar_same(const gmplsTypes::teLinkCalendarSeq & src,
+		       struct zlist *                         dst)
+{
+	struct zlistnode * node;
+	void             * data;
+	calendar_event_t * event;
+	size_t             i = 0;
+
+	if (src.length() != listcount(dst)) {
+		return false;
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(dst, node, data)) {
+		event = (calendar_event_t *) data;
+		if (event->time_stamp != src[i].unixTime) {
+			return false;
+		}
+		for (size_t j = 0; j < MAX_BW_PRIORITIES; j++) {
+			if (event->avail_bw[j] != src[i].availBw[j]) {
+				return false;
+			}
+		}
+		i++;
+	}
+
+	return true;
+}
+
+bool
+lambdas_bitmap_same(const gmplsTypes::teLinkWdmLambdasBitmap & src,
+		    const wdm_link_lambdas_bitmap_t &           dst)
+{
+	const uint8_t * mask;
+
+	if (dst.bitmap_word == 0 ||
+	    dst.base_lambda_label != src.baseLambda ||
+	    dst.num_wavelengths != src.numLambdas ||
+	    src.bitmap.length() > (size_t) dst.bitmap_size * 4) {
+		return false;
+	}
+
+	mask = (const uint8_t *) dst.bitmap_word;
+	for (size_t i = 0; i < src.bitmap.length(); i++) {
+		if (mask[i] != src.bitmap[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool
+srlg_same(const gmplsTypes::srlgSeq & src,
+	  struct zlist *              dst)
+{
+	struct zlistnode * node;
+	void             * data;
+	size_t             i = 0;
+
+	if (dst == 0 || src.length() != listcount(dst)) {
+		return false;
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(dst, node, data)) {
+		if (*(uint32_t *) data != src[i++]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+struct tel_entry {
+	uint32_t           key;
+	struct interface * ifp;
+};
+
+static struct hash * tel_table = 0;
+
+static unsigned int
+tel_hash_key(void * data)
+{
+	return ((struct tel_entry *) data)->key;
+}
+
+static int
+tel_hash_cmp(void * a, void * b)
+{
+	return ((struct tel_entry *) a)->key == ((struct tel_entry *) b)->key;
+}
+
+static void *
+tel_alloc(void * data)
+{
+	struct tel_entry * tel;
+	char               t_name[INTERFACE_NAMSIZ];
+
+	tel = (struct tel_entry *) XCALLOC(MTYPE_TE_LINK, sizeof(*tel));
+	tel->key = ((struct tel_entry *) data)->key;
+
+	snprintf(t_name, sizeof(t_name), "tel%u", tel->key);
+	tel->ifp = if_new(t_name, strlen(t_name));
+	tel->ifp->ifindex = tel->key;
+
+	return tel;
+}
+
+struct interface *
+tel_lookup(uint32_t key)
+{
+	struct tel_entry   lookup;
+	struct tel_entry * tel;
+
+	if (tel_table == 0) {
+		return 0;
+	}
+
+	lookup.key = key;
+	tel = (struct tel_entry *) hash_lookup(tel_table, &lookup);
+
+	return tel ? tel->ifp : 0;
+}
+
+/* Find the TE-link, creating an empty one if it is not known yet. */
+struct interface *
+tel_get(uint32_t key)
+{
+	struct tel_entry   lookup;
+	struct tel_entry * tel;
+
+	if (tel_table == 0) {
+		tel_table = hash_create(tel_hash_key, tel_hash_cmp);
+	}
+
+	lookup.key = key;
+	tel = (struct tel_entry *) hash_get(tel_table, &lookup, tel_alloc);
+
+	return tel->ifp;
+}
+
+void
+tel_release(uint32_t key)
+{
+	struct tel_entry   lookup;
+	struct tel_entry * tel;
+	struct interface * ifp;
+
+	if (tel_table == 0) {
+		return;
+	}
+
+	lookup.key = key;
+	tel = (struct tel_entry *) hash_release(tel_table, &lookup);
+	if (tel == 0) {
+		return;
+	}
+
+	ifp = tel->ifp;
+	list_delete(ifp->adv_rsrv_calendar);
+	list_delete(ifp->te_SRLG_ids);
+	free(ifp->te_TNA_address);
+	free(ifp->lambdas_bitmap.bitmap_word);
+	if_delete_retain(ifp);
+	XFREE(MTYPE_IF, ifp);
+
+	XFREE(MTYPE_TE_LINK, tel);
+}
+
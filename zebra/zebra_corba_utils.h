@@ -38,4 +38,28 @@ void fill_lambdas_bitmap(const gmplsTypes::teLinkWdmLambdasBitmap & src,
 void telinksdata2if(const gmplsTypes::TELinkData & tel,
 		    struct interface *              ifp);
 
+void tel_set_tna(struct interface *    ifp,
+		 const g2mpls_addr_t * tna);
+
+bool tel_tna_same(struct interface *    ifp,
+		  const g2mpls_addr_t & tna);
+
+bool adv_rsrv_calendar_same(const gmplsTypes::teLinkCalendarSeq & src,
+			    struct zlist *                         dst);
+
+bool lambdas_bitmap_same(const gmplsTypes::teLinkWdmLambdasBitmap & src,
+			 const wdm_link_lambdas_bitmap_t &           dst);
+
+bool srlg_same(const gmplsTypes::srlgSeq & src,
+	       struct zlist *              dst);
+
+/*
+ * TE-link table: the TE-links learnt from LRM, by telKey.  Each is kept
+ * as a "tel<key>" struct interface outside iflist, so updates are
+ * applied in place and compared against what was last sent.
+ */
+struct interface * tel_lookup(uint32_t key);
+struct interface * tel_get(uint32_t key);
+void               tel_release(uint32_t key);
+
 #endif
@@ -48,6 +48,9 @@ extern struct zebra_t zebrad;
  */
 int rib_process_hold_time = 10;
 
+/* Longest a RIB work queue run may take, in usec. */
+unsigned long rib_process_budget = 100 * 1000L;
+
 /* Each route type's string and default distance value. */
 struct
 {  
@@ -70,6 +73,11 @@ struct
 /* Vector for routing table.  */
 vector vrf_vector;
 
+struct rib_fib_stats rib_fib_stats;
+
+/* Last generation handed out to a rib installed in the kernel. */
+static u_int32_t rib_fib_gen;
+
 /* Allocate new VRF.  */
 static struct vrf *
 vrf_alloc (const char *name)
@@ -785,12 +793,82 @@ nexthop_active_update (struct route_node *rn, struct rib *rib, int set)
 #define RIB_SYSTEM_ROUTE(R) \
         ((R)->type == ZEBRA_ROUTE_KERNEL || (R)->type == ZEBRA_ROUTE_CONNECT)
 
+/* Account one route handed to the kernel in the per-second rate. */
+static void
+rib_fib_rate_tick (void)
+{
+  time_t now = quagga_time (NULL);
+
+  if (now != rib_fib_stats.rate_sec)
+    {
+      rib_fib_stats.rate_last =
+        (now == rib_fib_stats.rate_sec + 1) ? rib_fib_stats.rate_count : 0;
+      rib_fib_stats.rate_sec = now;
+      rib_fib_stats.rate_count = 0;
+    }
+  if (++rib_fib_stats.rate_count > rib_fib_stats.rate_peak)
+    rib_fib_stats.rate_peak = rib_fib_stats.rate_count;
+}
+
+/* The kernel refused a route that rib_install_kernel() handed it.
+   Kernel interfaces that learn this only after the call returned
+   report it here with the rib's fib_gen at the time, so that the FIB
+   flags match what the kernel has.  A rib since removed or installed
+   again is left alone. */
+void
+rib_install_kernel_failed (struct prefix *p, u_int32_t gen)
+{
+  struct route_table *table;
+  struct route_node *rn;
+  struct rib *rib;
+  struct nexthop *nexthop;
+
+  rib_fib_stats.failures++;
+
+  switch (PREFIX_FAMILY (p))
+    {
+    case AF_INET:
+      table = vrf_table (AFI_IP, SAFI_UNICAST, 0);
+      break;
+#ifdef HAVE_IPV6
+    case AF_INET6:
+      table = vrf_table (AFI_IP6, SAFI_UNICAST, 0);
+      break;
+#endif /* HAVE_IPV6 */
+    default:
+      return;
+    }
+  if (! table)
+    return;
+
+  rn = route_node_lookup (table, p);
+  if (! rn)
+    return;
+
+  for (rib = rn->info; rib; rib = rib->next)
+    if (rib->fib_gen == gen)
+      {
+        for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+          UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+        break;
+      }
+
+  route_unlock_node (rn);
+}
+
 static void
 rib_install_kernel (struct route_node *rn, struct rib *rib)
 {
   int ret = 0;
   struct nexthop *nexthop;
 
+  rib_fib_stats.installs++;
+  rib_fib_rate_tick ();
+
+  rib->fib_gen = ++rib_fib_gen;
+  if (rib->fib_gen == 0)
+    rib->fib_gen = ++rib_fib_gen;
+
   switch (PREFIX_FAMILY (&rn->p))
     {
     case AF_INET:
@@ -805,6 +883,7 @@ rib_install_kernel (struct route_node *rn, struct rib *rib)
 
   if (ret < 0)
     {
+      rib_fib_stats.failures++;
       for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
 	UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
     }
@@ -817,6 +896,9 @@ rib_uninstall_kernel (struct route_node *rn, struct rib *rib)
   int ret = 0;
   struct nexthop *nexthop;
 
+  rib_fib_stats.removals++;
+  rib_fib_rate_tick ();
+
   switch (PREFIX_FAMILY (&rn->p))
     {
     case AF_INET:
@@ -1075,6 +1157,14 @@ rib_queue_add (struct zebra_t *zebra, struct route_node *rn)
   return;
 }
 
+/* A RIB work queue run is over: send the kernel updates its route
+   nodes queued up together. */
+static void
+rib_queue_batch_end (struct work_queue *wq)
+{
+  kernel_flush ();
+}
+
 /* initialise zebra rib work queue */
 static void
 rib_queue_init (struct zebra_t *zebra)
@@ -1094,6 +1184,8 @@ rib_queue_init (struct zebra_t *zebra)
   /* XXX: TODO: These should be runtime configurable via vty */
   zebra->ribq->spec.max_retries = 3;
   zebra->ribq->spec.hold = rib_process_hold_time;
+  zebra->ribq->spec.budget = rib_process_budget;
+  zebra->ribq->spec.batch_end_func = &rib_queue_batch_end;
   
   return;
 }
@@ -1136,6 +1228,37 @@ rib_queue_init (struct zebra_t *zebra)
  *
  */
  
+/* Set while a kernel table dump is read in: new ribs are only linked
+ * to their node, and rib_bulk_end() queues the whole table in one
+ * ordered pass rather than one queue operation per route.
+ */
+static int rib_bulk;
+
+static void
+rib_bulk_queue_table (struct route_table *table)
+{
+  struct route_node *rn;
+
+  if (table)
+    for (rn = route_top (table); rn; rn = route_next (rn))
+      if (rn->info)
+        rib_queue_add (&zebrad, rn);
+}
+
+void
+rib_bulk_begin (void)
+{
+  rib_bulk = 1;
+}
+
+void
+rib_bulk_end (void)
+{
+  rib_bulk = 0;
+  rib_bulk_queue_table (vrf_table (AFI_IP, SAFI_UNICAST, 0));
+  rib_bulk_queue_table (vrf_table (AFI_IP6, SAFI_UNICAST, 0));
+}
+
 /* Add RIB to head of the route node. */
 static void
 rib_link (struct route_node *rn, struct rib *rib)
@@ -1160,7 +1283,8 @@ rib_link (struct route_node *rn, struct rib *rib)
     }
   rib->next = head;
   rn->info = rib;
-  rib_queue_add (&zebrad, rn);
+  if (! rib_bulk)
+    rib_queue_add (&zebrad, rn);
 }
 
 static void
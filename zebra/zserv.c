@@ -1149,6 +1149,127 @@ zread_ipv4_delete (struct zserv *client, u_short length)
   return 0;
 }
 
+/* Parse a ZEBRA_IPV4_ROUTE_BULK (see zapi_ipv4_bulk_add()).  Each
+   route group's nexthops are read once and applied to all its
+   prefixes; every route node touched is queued for the RIB work queue
+   before it gets to run. */
+static int
+zread_ipv4_bulk (struct zserv *client, u_short length)
+{
+  struct stream *s;
+  size_t end;
+  u_char cmd, type, flags, message;
+  u_char nexthop_num, nexthop_type, ifname_len;
+  u_char nh_type[256];
+  struct in_addr nh_gate[256];
+  unsigned int nh_ifindex[256];
+  struct in_addr gate;
+  unsigned int ifindex;
+  u_char distance;
+  u_int32_t metric;
+  u_int16_t count;
+  struct prefix_ipv4 p;
+  struct rib *rib;
+  int i, n;
+
+  s = client->ibuf;
+  end = stream_get_getp (s) + length;
+
+  while (stream_get_getp (s) + 4 <= end)
+    {
+      cmd = stream_getc (s);
+      type = stream_getc (s);
+      flags = stream_getc (s);
+      message = stream_getc (s);
+
+      nexthop_num = 0;
+      gate.s_addr = 0;
+      ifindex = 0;
+      if (CHECK_FLAG (message, ZAPI_MESSAGE_NEXTHOP))
+	{
+	  nexthop_num = stream_getc (s);
+
+	  for (i = 0; i < nexthop_num; i++)
+	    {
+	      nexthop_type = nh_type[i] = stream_getc (s);
+
+	      switch (nexthop_type)
+		{
+		case ZEBRA_NEXTHOP_IFINDEX:
+		  ifindex = nh_ifindex[i] = stream_getl (s);
+		  break;
+		case ZEBRA_NEXTHOP_IFNAME:
+		  ifname_len = stream_getc (s);
+		  stream_forward_getp (s, ifname_len);
+		  break;
+		case ZEBRA_NEXTHOP_IPV4:
+		  gate.s_addr = nh_gate[i].s_addr = stream_get_ipv4 (s);
+		  break;
+		case ZEBRA_NEXTHOP_IPV6:
+		  stream_forward_getp (s, IPV6_MAX_BYTELEN);
+		  break;
+		}
+	    }
+	}
+
+      distance = 0;
+      if (CHECK_FLAG (message, ZAPI_MESSAGE_DISTANCE))
+	distance = stream_getc (s);
+      metric = 0;
+      if (CHECK_FLAG (message, ZAPI_MESSAGE_METRIC))
+	metric = stream_getl (s);
+
+      count = stream_getw (s);
+      for (n = 0; n < count; n++)
+	{
+	  memset (&p, 0, sizeof (struct prefix_ipv4));
+	  p.family = AF_INET;
+	  p.prefixlen = stream_getc (s);
+	  if (p.prefixlen > IPV4_MAX_BITLEN
+	      || stream_get_getp (s) + PSIZE (p.prefixlen) > end)
+	    {
+	      zlog_warn ("%s: socket %d malformed route bulk message",
+			 __func__, client->sock);
+	      return -1;
+	    }
+	  stream_get (&p.prefix, s, PSIZE (p.prefixlen));
+
+	  if (cmd == ZEBRA_IPV4_ROUTE_DELETE)
+	    {
+	      rib_delete_ipv4 (type, flags, &p, &gate, ifindex,
+			       client->rtm_table);
+	      continue;
+	    }
+	  if (cmd != ZEBRA_IPV4_ROUTE_ADD)
+	    continue;
+
+	  rib = XCALLOC (MTYPE_RIB, sizeof (struct rib));
+	  rib->type = type;
+	  rib->flags = flags;
+	  rib->uptime = time (NULL);
+	  rib->distance = distance;
+	  rib->metric = metric;
+	  rib->table = zebrad.rtm_table_default;
+	  for (i = 0; i < nexthop_num; i++)
+	    switch (nh_type[i])
+	      {
+	      case ZEBRA_NEXTHOP_IFINDEX:
+		nexthop_ifindex_add (rib, nh_ifindex[i]);
+		break;
+	      case ZEBRA_NEXTHOP_IPV4:
+		nexthop_ipv4_add (rib, &nh_gate[i]);
+		break;
+	      case ZEBRA_NEXTHOP_BLACKHOLE:
+		nexthop_blackhole_add (rib);
+		break;
+	      }
+	  rib_add_ipv4_multipath (&p, rib);
+	}
+    }
+
+  return 0;
+}
+
 /* Nexthop lookup for IPv4. */
 static int
 zread_ipv4_nexthop_lookup (struct zserv *client, u_short length)
@@ -1403,7 +1524,7 @@ zebra_client_create (int sock)
 
   /* Make client input/output buffer. */
   client->sock = sock;
-  client->ibuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
+  client->ibuf = stream_new (ZEBRA_CLIENT_IBUF_SIZE);
   client->obuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
   client->wb = buffer_new(0);
 
@@ -1420,106 +1541,14 @@ zebra_client_create (int sock)
   zebra_event (ZEBRA_READ, sock, client);
 }
 
-/* Handler of zebra service request. */
-static int
-zebra_client_read (struct thread *thread)
+/* Dispatch one message, whose body is next in client->ibuf. */
+static void
+zebra_client_dispatch (struct zserv *client, uint16_t command,
+		       uint16_t length)
 {
-  int sock;
-  struct zserv *client;
-  size_t already;
-  uint16_t length, command;
-  uint8_t marker, version;
-
-  /* Get thread data.  Reset reading thread because I'm running. */
-  sock = THREAD_FD (thread);
-  client = THREAD_ARG (thread);
-  client->t_read = NULL;
-
-  if (client->t_suicide)
-    {
-      zebra_client_close(client);
-      return -1;
-    }
-
-  /* Read length and command (if we don't have it already). */
-  if ((already = stream_get_endp(client->ibuf)) < ZEBRA_HEADER_SIZE)
-    {
-      ssize_t nbyte;
-      if (((nbyte = stream_read_try (client->ibuf, sock,
-				     ZEBRA_HEADER_SIZE-already)) == 0) ||
-	  (nbyte == -1))
-	{
-	  if (IS_ZEBRA_DEBUG_EVENT)
-	    zlog_debug ("connection closed socket [%d]", sock);
-	  zebra_client_close (client);
-	  return -1;
-	}
-      if (nbyte != (ssize_t)(ZEBRA_HEADER_SIZE-already))
-	{
-	  /* Try again later. */
-	  zebra_event (ZEBRA_READ, sock, client);
-	  return 0;
-	}
-      already = ZEBRA_HEADER_SIZE;
-    }
-
-  /* Reset to read from the beginning of the incoming packet. */
-  stream_set_getp(client->ibuf, 0);
-
-  /* Fetch header values */
-  length = stream_getw (client->ibuf);
-  marker = stream_getc (client->ibuf);
-  version = stream_getc (client->ibuf);
-  command = stream_getw (client->ibuf);
-
-  if (marker != ZEBRA_HEADER_MARKER || version != ZSERV_VERSION)
-    {
-      zlog_err("%s: socket %d version mismatch, marker %d, version %d",
-               __func__, sock, marker, version);
-      zebra_client_close (client);
-      return -1;
-    }
-  if (length < ZEBRA_HEADER_SIZE) 
-    {
-      zlog_warn("%s: socket %d message length %u is less than header size %d",
-	        __func__, sock, length, ZEBRA_HEADER_SIZE);
-      zebra_client_close (client);
-      return -1;
-    }
-  if (length > STREAM_SIZE(client->ibuf))
-    {
-      zlog_warn("%s: socket %d message length %u exceeds buffer size %lu",
-	        __func__, sock, length, (u_long)STREAM_SIZE(client->ibuf));
-      zebra_client_close (client);
-      return -1;
-    }
-
-  /* Read rest of data. */
-  if (already < length)
-    {
-      ssize_t nbyte;
-      if (((nbyte = stream_read_try (client->ibuf, sock,
-				     length-already)) == 0) ||
-	  (nbyte == -1))
-	{
-	  if (IS_ZEBRA_DEBUG_EVENT)
-	    zlog_debug ("connection closed [%d] when reading zebra data", sock);
-	  zebra_client_close (client);
-	  return -1;
-	}
-      if (nbyte != (ssize_t)(length-already))
-        {
-	  /* Try again later. */
-	  zebra_event (ZEBRA_READ, sock, client);
-	  return 0;
-	}
-    }
-
-  length -= ZEBRA_HEADER_SIZE;
-
   /* Debug packet information. */
   if (IS_ZEBRA_DEBUG_EVENT)
-    zlog_debug ("zebra message comes from socket [%d]", sock);
+    zlog_debug ("zebra message comes from socket [%d]", client->sock);
 
   if (IS_ZEBRA_DEBUG_PACKET && IS_ZEBRA_DEBUG_RECV)
     zlog_debug ("zebra message received [%s] %d", 
@@ -1573,6 +1602,9 @@ zebra_client_read (struct thread *thread)
     case ZEBRA_IPV4_ROUTE_DELETE:
       zread_ipv4_delete (client, length);
       break;
+    case ZEBRA_IPV4_ROUTE_BULK:
+      zread_ipv4_bulk (client, length);
+      break;
 #ifdef HAVE_IPV6
     case ZEBRA_IPV6_ROUTE_ADD:
       zread_ipv6_add (client, length);
@@ -1608,20 +1640,146 @@ zebra_client_read (struct thread *thread)
       zlog_info ("Zebra received unknown command %d", command);
       break;
     }
+}
+
+/* Count a dispatched message in the client's per-second rate. */
+static void
+zebra_client_rate_tick (struct zserv *client, unsigned long msgs)
+{
+  time_t now = quagga_time (NULL);
+
+  if (now != client->rate_sec)
+    {
+      client->rate_last =
+	(now == client->rate_sec + 1) ? client->rate_count : 0;
+      client->rate_sec = now;
+      client->rate_count = 0;
+    }
+  client->rate_count += msgs;
+  if (client->rate_count > client->rate_peak)
+    client->rate_peak = client->rate_count;
+}
+
+/* Handler of zebra service request.  Each read() takes as much as the
+   socket has and the input buffer holds, then the complete messages in
+   the buffer are dispatched in place, up to ZEBRA_CLIENT_READ_BATCH.
+   A partial message is moved to the front of the buffer to be completed
+   by the next read. */
+static int
+zebra_client_read (struct thread *thread)
+{
+  int sock;
+  struct zserv *client;
+  struct stream *s;
+  ssize_t nbyte;
+  size_t start;
+  uint16_t length, command;
+  uint8_t marker, version;
+  unsigned long msgs = 0;
+
+  /* Get thread data.  Reset reading thread because I'm running. */
+  client = THREAD_ARG (thread);
+  client->t_read = NULL;
+  sock = client->sock;
+  s = client->ibuf;
 
   if (client->t_suicide)
     {
-      /* No need to wait for thread callback, just kill immediately. */
       zebra_client_close(client);
       return -1;
     }
 
-  stream_reset (client->ibuf);
-  zebra_event (ZEBRA_READ, sock, client);
+  /* Read what there is room for; a buffer still full of messages from
+     the last batch is worked off first. */
+  nbyte = -2;
+  if (STREAM_WRITEABLE (s) > 0)
+    nbyte = stream_read_try (s, sock, STREAM_WRITEABLE (s));
+  if (nbyte == 0 || nbyte == -1)
+    {
+      if (IS_ZEBRA_DEBUG_EVENT)
+	zlog_debug ("connection closed socket [%d]", sock);
+      zebra_client_close (client);
+      return -1;
+    }
+  if (nbyte > 0)
+    {
+      client->reads++;
+      client->bytes_in += nbyte;
+      if (stream_get_endp (s) > client->ibuf_max)
+	client->ibuf_max = stream_get_endp (s);
+    }
+
+  while (msgs < ZEBRA_CLIENT_READ_BATCH
+	 && STREAM_READABLE (s) >= ZEBRA_HEADER_SIZE)
+    {
+      /* Fetch header values */
+      start = stream_get_getp (s);
+      length = stream_getw_from (s, start);
+      marker = stream_getc_from (s, start + 2);
+      version = stream_getc_from (s, start + 3);
+      command = stream_getw_from (s, start + 4);
+
+      if (marker != ZEBRA_HEADER_MARKER || version != ZSERV_VERSION)
+	{
+	  zlog_err("%s: socket %d version mismatch, marker %d, version %d",
+		   __func__, sock, marker, version);
+	  zebra_client_close (client);
+	  return -1;
+	}
+      if (length < ZEBRA_HEADER_SIZE) 
+	{
+	  zlog_warn("%s: socket %d message length %u is less than header size %d",
+		    __func__, sock, length, ZEBRA_HEADER_SIZE);
+	  zebra_client_close (client);
+	  return -1;
+	}
+      if (length > ZEBRA_MAX_PACKET_SIZ)
+	{
+	  zlog_warn("%s: socket %d message length %u exceeds buffer size %lu",
+		    __func__, sock, length, (u_long)ZEBRA_MAX_PACKET_SIZ);
+	  zebra_client_close (client);
+	  return -1;
+	}
+
+      /* The rest of it is still on its way. */
+      if (STREAM_READABLE (s) < length)
+	break;
+
+      stream_forward_getp (s, ZEBRA_HEADER_SIZE);
+      zebra_client_dispatch (client, command, length - ZEBRA_HEADER_SIZE);
+      msgs++;
+
+      if (client->t_suicide)
+	{
+	  /* No need to wait for thread callback, just kill immediately. */
+	  zebra_client_close(client);
+	  return -1;
+	}
+
+      /* Whatever the handler read, the next message starts here. */
+      stream_set_getp (s, start + length);
+    }
+
+  stream_pulldown (s);
+  if (msgs)
+    {
+      client->msgs_in += msgs;
+      zebra_client_rate_tick (client, msgs);
+    }
+
+  /* Complete messages left over wait for their turn behind the other
+     clients, which a read thread would not give them if the socket has
+     nothing more. */
+  if (msgs == ZEBRA_CLIENT_READ_BATCH
+      && STREAM_READABLE (s) >= ZEBRA_HEADER_SIZE
+      && STREAM_READABLE (s) >= stream_getw_from (s, 0))
+    client->t_read =
+      thread_add_timer_msec (zebrad.master, zebra_client_read, client, 0);
+  else
+    zebra_event (ZEBRA_READ, sock, client);
   return 0;
 }
 
-
 /* Accept code of zebra server socket. */
 static int
 zebra_accept (struct thread *thread)
@@ -1872,13 +2030,60 @@ DEFUN (show_zebra_client,
 {
   struct zlistnode *node;
   struct zserv *client;
+  time_t now = quagga_time (NULL);
+  unsigned long rate;
 
   for (ALL_LIST_ELEMENTS_RO (zebrad.client_list, node, client))
-    vty_out (vty, "Client fd %d%s", client->sock, VTY_NEWLINE);
+    {
+      rate = 0;
+      if (now == client->rate_sec)
+	rate = client->rate_last;
+      else if (now == client->rate_sec + 1)
+	rate = client->rate_count;
+
+      vty_out (vty, "Client fd %d%s", client->sock, VTY_NEWLINE);
+      vty_out (vty, "  Messages %lu, %lu/sec (peak %lu/sec)%s",
+	       client->msgs_in, rate, client->rate_peak, VTY_NEWLINE);
+      vty_out (vty, "  Reads %lu, %lu bytes, %lu messages per read%s",
+	       client->reads, client->bytes_in,
+	       client->reads ? client->msgs_in / client->reads : 0,
+	       VTY_NEWLINE);
+      vty_out (vty, "  Input buffer %lu of %lu bytes (max %lu)%s",
+	       (u_long) STREAM_READABLE (client->ibuf),
+	       (u_long) STREAM_SIZE (client->ibuf),
+	       (u_long) client->ibuf_max, VTY_NEWLINE);
+    }
   
   return CMD_SUCCESS;
 }
 
+DEFUN (show_zebra_statistics,
+       show_zebra_statistics_cmd,
+       "show zebra statistics",
+       SHOW_STR
+       "Zebra information"
+       "Forwarding table update statistics")
+{
+  time_t now = quagga_time (NULL);
+  unsigned long rate = 0;
+
+  if (now == rib_fib_stats.rate_sec)
+    rate = rib_fib_stats.rate_last;
+  else if (now == rib_fib_stats.rate_sec + 1)
+    rate = rib_fib_stats.rate_count;
+
+  vty_out (vty, "Kernel route installs %lu, removals %lu, failures %lu%s",
+           rib_fib_stats.installs, rib_fib_stats.removals,
+           rib_fib_stats.failures, VTY_NEWLINE);
+  vty_out (vty, "Kernel batches sent %lu, in flight %lu (max %lu)%s",
+           rib_fib_stats.batches, rib_fib_stats.inflight,
+           rib_fib_stats.inflight_max, VTY_NEWLINE);
+  vty_out (vty, "Kernel updates/sec last %lu, peak %lu%s",
+           rate, rib_fib_stats.rate_peak, VTY_NEWLINE);
+
+  return CMD_SUCCESS;
+}
+
 /* Table configuration write function. */
 static int
 config_write_table (struct vty *vty)
@@ -2041,6 +2246,7 @@ zebra_init (void)
   install_element (CONFIG_NODE, &ip_forwarding_cmd);
   install_element (CONFIG_NODE, &no_ip_forwarding_cmd);
   install_element (ENABLE_NODE, &show_zebra_client_cmd);
+  install_element (ENABLE_NODE, &show_zebra_statistics_cmd);
 
 #ifdef HAVE_NETLINK
   install_element (VIEW_NODE, &show_table_cmd);
@@ -54,6 +54,12 @@ extern "C" {
 /* Default configuration filename. */
 #define DEFAULT_CONFIG_FILE "zebra.conf"
 
+/* Client input buffer, room for several messages per read(). */
+#define ZEBRA_CLIENT_IBUF_SIZE        (ZEBRA_MAX_PACKET_SIZ * 16)
+
+/* Messages dispatched per client read before other clients get a turn. */
+#define ZEBRA_CLIENT_READ_BATCH       64
+
 /* Client structure. */
 struct zserv
 {
@@ -88,6 +94,16 @@ struct zserv
 
   /* Router-id information. */
   u_char ridinfo;
+
+  /* Read statistics. */
+  unsigned long msgs_in;	/* messages dispatched */
+  unsigned long reads;		/* read() calls that returned data */
+  unsigned long bytes_in;
+  size_t ibuf_max;		/* most bytes ibuf has held */
+  time_t rate_sec;		/* second rate_count is counting */
+  unsigned long rate_count;
+  unsigned long rate_last;	/* messages in the second before */
+  unsigned long rate_peak;
 #ifdef GMPLS
 #if !HAVE_OMNIORB
   int client_type;